@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	ESP_LOG_NONE = 0,
+	ESP_LOG_ERROR,
+	ESP_LOG_WARN,
+	ESP_LOG_INFO,
+	ESP_LOG_DEBUG,
+	ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+typedef int (*vprintf_like_t)(const char *, va_list);
+
+vprintf_like_t	esp_log_set_vprintf(vprintf_like_t func);
+void		esp_log_level_set(const char *tag, esp_log_level_t level);
+esp_log_level_t	esp_log_level_get(const char *tag);
+uint32_t	esp_log_timestamp(void);
+void		esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+			__attribute__((format(printf, 3, 4)));
+void		esp_log_writev(esp_log_level_t level, const char *tag, const char *format, va_list args);
+
+#define LOG_FORMAT(letter, format)	#letter " (%" PRIu32 ") %s: " format "\n"
+
+#define ESP_LOG_LEVEL(level, tag, letter, format, ...) do {				\
+		if ((level) <= CONFIG_LOG_MAXIMUM_LEVEL && (level) <= esp_log_level_get(tag)) {	\
+			esp_log_write(level, tag, LOG_FORMAT(letter, format),		\
+				esp_log_timestamp(), tag, ##__VA_ARGS__);		\
+		}									\
+	} while (0)
+
+#define ESP_LOGE(tag, format, ...)	ESP_LOG_LEVEL(ESP_LOG_ERROR,   tag, E, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)	ESP_LOG_LEVEL(ESP_LOG_WARN,    tag, W, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)	ESP_LOG_LEVEL(ESP_LOG_INFO,    tag, I, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)	ESP_LOG_LEVEL(ESP_LOG_DEBUG,   tag, D, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)	ESP_LOG_LEVEL(ESP_LOG_VERBOSE, tag, V, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,254 @@
+#pragma once
+
+/*
+ * Host-симулятор: підмножина API ESP-MESH (esp-idf/components/esp_wifi/include/esp_mesh.h),
+ * яку використовує прошивка. Реалізація — host_sim/sim_mesh.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_ROOT_LAYER			(1)
+#define MESH_MTU			(1500)
+#define MESH_MPS			(1472)
+
+#define ESP_ERR_MESH_WIFI_NOT_START	(ESP_ERR_MESH_BASE + 1)
+#define ESP_ERR_MESH_NOT_INIT		(ESP_ERR_MESH_BASE + 2)
+#define ESP_ERR_MESH_NOT_CONFIG		(ESP_ERR_MESH_BASE + 3)
+#define ESP_ERR_MESH_NOT_START		(ESP_ERR_MESH_BASE + 4)
+#define ESP_ERR_MESH_NOT_SUPPORT	(ESP_ERR_MESH_BASE + 5)
+#define ESP_ERR_MESH_NOT_ALLOWED	(ESP_ERR_MESH_BASE + 6)
+#define ESP_ERR_MESH_NO_MEMORY		(ESP_ERR_MESH_BASE + 7)
+#define ESP_ERR_MESH_ARGUMENT		(ESP_ERR_MESH_BASE + 8)
+#define ESP_ERR_MESH_EXCEED_MTU		(ESP_ERR_MESH_BASE + 9)
+#define ESP_ERR_MESH_TIMEOUT		(ESP_ERR_MESH_BASE + 10)
+#define ESP_ERR_MESH_DISCONNECTED	(ESP_ERR_MESH_BASE + 11)
+#define ESP_ERR_MESH_QUEUE_FAIL		(ESP_ERR_MESH_BASE + 12)
+#define ESP_ERR_MESH_QUEUE_FULL		(ESP_ERR_MESH_BASE + 13)
+#define ESP_ERR_MESH_NO_PARENT_FOUND	(ESP_ERR_MESH_BASE + 14)
+#define ESP_ERR_MESH_NO_ROUTE_FOUND	(ESP_ERR_MESH_BASE + 15)
+
+#define MESH_DATA_ENC			(0x01)
+#define MESH_DATA_P2P			(0x02)
+#define MESH_DATA_FROMDS		(0x04)
+#define MESH_DATA_TODS			(0x08)
+#define MESH_DATA_NONBLOCK		(0x10)
+#define MESH_DATA_DROP			(0x20)
+#define MESH_DATA_GROUP			(0x40)
+
+#define MESH_OPT_SEND_GROUP		(7)
+#define MESH_OPT_RECV_DS_ADDR		(8)
+
+extern const char *MESH_EVENT;
+
+typedef enum {
+	MESH_EVENT_STARTED,
+	MESH_EVENT_STOPPED,
+	MESH_EVENT_CHANNEL_SWITCH,
+	MESH_EVENT_CHILD_CONNECTED,
+	MESH_EVENT_CHILD_DISCONNECTED,
+	MESH_EVENT_ROUTING_TABLE_ADD,
+	MESH_EVENT_ROUTING_TABLE_REMOVE,
+	MESH_EVENT_PARENT_CONNECTED,
+	MESH_EVENT_PARENT_DISCONNECTED,
+	MESH_EVENT_NO_PARENT_FOUND,
+	MESH_EVENT_LAYER_CHANGE,
+	MESH_EVENT_TODS_STATE,
+	MESH_EVENT_VOTE_STARTED,
+	MESH_EVENT_VOTE_STOPPED,
+	MESH_EVENT_ROOT_ADDRESS,
+	MESH_EVENT_ROOT_SWITCH_REQ,
+	MESH_EVENT_ROOT_SWITCH_ACK,
+	MESH_EVENT_ROOT_ASKED_YIELD,
+	MESH_EVENT_ROOT_FIXED,
+	MESH_EVENT_SCAN_DONE,
+	MESH_EVENT_NETWORK_STATE,
+	MESH_EVENT_STOP_RECONNECTION,
+	MESH_EVENT_FIND_NETWORK,
+	MESH_EVENT_ROUTER_SWITCH,
+	MESH_EVENT_PS_PARENT_DUTY,
+	MESH_EVENT_PS_CHILD_DUTY,
+	MESH_EVENT_PS_DEVICE_DUTY,
+	MESH_EVENT_MAX,
+} mesh_event_id_t;
+
+typedef enum {
+	MESH_PROTO_BIN,
+	MESH_PROTO_HTTP,
+	MESH_PROTO_JSON,
+	MESH_PROTO_MQTT,
+	MESH_PROTO_AP,
+	MESH_PROTO_STA,
+} mesh_proto_t;
+
+typedef enum {
+	MESH_TOS_P2P,
+	MESH_TOS_E2E,
+	MESH_TOS_DEF,
+} mesh_tos_t;
+
+typedef enum {
+	MESH_TOPO_TREE,
+	MESH_TOPO_CHAIN,
+} esp_mesh_topology_t;
+
+typedef struct {
+	uint32_t	addr;
+	uint16_t	port;
+} __attribute__((packed)) mip_t;
+
+typedef union {
+	uint8_t		addr[6];
+	mip_t		mip;
+} mesh_addr_t;
+
+typedef struct {
+	uint8_t		*data;
+	uint16_t	size;
+	mesh_proto_t	proto;
+	mesh_tos_t	tos;
+} mesh_data_t;
+
+typedef struct {
+	uint8_t		type;
+	uint16_t	len;
+	uint8_t		*val;
+} __attribute__((packed)) mesh_opt_t;
+
+typedef struct {
+	int		to_parent;
+	int		to_parent_p2p;
+	int		to_child;
+	int		to_child_p2p;
+	int		mgmt;
+	int		broadcast;
+} mesh_tx_pending_t;
+
+typedef struct {
+	int		toDS;
+	int		toSelf;
+} mesh_rx_pending_t;
+
+typedef struct {
+	uint8_t		ssid[32];
+	uint8_t		ssid_len;
+	uint8_t		bssid[6];
+	uint8_t		password[64];
+	bool		allow_router_switch;
+} mesh_router_t;
+
+typedef struct {
+	uint8_t		password[64];
+	uint8_t		max_connection;
+	uint8_t		nonmesh_max_connection;
+} mesh_ap_cfg_t;
+
+typedef struct {
+	uint8_t		channel;
+	bool		allow_channel_switch;
+	mesh_addr_t	mesh_id;
+	mesh_router_t	router;
+	mesh_ap_cfg_t	mesh_ap;
+	const void	*crypto_funcs;
+} mesh_cfg_t;
+
+#define MESH_INIT_CONFIG_DEFAULT()	{ 0 }
+
+typedef struct {
+	uint8_t		ssid[32];
+	uint8_t		bssid[6];
+	uint8_t		channel;
+	int		authmode;
+} mesh_event_parent_info_t;
+
+typedef struct {
+	mesh_event_parent_info_t connected;
+	uint16_t	self_layer;
+	uint8_t		duty;
+} mesh_event_connected_t;
+
+typedef struct {
+	uint8_t		ssid[32];
+	uint8_t		ssid_len;
+	uint8_t		bssid[6];
+	uint8_t		reason;
+	int8_t		rssi;
+} mesh_event_disconnected_t;
+
+typedef struct {
+	uint8_t		mac[6];
+	uint8_t		aid;
+	bool		is_mesh_child;
+} mesh_event_child_connected_t;
+
+typedef mesh_event_child_connected_t mesh_event_child_disconnected_t;
+
+typedef struct {
+	uint16_t	rt_size_new;
+	uint16_t	rt_size_change;
+} mesh_event_routing_table_change_t;
+
+typedef struct {
+	int		scan_times;
+} mesh_event_no_parent_found_t;
+
+typedef struct {
+	uint16_t	new_layer;
+} mesh_event_layer_change_t;
+
+typedef mesh_addr_t mesh_event_root_address_t;
+
+typedef enum {
+	MESH_TODS_UNREACHABLE,
+	MESH_TODS_REACHABLE,
+} mesh_event_toDS_state_t;
+
+typedef struct {
+	bool		is_rootless;
+} mesh_event_network_state_t;
+
+esp_err_t	esp_mesh_init(void);
+esp_err_t	esp_mesh_start(void);
+esp_err_t	esp_mesh_stop(void);
+esp_err_t	esp_mesh_set_config(const mesh_cfg_t *config);
+esp_err_t	esp_mesh_set_topology(esp_mesh_topology_t topo);
+esp_mesh_topology_t esp_mesh_get_topology(void);
+esp_err_t	esp_mesh_set_max_layer(int max_layer);
+esp_err_t	esp_mesh_set_vote_percentage(float percentage);
+esp_err_t	esp_mesh_set_xon_qsize(int qsize);
+int		esp_mesh_get_xon_qsize(void);
+esp_err_t	esp_mesh_set_ap_authmode(wifi_auth_mode_t authmode);
+esp_err_t	esp_mesh_set_ap_assoc_expire(int seconds);
+esp_err_t	esp_mesh_fix_root(bool enable);
+bool		esp_mesh_is_root_fixed(void);
+esp_err_t	esp_mesh_enable_ps(void);
+esp_err_t	esp_mesh_disable_ps(void);
+bool		esp_mesh_is_ps_enabled(void);
+
+esp_err_t	esp_mesh_send(const mesh_addr_t *to, const mesh_data_t *data,
+			      int flag, const mesh_opt_t opt[], int opt_count);
+esp_err_t	esp_mesh_recv(mesh_addr_t *from, mesh_data_t *data, int timeout_ms,
+			      int *flag, mesh_opt_t opt[], int opt_count);
+
+bool		esp_mesh_is_root(void);
+int		esp_mesh_get_layer(void);
+esp_err_t	esp_mesh_get_id(mesh_addr_t *id);
+esp_err_t	esp_mesh_get_parent_bssid(mesh_addr_t *bssid);
+int		esp_mesh_get_routing_table_size(void);
+esp_err_t	esp_mesh_get_routing_table(mesh_addr_t *mac, int len, int *size);
+int		esp_mesh_get_total_node_num(void);
+esp_err_t	esp_mesh_get_tx_pending(mesh_tx_pending_t *pending);
+esp_err_t	esp_mesh_get_rx_pending(mesh_rx_pending_t *pending);
+int		esp_mesh_available_txupQ_num(const mesh_addr_t *addr, uint32_t *xseqno_in);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CRC-16-CCITT, як у ROM: інверсія на вході й виході, тож можна продовжувати по частинах
+uint16_t	esp_rom_crc16_le(uint16_t crc, uint8_t const *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
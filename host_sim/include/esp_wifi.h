@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	WIFI_IF_STA = 0,
+	WIFI_IF_AP,
+} wifi_interface_t;
+
+typedef enum {
+	WIFI_STORAGE_FLASH,
+	WIFI_STORAGE_RAM,
+} wifi_storage_t;
+
+typedef enum {
+	WIFI_AUTH_OPEN = 0,
+	WIFI_AUTH_WEP,
+	WIFI_AUTH_WPA_PSK,
+	WIFI_AUTH_WPA2_PSK,
+	WIFI_AUTH_WPA_WPA2_PSK,
+} wifi_auth_mode_t;
+
+typedef struct {
+	int	magic;
+} wifi_init_config_t;
+
+#define ESP_WIFI_MAX_CONN_NUM		(15)
+
+typedef struct {
+	uint8_t		mac[6];
+	int8_t		rssi;
+} wifi_sta_info_t;
+
+typedef struct {
+	wifi_sta_info_t	sta[ESP_WIFI_MAX_CONN_NUM];
+	int		num;
+} wifi_sta_list_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT()	{ .magic = 0x1F2F3F4F }
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]);
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * Host-симулятор: мінімальний FreeRTOS поверх pthreads (host_sim/sim_freertos.c).
+ * 1 тік = 1 мс.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t		BaseType_t;
+typedef uint32_t	UBaseType_t;
+typedef uint32_t	TickType_t;
+typedef uint8_t		StackType_t;
+
+#define pdFALSE			((BaseType_t)0)
+#define pdTRUE			((BaseType_t)1)
+#define pdPASS			(pdTRUE)
+#define pdFAIL			(pdFALSE)
+#define errQUEUE_FULL		((BaseType_t)0)
+
+#define configTICK_RATE_HZ	CONFIG_FREERTOS_HZ
+#define portMAX_DELAY		((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS	((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)	((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(t)	((uint32_t)(((uint64_t)(t) * 1000U) / configTICK_RATE_HZ))
+#define tskNO_AFFINITY		((BaseType_t)0x7FFFFFFF)
+
+typedef struct {
+	pthread_mutex_t	mu;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED	{ .mu = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+void	sim_port_enter_critical(portMUX_TYPE *mux);
+void	sim_port_exit_critical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)		sim_port_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)		sim_port_exit_critical(mux)
+#define portENTER_CRITICAL_ISR(mux)	sim_port_enter_critical(mux)
+#define portEXIT_CRITICAL_ISR(mux)	sim_port_exit_critical(mux)
+#define taskENTER_CRITICAL(mux)		sim_port_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)		sim_port_exit_critical(mux)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sim_queue *QueueHandle_t;
+
+QueueHandle_t	xQueueCreate(UBaseType_t len, UBaseType_t item_size);
+void		vQueueDelete(QueueHandle_t q);
+BaseType_t	xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks);
+BaseType_t	xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t ticks);
+BaseType_t	xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks);
+BaseType_t	xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks);
+BaseType_t	xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks);
+UBaseType_t	uxQueueMessagesWaiting(QueueHandle_t q);
+UBaseType_t	uxQueueSpacesAvailable(QueueHandle_t q);
+BaseType_t	xQueueReset(QueueHandle_t q);
+
+#define xQueueSendFromISR(q, item, woken)	xQueueSend((q), (item), 0)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t	xSemaphoreCreateMutex(void);
+SemaphoreHandle_t	xSemaphoreCreateBinary(void);
+SemaphoreHandle_t	xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+BaseType_t		xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks);
+BaseType_t		xSemaphoreGive(SemaphoreHandle_t s);
+void			vSemaphoreDelete(SemaphoreHandle_t s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted,
+	eInvalid,
+} eTaskState;
+
+typedef struct {
+	TaskHandle_t	xHandle;
+	const char	*pcTaskName;
+	UBaseType_t	xTaskNumber;
+	eTaskState	eCurrentState;
+	UBaseType_t	uxCurrentPriority;
+	UBaseType_t	uxBasePriority;
+	uint32_t	ulRunTimeCounter;
+	StackType_t	*pxStackBase;
+	uint32_t	usStackHighWaterMark;
+	BaseType_t	xCoreID;
+} TaskStatus_t;
+
+BaseType_t	xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+			    void *arg, UBaseType_t prio, TaskHandle_t *out);
+BaseType_t	xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+					void *arg, UBaseType_t prio, TaskHandle_t *out, BaseType_t core);
+void		vTaskDelete(TaskHandle_t task);
+void		vTaskDelay(TickType_t ticks);
+void		vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+BaseType_t	xTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+TickType_t	xTaskGetTickCount(void);
+TaskHandle_t	xTaskGetCurrentTaskHandle(void);
+UBaseType_t	uxTaskGetSystemState(TaskStatus_t *arr, UBaseType_t arr_size, uint32_t *total_run_time);
+
+void		xTaskNotifyGive(TaskHandle_t task);
+uint32_t	ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+
+#define taskYIELD()	sched_yield()
+#include <sched.h>
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+// Значення за замовчуванням з main/Kconfig.projbuild (для host-симулятора)
+
+#define CONFIG_IDF_TARGET_LINUX			1
+#define CONFIG_FREERTOS_HZ			1000
+#define CONFIG_LOG_MAXIMUM_LEVEL		3
+
+#define CONFIG_MESH_TOPO_TREE			1
+#define CONFIG_MESH_TOPOLOGY			0
+#define CONFIG_MESH_MAX_LAYER			6
+#define CONFIG_MESH_CHANNEL			0
+#define CONFIG_MESH_ROUTER_SSID			"ROUTER_SSID"
+#define CONFIG_MESH_ROUTER_PASSWD		"ROUTER_PASSWD"
+#define CONFIG_WIFI_AUTH_WPA2_PSK		1
+#define CONFIG_MESH_AP_AUTHMODE			3
+#define CONFIG_MESH_AP_PASSWD			"MAP_PASSWD"
+#define CONFIG_MESH_AP_CONNECTIONS		6
+#define CONFIG_MESH_NON_MESH_AP_CONNECTIONS	0
+#define CONFIG_MESH_ROUTE_TABLE_SIZE		50
+
+#define CONFIG_MESH_TIME_SYNC_BURST		4
+#define CONFIG_MESH_TIME_SLEW_MAX_MS		500
+#define CONFIG_MESH_TIME_RELAY			1
+#define CONFIG_MESH_TIME_MAX_ERR_US		1000
+#define CONFIG_MESH_TIME_SYNC_MAX_X		32
+
+#define CONFIG_LEGACY_ROOT_TTL_MS		10000
+#define CONFIG_LEGACY_ROOT_BACKOFF_MIN_MS	50
+#define CONFIG_LEGACY_ROOT_BACKOFF_MAX_MS	2000
+#define CONFIG_LEGACY_ROOT_BATCH_MAX_BYTES	200
+#define CONFIG_LEGACY_ROOT_FLASH_STORE		1	// розділ є тільки з kpl_sim --flash-kb
+#define CONFIG_LEGACY_ROOT_FLASH_LABEL		"uplinkq"
+#define CONFIG_LEGACY_ROOT_FLASH_COMMIT_MS	1000
+#define CONFIG_LEGACY_ROOT_FLASH_DRAIN_PER_SEC	20
+
+#define CONFIG_MESH_CMD_TRACE_NODES		32
+#define CONFIG_MESH_TX_TELEMETRY_INFLIGHT	4
+#define CONFIG_MESH_TX_LOG_INFLIGHT		2
+#define CONFIG_MESH_TX_PACE			1
+#define CONFIG_MESH_TX_PACE_MIN_PPS		2
+#define CONFIG_MESH_TX_PACE_MAX_PPS		100
+#define CONFIG_MESH_TX_PACE_WINDOW_MS		100
+#ifndef KPL_SIM_PROTO_V1			// kpl_fw_v1 (kpl_sim --v1-nodes): прошивка без v2
+#define CONFIG_MESH_PROTO_V2			1
+#endif
+// CONFIG_MESH_PROTO_V2_CRC — default n
+#define CONFIG_MESH_PROTO_NODES			64
+
+#define CONFIG_POWLED_GPIOS			"33,25,26,27"	// у симуляторі 4 канали: обидва банки GPIO
+#define CONFIG_POWLED_AT_MAX_LEAD_MS		10000
+// CONFIG_POWLED_DIM — тільки в kpl_fw_dim (kpl_sim --dim)
+#define CONFIG_POWLED_DIM_FREQ_HZ		5000
+#define CONFIG_POWLED_FADE_MAX_MS		10000
+
+#define CONFIG_MESH_RX_BUF_SIZE			1024
+#define CONFIG_MESH_RX_POOL_SIZE		8
+#define CONFIG_MESH_RX_WORKERS			1
+#define CONFIG_MESH_LOG_BATCH_MAX_BYTES		1024
+#define CONFIG_MESH_LOG_BATCH_MAX_DELAY_MS	200
+#define CONFIG_MESH_LOG_RING_SLOTS		32
+#define CONFIG_MESH_LOG_RING_LINE_MAX		192
+#define CONFIG_LOG_RAM_RING_SIZE		4096
+#define CONFIG_MESH_LOG_RATE_LINES_PER_SEC	20
+#define CONFIG_MESH_LOG_RATE_BURST		40
+#define CONFIG_MESH_LOG_TAG_RATE_PER_SEC	10
+#define CONFIG_MESH_LOG_SUPPRESS_REPORT_MS	2000
+#define CONFIG_MESH_LOG_DEDUP			1
+#define CONFIG_MESH_LOG_LZ			1
@@ -0,0 +1,322 @@
+/*
+ * Мікробенчмарк вартості одного ESP_LOGI: старий ланцюжок vprintf-хуків
+ * (log_time_vprintf -> mesh_log_vprintf, кожен зі своїм vsnprintf і strftime)
+ * проти log_core (один рендер, кеш часу, sink'и UART + mesh), і окремо
+ * mesh-частину: vsnprintf у слот проти бінарного запису (log_binary.c; тут
+ * ID формату рахується через dladdr, на ESP32 це просто адреса).
+ *
+ * З CAPTURE (kpl_sim --capture, батч або бінарний режим без --log-lz) ще
+ * міряє log_lz на реальних фреймах: ступінь стиснення і CPU на байт.
+ *
+ * Старий ланцюжок відтворено тут дослівно (до log_core), відправку в mesh
+ * замінено копією в буфер — міряємо саме форматування.
+ *
+ *	./host_sim/build/kpl_log_bench [iterations] [CAPTURE]
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "log_binary.h"
+#include "log_core.h"
+#include "log_lz.h"
+#include "log_time_vprintf.h"
+#include "mesh_proto.h"
+
+#include "sim.h"
+time_t sim_time(time_t *t);
+
+static const char *TAG = "bench";
+
+static FILE		*s_null;
+static char		s_sink_buf[256];
+static volatile size_t	s_sink_bytes;
+
+/* -------------------------------------------------------------------------- */
+/*  Старий ланцюжок (baseline)                                                */
+/* -------------------------------------------------------------------------- */
+
+static vprintf_like_t	s_legacy_prev;
+
+static bool legacy_get_local_time_str(char *out, size_t out_sz)
+{
+	time_t now = 0;
+	struct tm tm_now;
+
+	now = sim_time(NULL);
+	localtime_r(&now, &tm_now);
+	if (tm_now.tm_year < (2020 - 1900)) return false;
+	return strftime(out, out_sz, "%Y-%m-%d %H:%M:%S", &tm_now) > 0;
+}
+
+static int legacy_time_vprintf(const char *fmt, va_list ap)
+{
+	char orig[256];
+	char out[320];
+	char ts[32];
+
+	va_list ap2;
+	va_copy(ap2, ap);
+	vsnprintf(orig, sizeof(orig), fmt, ap2);
+	va_end(ap2);
+
+	bool have_ts = legacy_get_local_time_str(ts, sizeof(ts));
+	char *p = strchr(orig, ')');
+	if (have_ts && p && p[1] == ' ') {
+		int head_len = (int)((p - orig) + 2);
+		snprintf(out, sizeof(out), "%.*s[%s] %s", head_len, orig, ts, orig + head_len);
+	} else {
+		strncpy(out, orig, sizeof(out) - 1);
+		out[sizeof(out) - 1] = '\0';
+	}
+
+	fputs(out, s_null);
+	return (int)strlen(out);
+}
+
+static void legacy_build_time_prefix(char *out, size_t out_sz)
+{
+	time_t now = sim_time(NULL);
+	struct tm tm_now;
+	localtime_r(&now, &tm_now);
+	if (strftime(out, out_sz, "[%Y-%m-%d %H:%M:%S] ", &tm_now) == 0) {
+		snprintf(out, out_sz, "[no-time] ");
+	}
+}
+
+static int legacy_mesh_vprintf(const char *fmt, va_list ap)
+{
+	va_list ap_copy;
+	va_copy(ap_copy, ap);
+	int ret = s_legacy_prev(fmt, ap_copy);
+	va_end(ap_copy);
+
+	char tprefix[40];
+	legacy_build_time_prefix(tprefix, sizeof(tprefix));
+
+	char stack_buf[128];
+	size_t copy_t = strnlen(tprefix, sizeof(tprefix));
+	memcpy(stack_buf, tprefix, copy_t);
+
+	va_list ap_copy2;
+	va_copy(ap_copy2, ap);
+	vsnprintf(stack_buf + copy_t, sizeof(stack_buf) - copy_t, fmt, ap_copy2);
+	va_end(ap_copy2);
+
+	// замість esp_mesh_send
+	strncpy(s_sink_buf, stack_buf, sizeof(s_sink_buf) - 1);
+	s_sink_bytes += strlen(s_sink_buf);
+	return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  log_core: mesh-подібний sink (копія в слот)                               */
+/* -------------------------------------------------------------------------- */
+
+static void copy_sink(void *ctx, const log_line_t *line)
+{
+	(void)ctx;
+	size_t n = line->len < sizeof(s_sink_buf) ? line->len : sizeof(s_sink_buf);
+	memcpy(s_sink_buf, line->text, n);
+	s_sink_bytes += n;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Тільки mesh-частина: рендер у слот vs бінарний запис                       */
+/* -------------------------------------------------------------------------- */
+
+static uint8_t	s_slot[192];
+
+static void fmt_text(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	s_sink_bytes += (size_t)vsnprintf((char *)s_slot, sizeof(s_slot), fmt, ap);
+	va_end(ap);
+}
+
+static void fmt_bin(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	s_sink_bytes += log_bin_encode(s_slot, sizeof(s_slot), 1760000000u, fmt, ap);
+	va_end(ap);
+}
+
+static double run_fmt(void (*fn)(const char *, ...), unsigned iters, size_t *bytes)
+{
+	static const uint8_t mac[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x05 };
+	struct timespec t0, t1;
+
+	s_sink_bytes = 0;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+	for (unsigned i = 0; i < iters; i++) {
+		fn(LOG_FORMAT(I, "RX TEXT from %02x:%02x:%02x:%02x:%02x:%02x: \"%s\" rssi=%d"),
+			i, TAG, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], "powled1", -(int)(i & 63));
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+
+	*bytes = s_sink_bytes / iters;
+	double ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+	return ns / iters;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  log_lz на захоплених фреймах                                              */
+/* -------------------------------------------------------------------------- */
+
+static double cpu_ns(const struct timespec *t0, const struct timespec *t1)
+{
+	return (double)(t1->tv_sec - t0->tv_sec) * 1e9 + (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+// data нестиснутого BATCH/BIN (повний або компактний заголовок), NULL => не батч
+static const uint8_t *frame_data(const uint8_t *pkt, size_t len, size_t *data_len, bool *bin)
+{
+	if (len < sizeof(mesh_log_batch_c_packet_t) || pkt[0] != MESH_PKT_MAGIC) return NULL;
+
+	uint8_t type = pkt[offsetof(mesh_pkt_hdr_t, type)];
+	size_t hdr = (type & MESH_LOG_TYPE_F_COMPACT) ? sizeof(mesh_log_batch_c_packet_t)
+						     : sizeof(mesh_log_batch_packet_t);
+	type &= ~MESH_LOG_TYPE_F_COMPACT;
+
+	if ((type != MESH_LOG_TYPE_BATCH && type != MESH_LOG_TYPE_BIN) || len <= hdr) return NULL;
+	*bin = (type == MESH_LOG_TYPE_BIN);
+	*data_len = len - hdr;
+	return pkt + hdr;
+}
+
+static int bench_lz(const char *path, unsigned reps)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "log_bench: can't read %s\n", path);
+		return 1;
+	}
+
+	static log_lz_state_t st;
+	uint8_t pkt[2048], out[2048], back[2048];
+	struct { uint64_t frames, raw, packed, stored; double enc_ns, dec_ns; } r[2];
+	memset(r, 0, sizeof(r));
+
+	uint8_t lb[2];
+	while (fread(lb, 1, 2, f) == 2) {
+		size_t len = lb[0] | lb[1] << 8;
+		if (len > sizeof(pkt) || fread(pkt, 1, len, f) != len) break;
+
+		size_t n;
+		bool bin;
+		const uint8_t *data = frame_data(pkt, len, &n, &bin);
+		if (!data) continue;
+
+		struct timespec t0, t1;
+		size_t c = 0;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+		for (unsigned i = 0; i < reps; i++) {
+			c = log_lz_compress(&st, out, sizeof(out), data, n);
+		}
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+		r[bin].enc_ns += cpu_ns(&t0, &t1) / reps;
+
+		if (c) {
+			int d = 0;
+			clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+			for (unsigned i = 0; i < reps; i++) {
+				d = log_lz_decompress(back, sizeof(back), out, c);
+			}
+			clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+			r[bin].dec_ns += cpu_ns(&t0, &t1) / reps;
+
+			if (d != (int)n || memcmp(back, data, n) != 0) {
+				fprintf(stderr, "log_bench: lz round trip mismatch\n");
+				fclose(f);
+				return 1;
+			}
+		} else {
+			r[bin].stored++;
+		}
+
+		r[bin].frames++;
+		r[bin].raw += n;
+		r[bin].packed += c ? c : n;
+	}
+	fclose(f);
+
+	printf("log_lz on %s (window %d B, chain %d, state %zu B):\n",
+		path, LOG_LZ_WINDOW, LOG_LZ_CHAIN, sizeof(st));
+	for (int b = 0; b < 2; b++) {
+		if (!r[b].frames) continue;
+		printf("  %-6s %4" PRIu64 " frames: %7" PRIu64 " -> %7" PRIu64 " B (%.1f%%, %" PRIu64 " stored)"
+		       ", encode %.1f ns/B, decode %.1f ns/B\n",
+			b ? "binary" : "text", r[b].frames, r[b].raw, r[b].packed,
+			100.0 * (double)r[b].packed / (double)r[b].raw, r[b].stored,
+			r[b].enc_ns / (double)r[b].raw, r[b].dec_ns / (double)r[b].raw);
+	}
+	return 0;
+}
+
+static double run(unsigned iters)
+{
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+	for (unsigned i = 0; i < iters; i++) {
+		ESP_LOGI(TAG, "bench line %u value=%s rssi=%d", i, "abcdef", -(int)(i & 63));
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+
+	double ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+	return ns / iters;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned iters = (argc > 1) ? (unsigned)strtoul(argv[1], NULL, 0) : 200000;
+
+	sim_core_init();
+	s_null = fopen("/dev/null", "w");
+
+	sim_node_t *n = &sim_nodes[0];
+	n->log_level = ESP_LOG_INFO;
+	n->uart = s_null;
+	sim_node_count = 1;
+	sim_cur = n;
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	sim_clock_set_us(n, (int64_t)now.tv_sec * 1000000 + now.tv_usec);
+
+	// 1) старий ланцюжок
+	esp_log_set_vprintf(legacy_time_vprintf);
+	s_legacy_prev = esp_log_set_vprintf(legacy_mesh_vprintf);
+	run(iters / 10);
+	double legacy_ns = run(iters);
+
+	// 2) log_core + UART sink + mesh-подібний sink
+	n->vprintf = NULL;
+	log_time_vprintf_start();
+	log_core_add_sink(copy_sink, NULL);
+	run(iters / 10);
+	double core_ns = run(iters);
+
+	size_t text_b, bin_b;
+	double text_ns = run_fmt(fmt_text, iters, &text_b);
+	double bin_ns = run_fmt(fmt_bin, iters, &bin_b);
+
+	printf("ESP_LOGI, %u iterations (host CPU time per line):\n", iters);
+	printf("  legacy vprintf chain : %8.1f ns\n", legacy_ns);
+	printf("  log_core single pass : %8.1f ns  (%.1f%% less)\n",
+		core_ns, 100.0 * (legacy_ns - core_ns) / legacy_ns);
+	printf("mesh path only (one line into a ring slot):\n");
+	printf("  vsnprintf text       : %8.1f ns, %3zu B\n", text_ns, text_b);
+	printf("  log_bin_encode       : %8.1f ns, %3zu B\n", bin_ns, bin_b);
+
+	if (argc > 2) return bench_lz(argv[2], 200);
+	return 0;
+}
@@ -0,0 +1,368 @@
+/*
+ * Декодер лог-пакетів з mesh (host).
+ *
+ * Читає пакети, які отримав root (формат --capture симулятора:
+ * { uint16_t len; data[len] }), і друкує строки логів. MESH_LOG_TYPE_BIN
+ * відновлюється за ELF прошивки: fmt_id — адреса формат-строки в образі
+ * (ESP32: app .elf; симулятор: libkpl_fw.so).
+ *
+ *	./host_sim/build/kpl_sim --nodes 7 --log-bin --capture /tmp/root.cap
+ *	./host_sim/build/kpl_log_decode host_sim/build/libkpl_fw.so /tmp/root.cap
+ */
+
+#include <elf.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_binary.h"
+#include "log_lz.h"
+#include "mesh_proto.h"
+
+typedef struct {
+	uint64_t	addr;
+	uint64_t	size;
+	uint64_t	off;
+} elf_sect_t;
+
+static uint8_t		*s_elf;
+static size_t		s_elf_len;
+static elf_sect_t	*s_sect;
+static int		s_sect_n;
+
+static struct {
+	uint64_t	frames;
+	uint64_t	text_lines;
+	uint64_t	text_bytes;
+	uint64_t	bin_recs;
+	uint64_t	bin_bytes;
+	uint64_t	bin_bad;
+	uint64_t	lz_frames;
+	uint64_t	lz_raw;		// розпакованих байт data
+	uint64_t	lz_bad;
+} s_st;
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+	FILE *f = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+	if (!f) return NULL;
+
+	size_t cap = 1 << 16, n = 0;
+	uint8_t *buf = malloc(cap);
+	size_t r;
+	while (buf && (r = fread(buf + n, 1, cap - n, f)) > 0) {
+		n += r;
+		if (n == cap) buf = realloc(buf, cap *= 2);
+	}
+	if (f != stdin) fclose(f);
+
+	*len = n;
+	return buf;
+}
+
+// Тільки секції, що займають місце в образі (SHF_ALLOC, не NOBITS)
+static bool elf_load(const char *path)
+{
+	s_elf = read_file(path, &s_elf_len);
+	if (!s_elf || s_elf_len < EI_NIDENT || memcmp(s_elf, ELFMAG, SELFMAG) != 0) {
+		return false;
+	}
+
+	if (s_elf[EI_CLASS] == ELFCLASS32) {
+		const Elf32_Ehdr *eh = (const Elf32_Ehdr *)s_elf;
+		if (eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf32_Shdr) > s_elf_len) return false;
+
+		const Elf32_Shdr *sh = (const Elf32_Shdr *)(s_elf + eh->e_shoff);
+		s_sect = calloc(eh->e_shnum, sizeof(*s_sect));
+		for (int i = 0; i < eh->e_shnum; i++) {
+			if (!(sh[i].sh_flags & SHF_ALLOC) || sh[i].sh_type == SHT_NOBITS) continue;
+			s_sect[s_sect_n++] = (elf_sect_t){ sh[i].sh_addr, sh[i].sh_size, sh[i].sh_offset };
+		}
+	} else if (s_elf[EI_CLASS] == ELFCLASS64) {
+		const Elf64_Ehdr *eh = (const Elf64_Ehdr *)s_elf;
+		if (eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > s_elf_len) return false;
+
+		const Elf64_Shdr *sh = (const Elf64_Shdr *)(s_elf + eh->e_shoff);
+		s_sect = calloc(eh->e_shnum, sizeof(*s_sect));
+		for (int i = 0; i < eh->e_shnum; i++) {
+			if (!(sh[i].sh_flags & SHF_ALLOC) || sh[i].sh_type == SHT_NOBITS) continue;
+			s_sect[s_sect_n++] = (elf_sect_t){ sh[i].sh_addr, sh[i].sh_size, sh[i].sh_offset };
+		}
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static const char *elf_str(uint32_t addr)
+{
+	for (int i = 0; i < s_sect_n; i++) {
+		const elf_sect_t *s = &s_sect[i];
+		if (addr < s->addr || addr >= s->addr + s->size) continue;
+
+		uint64_t off = s->off + (addr - s->addr);
+		uint64_t lim = s->off + s->size;
+		if (lim > s_elf_len) return NULL;
+		if (!memchr(s_elf + off, '\0', lim - off)) return NULL;
+		return (const char *)s_elf + off;
+	}
+	return NULL;
+}
+
+static void print_line(const char *tag, const char *line, size_t len)
+{
+	while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+	printf("%-16s| %.*s\n", tag, (int)len, line);
+}
+
+// Час — як у log_core: "[YYYY-MM-DD HH:MM:SS] " після "I (123) "
+static void print_bin(const char *tag, const uint8_t *rec, size_t len)
+{
+	uint32_t id, epoch;
+	size_t hdr = log_bin_parse_hdr(rec, len, &id, &epoch);
+	if (!hdr) {
+		s_st.bin_bad++;
+		return;
+	}
+
+	const char *fmt = elf_str(id);
+	char text[512];
+	if (!fmt || log_bin_render(text, sizeof(text), fmt, rec + hdr, len - hdr) < 0) {
+		s_st.bin_bad++;
+		printf("%-16s| <fmt 0x%08" PRIx32 ": %zu arg bytes, no match in ELF>\n", tag, id, len - hdr);
+		return;
+	}
+
+	const char *p = strchr(text, ')');
+	if (epoch && p && p[1] == ' ') {
+		char ts[32];
+		time_t t = (time_t)epoch;
+		struct tm tm_t;
+		localtime_r(&t, &tm_t);
+		strftime(ts, sizeof(ts), "[%Y-%m-%d %H:%M:%S] ", &tm_t);
+
+		char out[600];
+		int head = (int)(p - text) + 2;
+		int n = snprintf(out, sizeof(out), "%.*s%s%s", head, text, ts, text + head);
+		print_line(tag, out, (size_t)n < sizeof(out) ? (size_t)n : sizeof(out) - 1);
+	} else {
+		print_line(tag, text, strlen(text));
+	}
+}
+
+// node_id -> тег з MESH_LOG_TYPE_NODEINFO (для компактних пакетів)
+static struct {
+	uint16_t	id;
+	char		tag[17];
+} s_nodes[256];
+static int		s_nodes_n;
+
+static void node_tag(uint16_t id, char tag[17])
+{
+	for (int i = 0; i < s_nodes_n; i++) {
+		if (s_nodes[i].id == id) {
+			memcpy(tag, s_nodes[i].tag, 17);
+			return;
+		}
+	}
+	snprintf(tag, 17, "id:%04x", id);
+}
+
+static void decode_nodeinfo(const uint8_t *pkt, size_t len)
+{
+	if (len < offsetof(mesh_nodeinfo_packet_t, node_id)) return;
+	const mesh_nodeinfo_packet_t *p = (const mesh_nodeinfo_packet_t *)pkt;
+	uint16_t id = len >= sizeof(*p) ? p->node_id : MESH_LOG_NODE_ID(p->h.src_mac);
+
+	int i = 0;
+	while (i < s_nodes_n && s_nodes[i].id != id) i++;
+	if (i == s_nodes_n) {
+		if (s_nodes_n == (int)(sizeof(s_nodes) / sizeof(s_nodes[0]))) return;
+		s_nodes_n++;
+	}
+	s_nodes[i].id = id;
+	memcpy(s_nodes[i].tag, p->tag, sizeof(p->tag));
+	s_nodes[i].tag[sizeof(p->tag)] = '\0';
+}
+
+// data: count x { uint8_t len; ... }
+static void decode_batch(uint8_t type, const char *tag, unsigned count,
+			 const uint8_t *cur, const uint8_t *end, size_t len)
+{
+	uint8_t raw[4096];
+	if (type & MESH_LOG_TYPE_F_LZ) {
+		int n = log_lz_decompress(raw, sizeof(raw), cur, (size_t)(end - cur));
+		if (n < 0) {
+			s_st.lz_bad++;
+			return;
+		}
+		s_st.lz_frames++;
+		s_st.lz_raw += (uint64_t)n;
+		cur = raw;
+		end = raw + n;
+		type &= ~MESH_LOG_TYPE_F_LZ;
+	}
+
+	for (unsigned i = 0; i < count && cur < end && cur + 1 + cur[0] <= end; i++) {
+		if (type == MESH_LOG_TYPE_BATCH) {
+			s_st.text_lines++;
+			print_line(tag, (const char *)cur + 1, cur[0]);
+		} else {
+			s_st.bin_recs++;
+			print_bin(tag, cur + 1, cur[0]);
+		}
+		cur += 1 + cur[0];
+	}
+	if (type == MESH_LOG_TYPE_BATCH) s_st.text_bytes += len;
+	else s_st.bin_bytes += len;
+}
+
+static void decode_compact(const uint8_t *pkt, size_t len)
+{
+	if (len < sizeof(mesh_log_compact_hdr_t)) return;
+
+	const mesh_log_compact_hdr_t *h = (const mesh_log_compact_hdr_t *)pkt;
+	uint8_t type = h->type & ~MESH_LOG_TYPE_F_COMPACT;
+	char tag[17];
+	node_tag(h->node_id, tag);
+
+	switch (type) {
+	case MESH_LOG_TYPE_LINE: {
+		const mesh_log_line_c_packet_t *p = (const mesh_log_line_c_packet_t *)pkt;
+		s_st.text_lines++;
+		s_st.text_bytes += len;
+		print_line(tag, p->line, len - sizeof(*p));
+		break;
+	}
+	case MESH_LOG_TYPE_BATCH:
+	case MESH_LOG_TYPE_BIN:
+	case MESH_LOG_TYPE_BATCH | MESH_LOG_TYPE_F_LZ:
+	case MESH_LOG_TYPE_BIN | MESH_LOG_TYPE_F_LZ: {
+		if (len < sizeof(mesh_log_batch_c_packet_t)) return;
+		const mesh_log_batch_c_packet_t *p = (const mesh_log_batch_c_packet_t *)pkt;
+		decode_batch(type, tag, p->count, p->data, pkt + len, len);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+// Пакет із заголовком v2 (mesh_hdr.c, напр. NODEINFO) — назад у v1, як mesh_hdr_rx.
+// Адреси відправника в захопленні нема: src_mac нульовий. CRC не перевіряємо.
+static size_t v2_expand(const uint8_t *pkt, size_t len, uint8_t *out, size_t cap)
+{
+	size_t end = len;
+	if (pkt[0] & MESH_PKT_V2_F_CRC) {
+		if (len < MESH_PKT_V2_HDR_MIN + MESH_PKT_V2_CRC_LEN) return 0;
+		end -= MESH_PKT_V2_CRC_LEN;
+	}
+	if (end < MESH_PKT_V2_HDR_MIN) return 0;
+
+	size_t n = 4;
+	uint16_t seq = pkt[n] & 0x7F;
+	if (pkt[n++] & 0x80) {
+		if (n >= end) return 0;
+		seq |= (uint16_t)(pkt[n++] << 7);
+	}
+	if (sizeof(mesh_pkt_hdr_t) + end - n > cap) return 0;
+
+	mesh_pkt_hdr_t *h = (mesh_pkt_hdr_t *)out;
+	memset(h, 0, sizeof(*h));
+	h->magic = MESH_PKT_MAGIC;
+	h->version = MESH_PKT_VERSION;
+	h->type = pkt[1];
+	h->counter = seq;
+	memcpy(out + sizeof(*h), pkt + n, end - n);
+	return sizeof(*h) + end - n;
+}
+
+static void decode_pkt(const uint8_t *pkt, size_t len)
+{
+	uint8_t v1[2048];
+	if (len >= 1 && (pkt[0] & MESH_PKT_V2_MARK_MASK) == MESH_PKT_V2_MARK) {
+		len = v2_expand(pkt, len, v1, sizeof(v1));
+		pkt = v1;
+	}
+	if (len < 3 || pkt[0] != MESH_PKT_MAGIC) return;
+	if (pkt[offsetof(mesh_pkt_hdr_t, type)] & MESH_LOG_TYPE_F_COMPACT) {
+		decode_compact(pkt, len);
+		return;
+	}
+	if (len < sizeof(mesh_pkt_hdr_t)) return;
+
+	const mesh_pkt_hdr_t *h = (const mesh_pkt_hdr_t *)pkt;
+	char tag[17] = "";
+
+	switch (h->type) {
+	case MESH_LOG_TYPE_NODEINFO:
+		decode_nodeinfo(pkt, len);
+		break;
+	case MESH_LOG_TYPE_LINE: {
+		// старий формат — фіксований sizeof, новий — тільки використані байти
+		if (len < offsetof(mesh_log_line_packet_t, line)) return;
+		const mesh_log_line_packet_t *p = (const mesh_log_line_packet_t *)pkt;
+		memcpy(tag, p->tag, sizeof(p->tag));
+		size_t n = strnlen(p->line, len - offsetof(mesh_log_line_packet_t, line));
+		s_st.text_lines++;
+		s_st.text_bytes += len;
+		print_line(tag, p->line, n);
+		break;
+	}
+	case MESH_LOG_TYPE_BATCH:
+	case MESH_LOG_TYPE_BIN:
+	case MESH_LOG_TYPE_BATCH | MESH_LOG_TYPE_F_LZ:
+	case MESH_LOG_TYPE_BIN | MESH_LOG_TYPE_F_LZ: {
+		if (len < sizeof(mesh_log_batch_packet_t)) return;
+		const mesh_log_batch_packet_t *p = (const mesh_log_batch_packet_t *)pkt;
+		memcpy(tag, p->tag, sizeof(p->tag));
+		decode_batch(h->type, tag, p->count, p->data, pkt + len, len);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s FIRMWARE.elf|libkpl_fw.so CAPTURE|-\n", argv[0]);
+		return 2;
+	}
+
+	if (!elf_load(argv[1])) {
+		fprintf(stderr, "log_decode: can't read ELF %s\n", argv[1]);
+		return 1;
+	}
+
+	size_t len;
+	uint8_t *cap = read_file(argv[2], &len);
+	if (!cap) {
+		fprintf(stderr, "log_decode: can't read %s\n", argv[2]);
+		return 1;
+	}
+
+	for (size_t off = 0; off + 2 <= len; ) {
+		size_t n = cap[off] | cap[off + 1] << 8;
+		off += 2;
+		if (off + n > len) break;
+
+		s_st.frames++;
+		decode_pkt(cap + off, n);
+		off += n;
+	}
+
+	fprintf(stderr, "log_decode: %" PRIu64 " pkts; text %" PRIu64 " lines in %" PRIu64 " B"
+		"; binary %" PRIu64 " records in %" PRIu64 " B (%" PRIu64 " undecoded)\n",
+		s_st.frames, s_st.text_lines, s_st.text_bytes, s_st.bin_recs, s_st.bin_bytes, s_st.bin_bad);
+	if (s_st.lz_frames || s_st.lz_bad) {
+		fprintf(stderr, "log_decode: %" PRIu64 " compressed frames, %" PRIu64 " B data unpacked"
+			" (%" PRIu64 " corrupt)\n", s_st.lz_frames, s_st.lz_raw, s_st.lz_bad);
+	}
+	return 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ * Внутрішній API host-симулятора (не для прошивки).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "esp_event.h"
+
+#define SIM_MAX_NODES		64
+#define SIM_RXQ_LEN		32	// як RX-черга esp-mesh за замовчуванням
+#define SIM_TXQ_LEN		32
+
+typedef struct sim_pkt sim_pkt_t;
+
+typedef struct {
+	uint32_t	latency_us;	// затримка від дитини до батька (і назад)
+	uint32_t	jitter_us;
+	uint32_t	loss_ppm;	// ймовірність втрати на хопі, 1e-6
+	uint64_t	rng;		// свій PRNG на лінк => детерміновані втрати
+	int64_t		busy_up_us;	// --link-kbps: лінк зайнятий передачею до цього часу
+	int64_t		busy_down_us;
+} sim_link_t;
+
+typedef struct sim_node {
+	int		id;
+	int		parent;		// -1 для root
+	int		layer;
+	uint8_t		mac[6];
+
+	void		*dl;
+	char		so_path[256];
+
+	FILE		*uart;
+	vprintf_like_t	vprintf;
+	esp_log_level_t	log_level;
+
+	esp_event_handler_t mesh_handler;
+	void		*mesh_handler_arg;
+
+	sim_link_t	uplink;		// лінк до батька
+	int64_t		flap_period_us;	// --flap: батько зникає на flap_down_us кожні flap_period_us
+	int64_t		flap_down_us;
+
+	uint8_t		*flash;		// --flash-kb: розділ даних (esp_partition_*)
+	uint32_t	flash_size;
+
+	// RX-черга "драйвера" mesh
+	pthread_mutex_t	mu;
+	pthread_cond_t	cv;
+	sim_pkt_t	*rxq[SIM_RXQ_LEN];
+	int		rxq_head;
+	int		rxq_count;
+	int		tx_pending;
+
+	// годинник реального часу ноди
+	bool		clk_valid;
+	int64_t		clk_base_us;	// epoch (мкс) на момент clk_mono_us
+	int64_t		clk_mono_us;
+	double		clk_drift_ppm;
+	int64_t		clk_slew_us;	// adjtime: корекція, що розтягується з clk_mono_us
+
+	// статистика
+	uint64_t	tx_pkts;
+	uint64_t	tx_bytes;
+	uint64_t	tx_full;
+	uint64_t	rx_pkts;
+	uint64_t	rx_bytes;
+	uint64_t	lost;
+	uint64_t	rxq_drops;
+	uint64_t	tx_disc;	// esp_mesh_send -> ESP_ERR_MESH_DISCONNECTED (--flap)
+	int		rxq_max;
+	uint64_t	log_lines;
+	uint64_t	log_ns;
+	uint64_t	gpio_writes;
+	int64_t		gpio_last_us;	// sim_mono_us() останнього запису GPIO
+	uint64_t	hal_writes;	// powled_hal_write()
+	uint64_t	hal_pins;	// powled_hal_init()
+	uint64_t	hal_fades;	// powled_hal_dim()
+	uint64_t	hal_fade_waits;	// ... на каналі ще йшов fade (LEDC-драйвер чекав би)
+} sim_node_t;
+
+extern __thread sim_node_t	*sim_cur;
+extern sim_node_t		sim_nodes[SIM_MAX_NODES];
+extern int			sim_node_count;
+
+void		sim_core_init(void);
+int64_t		sim_mono_us(void);
+void		sim_mono_to_timespec(int64_t mono_us, struct timespec *ts);	// для CLOCK_MONOTONIC
+uint64_t	sim_rand_next(uint64_t *state);
+
+void		sim_mesh_start(void);
+void		sim_mesh_node_init(sim_node_t *n);
+int		sim_mesh_find_mac(const uint8_t mac[6]);
+void		sim_mesh_post_event(sim_node_t *n, int32_t event_id, void *event_data);
+void		sim_mesh_set_capture(FILE *f);	// до sim_mesh_start()
+extern uint32_t	sim_link_kbps;			// 0 — лінк без обмеження швидкості
+
+uint64_t	sim_gpio_out(sim_node_t *n);	// вихідні рівні, біт n = GPIOn
+uint32_t	sim_dim_duty(sim_node_t *n, int ch);	// LEDC duty каналу зараз (з урахуванням fade)
+
+int64_t		sim_clock_now_us(sim_node_t *n);
+void		sim_clock_set_us(sim_node_t *n, int64_t epoch_us);
@@ -0,0 +1,51 @@
+/*
+ * Host-симулятор: спільний стан (ноди, час, PRNG).
+ */
+
+#include <dlfcn.h>
+#include <time.h>
+
+#include "sim.h"
+
+__thread sim_node_t	*sim_cur = NULL;
+sim_node_t		sim_nodes[SIM_MAX_NODES];
+int			sim_node_count = 0;
+
+static int64_t		s_t0_ns;
+
+void sim_core_init(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	s_t0_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int64_t sim_mono_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec - s_t0_ns) / 1000;
+}
+
+void sim_mono_to_timespec(int64_t mono_us, struct timespec *ts)
+{
+	int64_t ns = s_t0_ns + mono_us * 1000;
+	ts->tv_sec = (time_t)(ns / 1000000000LL);
+	ts->tv_nsec = (long)(ns % 1000000000LL);
+}
+
+// splitmix64
+uint64_t sim_rand_next(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+unsigned sim_fmt_id(const void *fmt)
+{
+	Dl_info info;
+	if (!dladdr(fmt, &info) || !info.dli_fbase) return 0;
+	return (unsigned)((uintptr_t)fmt - (uintptr_t)info.dli_fbase);
+}
@@ -0,0 +1,652 @@
+/*
+ * Host-симулятор: esp_log / esp_wifi / esp_event / esp_netif / nvs / gpio / flash,
+ * а також "UART" і годинник реального часу кожної віртуальної ноди.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_mesh.h"
+#include "nvs_flash.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "driver/gpio.h"
+#include "powled_hal.h"
+#include "esp_timer.h"
+
+#include "sim.h"
+
+#define SIM_LOG_TAGS	8
+
+typedef struct {
+	char		tag[24];
+	esp_log_level_t	level;
+} sim_log_tag_t;
+
+static sim_log_tag_t	s_log_tags[SIM_MAX_NODES][SIM_LOG_TAGS];
+static uint64_t		s_gpio_level[SIM_MAX_NODES];	// як OUT/OUT1: біт n = GPIOn
+
+struct esp_netif_obj {
+	int	dummy;
+};
+
+static struct esp_netif_obj	s_netif;
+
+/* -------------------------------------------------------------------------- */
+/*  esp_err                                                                   */
+/* -------------------------------------------------------------------------- */
+
+const char *esp_err_to_name(esp_err_t code)
+{
+	switch (code) {
+	case ESP_OK:			return "ESP_OK";
+	case ESP_FAIL:			return "ESP_FAIL";
+	case ESP_ERR_NO_MEM:		return "ESP_ERR_NO_MEM";
+	case ESP_ERR_INVALID_ARG:	return "ESP_ERR_INVALID_ARG";
+	case ESP_ERR_INVALID_STATE:	return "ESP_ERR_INVALID_STATE";
+	case ESP_ERR_INVALID_SIZE:	return "ESP_ERR_INVALID_SIZE";
+	case ESP_ERR_NOT_FOUND:		return "ESP_ERR_NOT_FOUND";
+	case ESP_ERR_NOT_SUPPORTED:	return "ESP_ERR_NOT_SUPPORTED";
+	case ESP_ERR_TIMEOUT:		return "ESP_ERR_TIMEOUT";
+	case ESP_ERR_INVALID_RESPONSE:	return "ESP_ERR_INVALID_RESPONSE";
+	case ESP_ERR_INVALID_CRC:	return "ESP_ERR_INVALID_CRC";
+	case ESP_ERR_INVALID_VERSION:	return "ESP_ERR_INVALID_VERSION";
+	case ESP_ERR_MESH_EXCEED_MTU:	return "ESP_ERR_MESH_EXCEED_MTU";
+	case ESP_ERR_MESH_TIMEOUT:	return "ESP_ERR_MESH_TIMEOUT";
+	case ESP_ERR_MESH_ARGUMENT:	return "ESP_ERR_MESH_ARGUMENT";
+	case ESP_ERR_MESH_DISCONNECTED:	return "ESP_ERR_MESH_DISCONNECTED";
+	case ESP_ERR_MESH_QUEUE_FULL:	return "ESP_ERR_MESH_QUEUE_FULL";
+	case ESP_ERR_MESH_NO_ROUTE_FOUND: return "ESP_ERR_MESH_NO_ROUTE_FOUND";
+	default:			return "UNKNOWN ERROR";
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/*  "UART" і годинник ноди                                                    */
+/* -------------------------------------------------------------------------- */
+
+FILE *sim_node_stdout(void)
+{
+	return (sim_cur && sim_cur->uart) ? sim_cur->uart : stdout;
+}
+
+// Як adjtime() в ESP-IDF: корекція йде зі швидкістю 1/64 від ходу годинника
+#define SIM_ADJTIME_SHIFT	6
+
+static int64_t slew_done(const sim_node_t *n, int64_t dt)
+{
+	int64_t max = dt >> SIM_ADJTIME_SHIFT;
+	if (n->clk_slew_us >= 0) return n->clk_slew_us < max ? n->clk_slew_us : max;
+	return -n->clk_slew_us < max ? n->clk_slew_us : -max;
+}
+
+int64_t sim_clock_now_us(sim_node_t *n)
+{
+	int64_t mono = sim_mono_us();
+	int64_t dt = mono - n->clk_mono_us;
+	return n->clk_base_us + dt + (int64_t)((double)dt * n->clk_drift_ppm / 1e6) + slew_done(n, dt);
+}
+
+void sim_clock_set_us(sim_node_t *n, int64_t epoch_us)
+{
+	n->clk_mono_us = sim_mono_us();
+	n->clk_base_us = epoch_us;
+	n->clk_slew_us = 0;
+	n->clk_valid = true;
+}
+
+time_t sim_time(time_t *t)
+{
+	time_t v = sim_cur ? (time_t)(sim_clock_now_us(sim_cur) / 1000000) : time(NULL);
+	if (t) *t = v;
+	return v;
+}
+
+int sim_gettimeofday(struct timeval *tv, void *tz)
+{
+	(void)tz;
+	if (!sim_cur) return gettimeofday(tv, NULL);
+
+	int64_t us = sim_clock_now_us(sim_cur);
+	tv->tv_sec = (time_t)(us / 1000000);
+	tv->tv_usec = (suseconds_t)(us % 1000000);
+	return 0;
+}
+
+int sim_settimeofday(const struct timeval *tv, const void *tz)
+{
+	(void)tz;
+	if (!sim_cur || !tv) return -1;
+
+	sim_clock_set_us(sim_cur, (int64_t)tv->tv_sec * 1000000 + tv->tv_usec);
+	return 0;
+}
+
+int sim_adjtime(const struct timeval *delta, struct timeval *olddelta)
+{
+	if (!sim_cur) return -1;
+
+	sim_node_t *n = sim_cur;
+	int64_t mono = sim_mono_us();
+	int64_t now = sim_clock_now_us(n);
+	int64_t left = n->clk_slew_us - slew_done(n, mono - n->clk_mono_us);
+
+	if (olddelta) {
+		olddelta->tv_sec = (time_t)(left / 1000000);
+		olddelta->tv_usec = (suseconds_t)(left % 1000000);
+	}
+	if (delta) {
+		// нова корекція замінює залишок старої (як у newlib/ESP-IDF)
+		n->clk_base_us = now;
+		n->clk_mono_us = mono;
+		n->clk_slew_us = (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+	}
+	return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  esp_log                                                                   */
+/* -------------------------------------------------------------------------- */
+
+static int default_vprintf(const char *fmt, va_list ap)
+{
+	return vfprintf(sim_node_stdout(), fmt, ap);
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+	sim_node_t *n = sim_cur;
+	vprintf_like_t prev = n->vprintf ? n->vprintf : default_vprintf;
+	n->vprintf = func;
+	return prev;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+	sim_node_t *n = sim_cur;
+	if (!n || !tag) return;
+
+	if (strcmp(tag, "*") == 0) {
+		n->log_level = level;
+		return;
+	}
+
+	sim_log_tag_t *slot = NULL;
+	for (int i = 0; i < SIM_LOG_TAGS; i++) {
+		sim_log_tag_t *e = &s_log_tags[n->id][i];
+		if (strcmp(e->tag, tag) == 0) {
+			slot = e;
+			break;
+		}
+		if (!slot && e->tag[0] == '\0') slot = e;
+	}
+	if (!slot) return;
+
+	strncpy(slot->tag, tag, sizeof(slot->tag) - 1);
+	slot->level = level;
+}
+
+esp_log_level_t esp_log_level_get(const char *tag)
+{
+	sim_node_t *n = sim_cur;
+	if (!n) return ESP_LOG_INFO;
+
+	for (int i = 0; tag && i < SIM_LOG_TAGS; i++) {
+		const sim_log_tag_t *e = &s_log_tags[n->id][i];
+		if (e->tag[0] && strcmp(e->tag, tag) == 0) return e->level;
+	}
+	return n->log_level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+	return (uint32_t)(sim_mono_us() / 1000);
+}
+
+void esp_log_writev(esp_log_level_t level, const char *tag, const char *format, va_list args)
+{
+	(void)level;
+	(void)tag;
+
+	sim_node_t *n = sim_cur;
+	vprintf_like_t fn = (n && n->vprintf) ? n->vprintf : default_vprintf;
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+	fn(format, args);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+
+	if (n) {
+		__atomic_add_fetch(&n->log_lines, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&n->log_ns,
+			(uint64_t)((t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec)),
+			__ATOMIC_RELAXED);
+	}
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	esp_log_writev(level, tag, format, ap);
+	va_end(ap);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  system / wifi / event / netif / nvs                                       */
+/* -------------------------------------------------------------------------- */
+
+uint32_t esp_get_free_heap_size(void)		{ return 200 * 1024; }
+uint32_t esp_get_minimum_free_heap_size(void)	{ return 180 * 1024; }
+void esp_restart(void)				{ abort(); }
+
+uint32_t esp_random(void)
+{
+	static uint64_t seed = 0x9E3779B97F4A7C15ULL;
+	return (uint32_t)(sim_rand_next(&seed) >> 32);
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)	{ (void)config; return ESP_OK; }
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)		{ (void)storage; return ESP_OK; }
+esp_err_t esp_wifi_start(void)					{ return ESP_OK; }
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6])
+{
+	if (!sim_cur || !mac) return ESP_ERR_INVALID_ARG;
+	memcpy(mac, sim_cur->mac, 6);
+	if (ifx == WIFI_IF_AP) mac[5]++;
+	return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default(void)	{ return ESP_OK; }
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+				     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+	(void)event_id;
+	if (!sim_cur || event_base != MESH_EVENT) return ESP_OK;
+
+	sim_cur->mesh_handler = event_handler;
+	sim_cur->mesh_handler_arg = event_handler_arg;
+	return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)	{ return ESP_OK; }
+
+esp_err_t esp_netif_create_default_wifi_mesh_netifs(esp_netif_t **p_netif_sta, esp_netif_t **p_netif_ap)
+{
+	if (p_netif_sta) *p_netif_sta = &s_netif;
+	if (p_netif_ap) *p_netif_ap = &s_netif;
+	return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *esp_netif)	{ (void)esp_netif; return ESP_OK; }
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *esp_netif)	{ (void)esp_netif; return ESP_OK; }
+
+esp_err_t nvs_flash_init(void)	{ return ESP_OK; }
+
+/* -------------------------------------------------------------------------- */
+/*  gpio                                                                      */
+/* -------------------------------------------------------------------------- */
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+	return cfg ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+	if (!sim_cur || gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+	uint64_t bit = 1ULL << gpio_num;
+	uint64_t *reg = &s_gpio_level[sim_cur->id];
+	if (level) __atomic_or_fetch(reg, bit, __ATOMIC_RELAXED);
+	else __atomic_and_fetch(reg, ~bit, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&sim_cur->gpio_writes, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&sim_cur->gpio_last_us, sim_mono_us(), __ATOMIC_RELAXED);
+	return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+	if (!sim_cur || gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) return 0;
+	return (int)((__atomic_load_n(&s_gpio_level[sim_cur->id], __ATOMIC_RELAXED) >> gpio_num) & 1);
+}
+
+uint64_t sim_gpio_out(sim_node_t *n)
+{
+	return __atomic_load_n(&s_gpio_level[n->id], __ATOMIC_RELAXED);
+}
+
+/*
+ * powled_hal (main/powled_hal.h): замість W1TS/W1TC — один CAS по всіх пінах
+ * ноди, тож спостерігач (sim_gpio_out) ніколи не бачить частину каналів
+ * перемкнутою. Рахуємо виклики окремо від gpio_set_level.
+ */
+void powled_hal_init(uint64_t pins)
+{
+	if (!sim_cur) return;
+
+	sim_cur->hal_pins = pins;
+	__atomic_and_fetch(&s_gpio_level[sim_cur->id], ~pins, __ATOMIC_RELAXED);
+}
+
+void powled_hal_write(uint64_t set, uint64_t clr)
+{
+	if (!sim_cur) return;
+
+	uint64_t *reg = &s_gpio_level[sim_cur->id];
+	uint64_t v = __atomic_load_n(reg, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(reg, &v, (v | set) & ~clr, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+
+	__atomic_add_fetch(&sim_cur->hal_writes, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&sim_cur->gpio_last_us, sim_mono_us(), __ATOMIC_RELAXED);
+}
+
+/*
+ * powled_hal_dim: LEDC з лінійним fade. Як драйвер IDF, новий fade на каналі,
+ * де ще йде попередній, чекає його кінця — такі виклики рахуємо (hal_fade_waits),
+ * powled_fade.c має їх не допускати.
+ */
+typedef struct {
+	uint32_t	from;
+	uint32_t	to;
+	int64_t		start_us;
+	uint32_t	ms;
+	uint8_t		gpio;
+} sim_fade_t;
+
+static sim_fade_t	s_fade[SIM_MAX_NODES][8];
+static pthread_mutex_t	s_fade_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t fade_duty(const sim_fade_t *f, int64_t now)
+{
+	int64_t len = (int64_t)f->ms * 1000;
+	if (now - f->start_us >= len) return f->to;
+	int64_t d = ((int64_t)f->to - (int64_t)f->from) * (now - f->start_us) / len;
+	return (uint32_t)((int64_t)f->from + d);
+}
+
+void powled_hal_dim_init(const uint8_t *gpio, uint8_t count)
+{
+	if (!sim_cur) return;
+
+	uint64_t pins = 0;
+	for (uint8_t ch = 0; ch < count; ch++) pins |= 1ULL << gpio[ch];
+	powled_hal_init(pins);
+
+	pthread_mutex_lock(&s_fade_mu);
+	memset(s_fade[sim_cur->id], 0, sizeof(s_fade[0]));
+	for (uint8_t ch = 0; ch < count && ch < 8; ch++) s_fade[sim_cur->id][ch].gpio = gpio[ch];
+	pthread_mutex_unlock(&s_fade_mu);
+}
+
+void powled_hal_dim(uint8_t ch, uint32_t duty, uint32_t fade_ms)
+{
+	if (!sim_cur || ch >= 8) return;
+
+	sim_fade_t *f = &s_fade[sim_cur->id][ch];
+	pthread_mutex_lock(&s_fade_mu);
+	int64_t end = f->start_us + (int64_t)f->ms * 1000;
+	pthread_mutex_unlock(&s_fade_mu);
+
+	int64_t now = sim_mono_us();
+	if (now < end) {
+		__atomic_add_fetch(&sim_cur->hal_fade_waits, 1, __ATOMIC_RELAXED);
+		usleep((useconds_t)(end - now));
+		now = sim_mono_us();
+	}
+
+	pthread_mutex_lock(&s_fade_mu);
+	f->from = fade_duty(f, now);
+	f->to = duty;
+	f->start_us = now;
+	f->ms = fade_ms;
+	pthread_mutex_unlock(&s_fade_mu);
+
+	// "рівень" піна — чи світить канал після переходу
+	uint64_t bit = 1ULL << f->gpio;
+	if (duty) __atomic_or_fetch(&s_gpio_level[sim_cur->id], bit, __ATOMIC_RELAXED);
+	else __atomic_and_fetch(&s_gpio_level[sim_cur->id], ~bit, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&sim_cur->hal_fades, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&sim_cur->gpio_last_us, now, __ATOMIC_RELAXED);
+}
+
+uint32_t sim_dim_duty(sim_node_t *n, int ch)
+{
+	if (ch < 0 || ch >= 8) return 0;
+
+	pthread_mutex_lock(&s_fade_mu);
+	uint32_t d = fade_duty(&s_fade[n->id][ch], sim_mono_us());
+	pthread_mutex_unlock(&s_fade_mu);
+	return d;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  flash: розділ даних ноди (kpl_sim --flash-kb)                             */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Як NOR: запис лише скидає біти (dst &= src), стирання — секторами по 4 кБ
+ * в 0xFF. Час — типовий для SPI flash ESP32: програмування ~0.7 мс на
+ * сторінку 256 Б, стирання сектора ~45 мс; нода в цей час стоїть.
+ */
+
+#define SIM_FLASH_SECTOR	4096
+#define SIM_FLASH_WRITE_US(n)	(20 + (n) * 11 / 4)
+#define SIM_FLASH_ERASE_US	45000
+
+static esp_partition_t	s_part[SIM_MAX_NODES];
+
+static uint8_t *part_mem(const esp_partition_t *p, size_t off, size_t size)
+{
+	if (!sim_cur || p != &s_part[sim_cur->id] || off > p->size || size > p->size - off) return NULL;
+	return sim_cur->flash + off;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+						const char *label)
+{
+	(void)subtype;
+	if (!sim_cur || !sim_cur->flash || type != ESP_PARTITION_TYPE_DATA) return NULL;
+
+	esp_partition_t *p = &s_part[sim_cur->id];
+	p->type = type;
+	p->subtype = ESP_PARTITION_SUBTYPE_ANY;
+	p->size = sim_cur->flash_size;
+	p->erase_size = SIM_FLASH_SECTOR;
+	snprintf(p->label, sizeof(p->label), "%s", label ? label : "");
+	return p;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+	uint8_t *m = part_mem(partition, src_offset, size);
+	if (!m || !dst) return ESP_ERR_INVALID_ARG;
+	memcpy(dst, m, size);
+	return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+	uint8_t *m = part_mem(partition, dst_offset, size);
+	if (!m || !src) return ESP_ERR_INVALID_ARG;
+
+	for (size_t i = 0; i < size; i++) m[i] &= ((const uint8_t *)src)[i];
+	usleep(SIM_FLASH_WRITE_US(size));
+	return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+	uint8_t *m = part_mem(partition, offset, size);
+	if (!m || offset % SIM_FLASH_SECTOR || size % SIM_FLASH_SECTOR) return ESP_ERR_INVALID_ARG;
+
+	memset(m, 0xFF, size);
+	usleep(SIM_FLASH_ERASE_US * (size / SIM_FLASH_SECTOR));
+	return ESP_OK;
+}
+
+uint16_t esp_rom_crc16_le(uint16_t crc, uint8_t const *buf, uint32_t len)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (int i = 0; i < 8; i++) crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+	}
+	return ~crc;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  esp_timer                                                                 */
+/* -------------------------------------------------------------------------- */
+
+int64_t esp_timer_get_time(void)
+{
+	return sim_mono_us();
+}
+
+/*
+ * Кожен таймер — свій потік у контексті ноди-творця (як задача esp_timer в
+ * ESP-IDF, тільки без спільної черги). at_us < 0 => не заряджений.
+ */
+struct esp_timer {
+	esp_timer_cb_t	cb;
+	void		*arg;
+	sim_node_t	*node;
+	pthread_t	th;
+	pthread_mutex_t	mu;
+	pthread_cond_t	cv;
+	int64_t		at_us;
+	uint64_t	period_us;
+	bool		deleted;
+};
+
+static void *esp_timer_thread(void *p)
+{
+	struct esp_timer *t = (struct esp_timer *)p;
+	sim_cur = t->node;
+
+	pthread_mutex_lock(&t->mu);
+	while (!t->deleted) {
+		if (t->at_us < 0) {
+			pthread_cond_wait(&t->cv, &t->mu);
+			continue;
+		}
+
+		struct timespec dl;
+		sim_mono_to_timespec(t->at_us, &dl);
+		if (pthread_cond_timedwait(&t->cv, &t->mu, &dl) != ETIMEDOUT) continue;
+		if (t->at_us < 0 || sim_mono_us() < t->at_us) continue;
+
+		t->at_us = t->period_us ? t->at_us + (int64_t)t->period_us : -1;
+		pthread_mutex_unlock(&t->mu);
+		t->cb(t->arg);
+		pthread_mutex_lock(&t->mu);
+	}
+	pthread_mutex_unlock(&t->mu);
+	free(t);
+	return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+	if (!args || !args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+
+	struct esp_timer *t = (struct esp_timer *)calloc(1, sizeof(*t));
+	if (!t) return ESP_ERR_NO_MEM;
+
+	t->cb = args->callback;
+	t->arg = args->arg;
+	t->node = sim_cur;
+	t->at_us = -1;
+	pthread_mutex_init(&t->mu, NULL);
+
+	pthread_condattr_t a;
+	pthread_condattr_init(&a);
+	pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+	pthread_cond_init(&t->cv, &a);
+	pthread_condattr_destroy(&a);
+
+	if (pthread_create(&t->th, NULL, esp_timer_thread, t) != 0) {
+		free(t);
+		return ESP_ERR_NO_MEM;
+	}
+	pthread_detach(t->th);
+
+	*out_handle = t;
+	return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t us, uint64_t period_us)
+{
+	if (!t) return ESP_ERR_INVALID_ARG;
+
+	pthread_mutex_lock(&t->mu);
+	if (t->at_us >= 0) {
+		pthread_mutex_unlock(&t->mu);
+		return ESP_ERR_INVALID_STATE;
+	}
+	t->at_us = sim_mono_us() + (int64_t)us;
+	t->period_us = period_us;
+	pthread_cond_signal(&t->cv);
+	pthread_mutex_unlock(&t->mu);
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+	return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+	return timer_arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+	if (!timer) return ESP_ERR_INVALID_ARG;
+
+	pthread_mutex_lock(&timer->mu);
+	bool active = timer->at_us >= 0;
+	timer->at_us = -1;
+	pthread_cond_signal(&timer->cv);
+	pthread_mutex_unlock(&timer->mu);
+	return active ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+	if (!timer) return ESP_ERR_INVALID_ARG;
+
+	pthread_mutex_lock(&timer->mu);
+	timer->deleted = true;
+	pthread_cond_signal(&timer->cv);
+	pthread_mutex_unlock(&timer->mu);
+	return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+	if (!timer) return false;
+
+	pthread_mutex_lock(&timer->mu);
+	bool active = timer->at_us >= 0;
+	pthread_mutex_unlock(&timer->mu);
+	return active;
+}
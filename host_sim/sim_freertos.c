@@ -0,0 +1,404 @@
+/*
+ * Host-симулятор: FreeRTOS-задачі, черги і семафори поверх pthreads.
+ * Кожна задача — окремий потік, що успадковує "поточну ноду" від творця.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "sim.h"
+
+struct sim_task {
+	pthread_t	th;
+	TaskFunction_t	fn;
+	void		*arg;
+	sim_node_t	*node;
+	char		name[16];
+
+	pthread_mutex_t	mu;
+	pthread_cond_t	cv;
+	uint32_t	notify;
+};
+
+struct sim_queue {
+	pthread_mutex_t	mu;
+	pthread_cond_t	cv_send;
+	pthread_cond_t	cv_recv;
+	UBaseType_t	len;
+	UBaseType_t	item_size;
+	UBaseType_t	head;
+	UBaseType_t	count;
+	bool		is_mutex;
+	uint8_t		*buf;
+};
+
+static __thread struct sim_task	*s_cur_task = NULL;
+
+/* -------------------------------------------------------------------------- */
+/*  Час                                                                       */
+/* -------------------------------------------------------------------------- */
+
+static void abs_deadline(struct timespec *ts, TickType_t ticks)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+	uint64_t ns = (uint64_t)pdTICKS_TO_MS(ticks) * 1000000ULL;
+	ts->tv_sec  += (time_t)(ns / 1000000000ULL);
+	ts->tv_nsec += (long)(ns % 1000000000ULL);
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+static void cond_init_mono(pthread_cond_t *cv)
+{
+	pthread_condattr_t a;
+	pthread_condattr_init(&a);
+	pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+	pthread_cond_init(cv, &a);
+	pthread_condattr_destroy(&a);
+}
+
+// true => дочекались, false => таймаут
+static bool cond_wait_ticks(pthread_cond_t *cv, pthread_mutex_t *mu,
+			    const struct timespec *deadline, TickType_t ticks)
+{
+	if (ticks == portMAX_DELAY) {
+		pthread_cond_wait(cv, mu);
+		return true;
+	}
+	return pthread_cond_timedwait(cv, mu, deadline) != ETIMEDOUT;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(sim_mono_us() / (1000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	uint64_t us = (uint64_t)pdTICKS_TO_MS(ticks) * 1000ULL;
+	struct timespec ts = {
+		.tv_sec  = (time_t)(us / 1000000ULL),
+		.tv_nsec = (long)((us % 1000000ULL) * 1000ULL),
+	};
+	if (us == 0) {
+		sched_yield();
+		return;
+	}
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+	}
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *prev_wake, TickType_t increment)
+{
+	TickType_t target = *prev_wake + increment;
+	TickType_t now = xTaskGetTickCount();
+	*prev_wake = target;
+
+	if ((int32_t)(target - now) <= 0) {
+		return pdFALSE;
+	}
+	vTaskDelay(target - now);
+	return pdTRUE;
+}
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment)
+{
+	(void)xTaskDelayUntil(prev_wake, increment);
+}
+
+void sim_port_enter_critical(portMUX_TYPE *mux)
+{
+	pthread_mutex_lock(&mux->mu);
+}
+
+void sim_port_exit_critical(portMUX_TYPE *mux)
+{
+	pthread_mutex_unlock(&mux->mu);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Задачі                                                                    */
+/* -------------------------------------------------------------------------- */
+
+static void *task_trampoline(void *p)
+{
+	struct sim_task *t = (struct sim_task *)p;
+
+	sim_cur = t->node;
+	s_cur_task = t;
+	t->fn(t->arg);
+
+	// Задача FreeRTOS не має повертатись, але не валимо весь процес
+	return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+				   void *arg, UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+	(void)stack_depth;
+	(void)prio;
+	(void)core;
+
+	struct sim_task *t = (struct sim_task *)calloc(1, sizeof(*t));
+	if (!t) return pdFAIL;
+
+	t->fn = fn;
+	t->arg = arg;
+	t->node = sim_cur;
+	strncpy(t->name, name ? name : "", sizeof(t->name) - 1);
+	pthread_mutex_init(&t->mu, NULL);
+	cond_init_mono(&t->cv);
+
+	pthread_attr_t a;
+	pthread_attr_init(&a);
+	pthread_attr_setdetachstate(&a, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&a, 256 * 1024);
+
+	int rc = pthread_create(&t->th, &a, task_trampoline, t);
+	pthread_attr_destroy(&a);
+	if (rc != 0) {
+		free(t);
+		return pdFAIL;
+	}
+
+	if (out) *out = t;
+	return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+		       void *arg, UBaseType_t prio, TaskHandle_t *out)
+{
+	return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, prio, out, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	if (task == NULL || task == s_cur_task) {
+		pthread_exit(NULL);
+	}
+	// видалення чужої задачі в симуляторі не підтримуємо
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return s_cur_task;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *arr, UBaseType_t arr_size, uint32_t *total_run_time)
+{
+	(void)arr;
+	(void)arr_size;
+	if (total_run_time) *total_run_time = 0;
+	return 0;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+	if (!task) return;
+	pthread_mutex_lock(&task->mu);
+	task->notify++;
+	pthread_cond_signal(&task->cv);
+	pthread_mutex_unlock(&task->mu);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+	struct sim_task *t = s_cur_task;
+	if (!t) return 0;
+
+	struct timespec dl;
+	abs_deadline(&dl, ticks_to_wait);
+
+	pthread_mutex_lock(&t->mu);
+	while (t->notify == 0 && ticks_to_wait != 0) {
+		if (!cond_wait_ticks(&t->cv, &t->mu, &dl, ticks_to_wait)) break;
+	}
+	uint32_t v = t->notify;
+	if (v) t->notify = clear_on_exit ? 0 : v - 1;
+	pthread_mutex_unlock(&t->mu);
+	return v;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Черги                                                                     */
+/* -------------------------------------------------------------------------- */
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+	if (len == 0) return NULL;
+
+	struct sim_queue *q = (struct sim_queue *)calloc(1, sizeof(*q));
+	if (!q) return NULL;
+
+	q->buf = (uint8_t *)calloc(len, item_size ? item_size : 1);
+	if (!q->buf) {
+		free(q);
+		return NULL;
+	}
+	q->len = len;
+	q->item_size = item_size;
+	pthread_mutex_init(&q->mu, NULL);
+	cond_init_mono(&q->cv_send);
+	cond_init_mono(&q->cv_recv);
+	return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+	if (!q) return;
+	free(q->buf);
+	free(q);
+}
+
+static BaseType_t queue_put(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+	struct timespec dl;
+	abs_deadline(&dl, ticks);
+
+	pthread_mutex_lock(&q->mu);
+	while (q->count == q->len) {
+		if (ticks == 0 || !cond_wait_ticks(&q->cv_send, &q->mu, &dl, ticks)) {
+			pthread_mutex_unlock(&q->mu);
+			return errQUEUE_FULL;
+		}
+	}
+
+	UBaseType_t idx;
+	if (front) {
+		q->head = (q->head + q->len - 1) % q->len;
+		idx = q->head;
+	} else {
+		idx = (q->head + q->count) % q->len;
+	}
+	if (q->item_size) {
+		memcpy(q->buf + (size_t)idx * q->item_size, item, q->item_size);
+	}
+	q->count++;
+
+	pthread_cond_signal(&q->cv_recv);
+	pthread_mutex_unlock(&q->mu);
+	return pdPASS;
+}
+
+static BaseType_t queue_get(QueueHandle_t q, void *item, TickType_t ticks, bool peek)
+{
+	struct timespec dl;
+	abs_deadline(&dl, ticks);
+
+	pthread_mutex_lock(&q->mu);
+	while (q->count == 0) {
+		if (ticks == 0 || !cond_wait_ticks(&q->cv_recv, &q->mu, &dl, ticks)) {
+			pthread_mutex_unlock(&q->mu);
+			return pdFALSE;
+		}
+	}
+
+	if (q->item_size && item) {
+		memcpy(item, q->buf + (size_t)q->head * q->item_size, q->item_size);
+	}
+	if (!peek) {
+		q->head = (q->head + 1) % q->len;
+		q->count--;
+		pthread_cond_signal(&q->cv_send);
+	}
+	pthread_mutex_unlock(&q->mu);
+	return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+	return queue_put(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+	return queue_put(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+	return queue_put(q, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+	return queue_get(q, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+	return queue_get(q, item, ticks, true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+	pthread_mutex_lock(&q->mu);
+	UBaseType_t n = q->count;
+	pthread_mutex_unlock(&q->mu);
+	return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+	pthread_mutex_lock(&q->mu);
+	UBaseType_t n = q->len - q->count;
+	pthread_mutex_unlock(&q->mu);
+	return n;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+	pthread_mutex_lock(&q->mu);
+	q->head = 0;
+	q->count = 0;
+	pthread_cond_broadcast(&q->cv_send);
+	pthread_mutex_unlock(&q->mu);
+	return pdPASS;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Семафори (черги з нульовим розміром елемента)                             */
+/* -------------------------------------------------------------------------- */
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+	QueueHandle_t q = xQueueCreate(max, 0);
+	if (q) q->count = initial;
+	return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	QueueHandle_t q = xSemaphoreCreateCounting(1, 1);
+	if (q) q->is_mutex = true;
+	return q;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+	return queue_get(s, NULL, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+	return queue_put(s, NULL, 0, false);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+	vQueueDelete(s);
+}
@@ -0,0 +1,1124 @@
+/*
+ * kPowerLed host-симулятор mesh-мережі.
+ *
+ * Збирає прошивку з main/ як shared object і завантажує її N разів (кожна копія —
+ * окрема віртуальна нода зі своїми static-змінними). esp_mesh_send/recv/
+ * get_routing_table підмінені in-process моделлю дерева з затримкою і втратами
+ * на кожному лінку (sim_mesh.c), тому можна міряти швидкість пакетів, глибину
+ * черг і вартість логування без заліза.
+ *
+ *	cmake -S host_sim -B host_sim/build && cmake --build host_sim/build
+ *	./host_sim/build/kpl_sim --nodes 15 --fanout 2 --latency-us 3000 --loss 1 \
+ *		--log-stream --cmd-period-ms 500 --duration-s 10
+ */
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_mesh.h"
+#include "esp_wifi.h"
+
+#include "mesh_proto.h"
+#include "mesh_rx.h"
+#include "mesh_log_stream.h"
+#include "mesh_time_sync.h"
+#include "powled_node.h"
+#include "mesh_cmd.h"
+#include "legacy_root_sender.h"
+#include "flash_ring.h"
+#include "powled_fade.h"
+#include "powled_hal.h"
+#include "mesh_tx.h"
+#include "mesh_hdr.h"
+
+#include "sim.h"
+
+typedef struct {
+	int		nodes;
+	int		fanout;
+	bool		chain;
+	uint32_t	latency_us;
+	uint32_t	jitter_us;
+	double		loss_pct;
+	uint64_t	seed;
+	int		duration_s;
+	bool		uart;
+	const char	*uart_dir;
+	bool		log_stream;
+	bool		log_batch;
+	bool		log_bin;
+	bool		log_compact;
+	bool		log_lz;
+	int		log_level;		// 0 => CTRL v1 без фільтра
+	int		log_tag_mode;
+	const char	*log_tags;		// "tag1,tag2"
+	uint32_t	log_storm_hz;
+	bool		log_storm_seq;
+	const char	*capture;
+	uint32_t	cmd_period_ms;
+	uint32_t	cmd_at_ms;		// 0 => текст powled0/1 (одразу), інакше POWLED_AT з таким запасом
+	bool		cmd_bin;		// MESH_PKT_TYPE_CMD замість тексту / POWLED_AT
+	bool		cmd_ack;		// ... з MESH_CMD_F_ACK
+	uint8_t		cmd_mask;		// ... з MESH_CMD_F_MASK на ці канали
+	uint8_t		cmd_level;		// ... яскравість (нода з --dim)
+	uint16_t	cmd_fade_ms;		// ... з MESH_CMD_F_FADE
+	bool		dim;			// kpl_fw_dim: CONFIG_POWLED_DIM
+	bool		v1[SIM_MAX_NODES];	// kpl_fw_v1: без заголовка v2
+	bool		cmd_trace;		// ... з MESH_CMD_F_TRACE
+	uint32_t	uplink_period_ms;
+	uint32_t	uplink_burst;		// повідомлень за період
+	bool		uplink_keyed;		// legacy_send_to_root_keyed
+	uint32_t	flash_kb;		// розділ даних ноди (flash-сховище legacy_root_sender)
+	const char	*flash_dir;		// ... у файлах DIR/nodeI.flash
+	uint32_t	time_sync_ms;
+	double		drift_ppm;
+} sim_opts_t;
+
+static sim_opts_t s_opt = {
+	.nodes		= 7,
+	.fanout		= 2,
+	.latency_us	= 2000,
+	.seed		= 1,
+	.duration_s	= 10,
+	.cmd_level	= 255,
+	.uplink_burst	= 1,
+};
+
+/* -------------------------------------------------------------------------- */
+/*  Утиліти                                                                   */
+/* -------------------------------------------------------------------------- */
+
+static void *node_sym(sim_node_t *n, const char *name)
+{
+	void *p = dlsym(n->dl, name);
+	if (!p) {
+		fprintf(stderr, "sim: node%d: no symbol %s\n", n->id, name);
+		exit(1);
+	}
+	return p;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  --nodes N             кількість нод (1..%d), default 7\n"
+		"  --fanout F            дітей на ноду в дереві, default 2\n"
+		"  --chain               топологія ланцюжок замість дерева\n"
+		"  --latency-us US       затримка одного хопу, default 2000\n"
+		"  --jitter-us US        джитер одного хопу, default 0\n"
+		"  --loss PCT            втрати на хопі, %%, default 0\n"
+		"  --link ID:US:PCT      окремі затримка/втрати для лінка ноди ID до батька\n"
+		"  --link-kbps K         пропускна здатність лінка (пакети чекають один одного), default без обмеження\n"
+		"  --seed S              seed PRNG лінків, default 1\n"
+		"  --drift-ppm P         дрейф годинника нод, рівномірно в [-P, P]\n"
+		"  --duration-s S        тривалість, default 10\n"
+		"  --uart                друкувати UART нод у stdout\n"
+		"  --uart-dir DIR        писати UART ноди i у DIR/nodeI.log\n"
+		"  --log-stream          root вмикає стрім логів на всіх нодах\n"
+		"  --log-batch           ... у батч-режимі (MESH_LOG_TYPE_BATCH)\n"
+		"  --log-bin             ... у бінарному режимі (MESH_LOG_TYPE_BIN)\n"
+		"  --log-compact         ... з компактними заголовками (MESH_LOG_TYPE_F_COMPACT)\n"
+		"  --log-lz              ... зі стисненням батчів (MESH_LOG_TYPE_F_LZ)\n"
+		"  --log-level N         CTRL v2: стрімити рівні <= N (1=E .. 5=V)\n"
+		"  --log-allow T1,T2     CTRL v2: стрімити тільки ці теги\n"
+		"  --log-deny T1,T2      CTRL v2: не стрімити ці теги\n"
+		"  --log-storm HZ        кожна нода логує однакову помилку HZ раз/с\n"
+		"  --log-storm-seq       ... з номером у строці (різні строки)\n"
+		"  --capture FILE        писати всі пакети для root у FILE (для kpl_log_decode)\n"
+		"  --cmd-period-ms MS    root шле powled0/powled1 всім нодам\n"
+		"  --cmd-at-ms MS        ... як POWLED_AT з моментом виконання now + MS\n"
+		"  --cmd-bin             ... бінарною командою MESH_PKT_TYPE_CMD\n"
+		"  --cmd-ack             ... з запитом CMD_ACK (RTT у звіті)\n"
+		"  --cmd-mask M          ... на канали з маски M разом (MESH_CMD_F_MASK)\n"
+		"  --cmd-level L         ... яскравість каналу 0 (1..255)\n"
+		"  --cmd-fade-ms F       ... з переходом за F мс (MESH_CMD_F_FADE)\n"
+		"  --cmd-trace           ... з трасою затримки (MESH_CMD_F_TRACE, p50/p99 у звіті)\n"
+		"  --dim                 прошивка з CONFIG_POWLED_DIM (LEDC fade)\n"
+		"  --v1-nodes ID,ID      ці ноди — прошивка без заголовка v2 (0 — root)\n"
+		"  --uplink-period-ms MS кожна нода шле legacy текст на root\n"
+		"  --uplink-burst N      ... N повідомлень за раз, default 1\n"
+		"  --uplink-keyed        ... через legacy_send_to_root_keyed (ключ s0..sN-1)\n"
+		"  --flap ID:PERIOD:DOWN батько ноди ID зникає на DOWN мс кожні PERIOD мс\n"
+		"                        (esp_mesh_send вгору -> ESP_ERR_MESH_DISCONNECTED)\n"
+		"  --flash-kb KB         у кожної ноди розділ даних KB (flash-сховище uplink)\n"
+		"  --flash-dir DIR       ... у файлах DIR/nodeI.flash: зберігається між запусками\n"
+		"  --time-sync-ms MS     запустити розсилку часу з root\n",
+		argv0, SIM_MAX_NODES);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Сценарії навантаження (виконуються як задачі у контексті ноди)            */
+/* -------------------------------------------------------------------------- */
+
+static void send_from_root(int dst, const void *buf, size_t len)
+{
+	mesh_addr_t to;
+	memcpy(to.addr, sim_nodes[dst].mac, 6);
+
+	mesh_data_t data = {
+		.data	= (uint8_t *)buf,
+		.size	= (uint16_t)len,
+		.proto	= MESH_PROTO_BIN,
+		.tos	= MESH_TOS_P2P,
+	};
+	esp_mesh_send(&to, &data, MESH_DATA_P2P, NULL, 0);
+}
+
+/*
+ * Розкид перемикань: для кожної команди — справжні моменти gpio_set_level на
+ * всіх нодах (sim_mono_us), skew = max - min, і відхилення від заданого моменту.
+ */
+static struct {
+	uint32_t	cmds;
+	uint32_t	missed;		// нода не перемкнулась до наступної команди
+	double		skew_sum;
+	int64_t		skew_max;
+	double		err_sum;	// |факт - ціль|, тільки POWLED_AT
+	int64_t		err_max;
+	uint32_t	err_n;
+	double		lat_sum;	// від відправки root'ом до GPIO, тільки без at
+	int64_t		lat_max;
+	uint32_t	lat_n;
+	uint32_t	bad_state;	// команда на всі канали, а піни ноди не всі в заданому рівні
+	uint32_t	bad_duty;	// --dim: duty каналу 0 не дійшов до цілі попередньої команди
+} s_sw;
+
+// expect: -1 — команда не на всі канали, інакше рівень, у якому мають бути всі піни powled
+static void switch_measure(int64_t sent_mono, int64_t target_mono, int expect, uint32_t expect_duty)
+{
+	int64_t lo = INT64_MAX, hi = INT64_MIN;
+
+	for (int i = 1; i < sim_node_count; i++) {
+		if (expect >= 0) {
+			uint64_t pins = sim_nodes[i].hal_pins;
+			if ((sim_gpio_out(&sim_nodes[i]) & pins) != (expect ? pins : 0)) s_sw.bad_state++;
+		}
+		if (s_opt.dim && sim_dim_duty(&sim_nodes[i], 0) != expect_duty) s_sw.bad_duty++;
+
+		int64_t t = __atomic_load_n(&sim_nodes[i].gpio_last_us, __ATOMIC_RELAXED);
+		if (t < sent_mono) {
+			s_sw.missed++;
+			continue;
+		}
+		if (t < lo) lo = t;
+		if (t > hi) hi = t;
+
+		if (target_mono) {
+			int64_t e = t > target_mono ? t - target_mono : target_mono - t;
+			s_sw.err_sum += (double)e;
+			if (e > s_sw.err_max) s_sw.err_max = e;
+			s_sw.err_n++;
+		} else {
+			s_sw.lat_sum += (double)(t - sent_mono);
+			if (t - sent_mono > s_sw.lat_max) s_sw.lat_max = t - sent_mono;
+			s_sw.lat_n++;
+		}
+	}
+	if (hi < lo) return;
+
+	s_sw.cmds++;
+	s_sw.skew_sum += (double)(hi - lo);
+	if (hi - lo > s_sw.skew_max) s_sw.skew_max = hi - lo;
+}
+
+static void root_ctrl_task(void *arg)
+{
+	(void)arg;
+	uint32_t cnt = 0;
+
+	if (s_opt.log_stream) {
+		bool v2 = s_opt.log_level || s_opt.log_tags;
+
+		for (int i = 1; i < sim_node_count; i++) {
+			mesh_log_ctrl_v2_packet_t c;
+			mesh_log_ctrl_packet_t *p = &c.base;
+			memset(&c, 0, sizeof(c));
+			p->h.magic = MESH_PKT_MAGIC;
+			p->h.version = MESH_PKT_VERSION;
+			p->h.type = MESH_LOG_TYPE_CTRL;
+			p->h.counter = ++cnt;
+			esp_wifi_get_mac(WIFI_IF_STA, p->h.src_mac);
+			p->enable = 1;
+			p->flags = (s_opt.log_batch ? MESH_LOG_CTRL_F_BATCH : 0) |
+				   (s_opt.log_bin ? MESH_LOG_CTRL_F_BINARY : 0) |
+				   (s_opt.log_compact ? MESH_LOG_CTRL_F_COMPACT : 0) |
+				   (s_opt.log_lz ? MESH_LOG_CTRL_F_LZ : 0);
+
+			if (v2) {
+				p->flags |= MESH_LOG_CTRL_F_FILTER;
+				c.min_level = (uint8_t)(s_opt.log_level ? s_opt.log_level : ESP_LOG_VERBOSE);
+				c.tag_mode = (uint8_t)s_opt.log_tag_mode;
+
+				char tags[128];
+				snprintf(tags, sizeof(tags), "%s", s_opt.log_tags ? s_opt.log_tags : "");
+				char *save = NULL;
+				for (char *t = strtok_r(tags, ",", &save);
+				     t && c.tag_count < MESH_LOG_CTRL_MAX_TAGS; t = strtok_r(NULL, ",", &save)) {
+					strncpy(c.tags[c.tag_count++], t, sizeof(c.tags[0]) - 1);
+				}
+			}
+			send_from_root(i, &c, v2 ? sizeof(c) : sizeof(*p));
+		}
+	}
+
+	if (!s_opt.cmd_period_ms) vTaskDelete(NULL);
+
+	TickType_t last = xTaskGetTickCount();
+	int64_t sent_mono = 0, target_mono = 0;
+	esp_err_t (*cmd_send)(const mesh_addr_t *, uint8_t, uint8_t, bool, int64_t) =
+		(esp_err_t (*)(const mesh_addr_t *, uint8_t, uint8_t, bool, int64_t))node_sym(sim_cur,
+			s_opt.cmd_mask ? "mesh_cmd_send_mask" : "mesh_cmd_send");
+
+	esp_err_t (*fade_send)(const mesh_addr_t *, uint8_t, uint8_t, uint16_t, bool, int64_t) =
+		(esp_err_t (*)(const mesh_addr_t *, uint8_t, uint8_t, uint16_t, bool, int64_t))node_sym(sim_cur,
+			"mesh_cmd_send_fade");
+
+	if (s_opt.cmd_trace) ((void (*)(bool))node_sym(sim_cur, "mesh_cmd_set_trace"))(true);
+
+	// текст і POWLED_AT — на всі канали; CMD — тільки якщо маска їх покриває
+	uint32_t (*ch_mask)(void) = (uint32_t (*)(void))node_sym(sim_cur, "powled_node_ch_mask");
+	bool all_ch = !s_opt.cmd_bin || (s_opt.cmd_mask & ch_mask()) == ch_mask();
+
+	// як level_to_duty() у powled_fade.c; текст і маска — повна яскравість
+	uint8_t level = s_opt.cmd_bin && !s_opt.cmd_mask ? s_opt.cmd_level : 255;
+	uint32_t on_duty = ((uint32_t)level * POWLED_HAL_DUTY_MAX + 127) / 255;
+
+	for (bool on = true;; on = !on) {
+		vTaskDelayUntil(&last, pdMS_TO_TICKS(s_opt.cmd_period_ms));
+
+		// попередня команда вже мала виконатись (період > запасу + доставки)
+		if (sent_mono) switch_measure(sent_mono, target_mono, all_ch ? !on : -1, !on ? on_duty : 0);
+		sent_mono = sim_mono_us();
+		target_mono = 0;
+
+		int64_t at = 0;
+		if (s_opt.cmd_at_ms) {
+			// годинник root'а не дрейфує і не підкручується => ціль у mono відома точно
+			at = sim_clock_now_us(sim_cur) + (int64_t)s_opt.cmd_at_ms * 1000;
+			target_mono = sent_mono + (int64_t)s_opt.cmd_at_ms * 1000;
+		}
+
+		if (s_opt.cmd_bin) {
+			for (int i = 1; i < sim_node_count; i++) {
+				mesh_addr_t to;
+				memcpy(to.addr, sim_nodes[i].mac, 6);
+				if (s_opt.cmd_mask) cmd_send(&to, s_opt.cmd_mask, on ? s_opt.cmd_mask : 0, s_opt.cmd_ack, at);
+				else if (s_opt.cmd_fade_ms) fade_send(&to, MESH_CMD_CH_POWLED, on ? s_opt.cmd_level : 0,
+								      s_opt.cmd_fade_ms, s_opt.cmd_ack, at);
+				else cmd_send(&to, MESH_CMD_CH_POWLED, on ? s_opt.cmd_level : 0, s_opt.cmd_ack, at);
+			}
+			continue;
+		}
+
+		if (s_opt.cmd_at_ms) {
+
+			for (int i = 1; i < sim_node_count; i++) {
+				mesh_powled_at_packet_t p;
+				memset(&p, 0, sizeof(p));
+				p.h.magic = MESH_PKT_MAGIC;
+				p.h.version = MESH_PKT_VERSION;
+				p.h.type = MESH_PKT_TYPE_POWLED_AT;
+				p.h.counter = ++cnt;
+				esp_wifi_get_mac(WIFI_IF_STA, p.h.src_mac);
+				p.state = on ? 1 : 0;
+				p.at_us = at;
+				send_from_root(i, &p, sizeof(p));
+			}
+			continue;
+		}
+
+		for (int i = 1; i < sim_node_count; i++) {
+			mesh_packet_t p;
+			memset(&p, 0, sizeof(p));
+			p.magic = MESH_PKT_MAGIC;
+			p.version = MESH_PKT_VERSION;
+			p.type = MESH_PKT_TYPE_TEXT;
+			p.counter = ++cnt;
+			esp_wifi_get_mac(WIFI_IF_STA, p.src_mac);
+			strcpy(p.payload, on ? "powled1" : "powled0");
+			send_from_root(i, &p, sizeof(p));
+		}
+	}
+}
+
+static void node_uplink_task(void *arg)
+{
+	(void)arg;
+	bool (*send)(const char *) = (bool (*)(const char *))node_sym(sim_cur, "legacy_send_to_root");
+	bool (*send_keyed)(const char *, const char *) =
+		(bool (*)(const char *, const char *))node_sym(sim_cur, "legacy_send_to_root_keyed");
+	uint32_t cnt = 0;
+
+	TickType_t last = xTaskGetTickCount();
+	for (;;) {
+		vTaskDelayUntil(&last, pdMS_TO_TICKS(s_opt.uplink_period_ms));
+
+		// --uplink-keyed: "сенсори" s0..sN-1, важливе тільки останнє значення
+		for (uint32_t i = 0; i < s_opt.uplink_burst; i++) {
+			char msg[32];
+			if (s_opt.uplink_keyed) {
+				char key[12];
+				snprintf(key, sizeof(key), "s%" PRIu32, i);
+				snprintf(msg, sizeof(msg), "n%d s%" PRIu32 "=%" PRIu32, sim_cur->id, i, cnt);
+				send_keyed(key, msg);
+			} else {
+				snprintf(msg, sizeof(msg), "n%d tick %" PRIu32, sim_cur->id, ++cnt);
+				send(msg);
+			}
+		}
+		if (s_opt.uplink_keyed) cnt++;
+	}
+}
+
+// "Зациклена" помилка: однакова строка з великою частотою (--log-storm-seq: з лічильником, дедуп не рятує)
+static void node_log_storm_task(void *arg)
+{
+	(void)arg;
+	static const char *TAG = "storm";
+	uint32_t seq = 0;
+
+	TickType_t period = pdMS_TO_TICKS(1000 / s_opt.log_storm_hz);
+	if (period < 1) period = 1;
+
+	TickType_t last = xTaskGetTickCount();
+	for (;;) {
+		vTaskDelayUntil(&last, period);
+		if (s_opt.log_storm_seq) ESP_LOGE(TAG, "sensor read failed: %s #%" PRIu32, "ESP_ERR_TIMEOUT", ++seq);
+		else ESP_LOGE(TAG, "sensor read failed: %s", "ESP_ERR_TIMEOUT");
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Старт нод                                                                 */
+/* -------------------------------------------------------------------------- */
+
+// "Flash" ноди: стерта пам'ять або файл, що переживає перезапуск kpl_sim
+static void flash_attach(sim_node_t *n)
+{
+	size_t   size = (size_t)s_opt.flash_kb * 1024;
+	uint8_t *m    = NULL;
+
+	if (s_opt.flash_dir) {
+		char path[512];
+		struct stat st;
+		snprintf(path, sizeof(path), "%s/node%d.flash", s_opt.flash_dir, n->id);
+
+		int fd = open(path, O_RDWR | O_CREAT, 0644);
+		if (fd >= 0 && fstat(fd, &st) == 0) {
+			bool fresh = (size_t)st.st_size != size;
+			if (!fresh || (ftruncate(fd, 0) == 0 && ftruncate(fd, (off_t)size) == 0)) {
+				m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				if (m == MAP_FAILED) m = NULL;
+				else if (fresh) memset(m, 0xFF, size);
+			}
+		}
+		if (fd >= 0) close(fd);
+		if (!m) fprintf(stderr, "sim: can't map %s, flash in RAM\n", path);
+	}
+	if (!m && (m = malloc(size))) memset(m, 0xFF, size);
+
+	n->flash = m;
+	n->flash_size = m ? (uint32_t)size : 0;
+}
+
+static void node_boot(sim_node_t *n)
+{
+	char path[sizeof(n->so_path)];
+	snprintf(path, sizeof(path), "/tmp/kpl_sim_%d_node%d.so", (int)getpid(), n->id);
+
+	// Окремий файл => окрема копія static-змінних прошивки
+	const char *so = s_opt.v1[n->id] ? KPL_FW_V1_SO : s_opt.dim ? KPL_FW_DIM_SO : KPL_FW_SO;
+	FILE *in = fopen(so, "rb");
+	FILE *out = fopen(path, "wb");
+	if (!in || !out) {
+		fprintf(stderr, "sim: can't copy %s -> %s\n", so, path);
+		exit(1);
+	}
+	char buf[65536];
+	size_t r;
+	while ((r = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, r, out);
+	fclose(in);
+	fclose(out);
+
+	n->dl = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	unlink(path);
+	if (!n->dl) {
+		fprintf(stderr, "sim: dlopen: %s\n", dlerror());
+		exit(1);
+	}
+	snprintf(n->so_path, sizeof(n->so_path), "%s", path);
+
+	void (*app_main)(void) = (void (*)(void))node_sym(n, "app_main");
+
+	sim_cur = n;
+	app_main();
+
+	mesh_event_connected_t conn;
+	memset(&conn, 0, sizeof(conn));
+	conn.self_layer = (uint16_t)n->layer;
+	if (n->parent >= 0) {
+		memcpy(conn.connected.bssid, sim_nodes[n->parent].mac, 6);
+		conn.connected.bssid[5]++;
+	}
+
+	sim_mesh_post_event(n, MESH_EVENT_STARTED, NULL);
+	sim_mesh_post_event(n, MESH_EVENT_PARENT_CONNECTED, &conn);
+	sim_cur = NULL;
+}
+
+static void build_topology(void)
+{
+	uint64_t rng = s_opt.seed ^ 0xD1B54A32D192ED03ULL;
+
+	sim_node_count = s_opt.nodes;
+	for (int i = 0; i < sim_node_count; i++) {
+		sim_node_t *n = &sim_nodes[i];
+
+		n->id = i;
+		n->parent = (i == 0) ? -1 : (s_opt.chain ? i - 1 : (i - 1) / s_opt.fanout);
+		n->layer = (i == 0) ? 1 : sim_nodes[n->parent].layer + 1;
+		n->log_level = ESP_LOG_INFO;
+
+		const uint8_t mac[6] = { 0x24, 0x0a, 0xc4, 0x00, (uint8_t)(i >> 7), (uint8_t)(i << 1) };
+		memcpy(n->mac, mac, 6);
+
+		n->uplink.latency_us = s_opt.latency_us;
+		n->uplink.jitter_us = s_opt.jitter_us;
+		n->uplink.loss_ppm = (uint32_t)(s_opt.loss_pct * 10000.0);
+		n->uplink.rng = s_opt.seed * 0x100000001B3ULL + (uint64_t)i;
+
+		if (s_opt.drift_ppm > 0 && i != 0) {
+			double u = (double)(sim_rand_next(&rng) >> 11) / (double)(1ULL << 53);
+			n->clk_drift_ppm = (2.0 * u - 1.0) * s_opt.drift_ppm;
+		}
+
+		sim_mesh_node_init(n);
+	}
+}
+
+static FILE *open_uart(int id)
+{
+	if (s_opt.uart) return stdout;
+
+	if (s_opt.uart_dir) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/node%d.log", s_opt.uart_dir, id);
+		FILE *f = fopen(path, "w");
+		if (f) return f;
+		fprintf(stderr, "sim: can't open %s\n", path);
+	}
+	return fopen("/dev/null", "w");
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Звіт                                                                      */
+/* -------------------------------------------------------------------------- */
+
+// Точність часу: що нода думає про себе (REQ/RESP) проти справжньої різниці годинників
+static void report_time(void)
+{
+	void (*get)(mesh_time_sync_stats_t *);
+	int64_t root_now = sim_clock_now_us(&sim_nodes[0]);
+	int64_t worst = 0;
+	double sum = 0;
+	int n_synced = 0;
+
+	printf("\n%-5s %6s %6s %6s %12s %10s %12s %9s %9s %9s %7s\n",
+		"node", "syncs", "steps", "slews", "offset_us", "delay_us", "true_err_us",
+		"drift_ppm", "est_ppm", "next_ms", "req_to");
+	for (int i = 1; i < sim_node_count; i++) {
+		sim_node_t *n = &sim_nodes[i];
+		get = (void (*)(mesh_time_sync_stats_t *))node_sym(n, "mesh_time_sync_get_stats");
+		mesh_time_sync_stats_t st;
+		get(&st);
+
+		int64_t err = sim_clock_now_us(n) - root_now;
+		// est_ppm — корекція ходу, тобто має бути близько -drift_ppm
+		printf("%-5d %6" PRIu32 " %6" PRIu32 " %6" PRIu32 " %12" PRId64 " %10" PRIu32 " %12" PRId64
+		       " %9.2f %9.2f %9" PRIu32 " %7" PRIu32 "\n",
+			n->id, st.syncs, st.steps, st.slews, st.last_offset_us, st.last_delay_us, err,
+			n->clk_drift_ppm, st.drift_ppb / 1000.0, st.interval_ms, st.req_timeouts);
+
+		if (!st.syncs) continue;
+		int64_t a = err < 0 ? -err : err;
+		if (a > worst) worst = a;
+		sum += (double)a;
+		n_synced++;
+	}
+
+	size_t (*nodes)(mesh_time_node_stats_t *, size_t) =
+		(size_t (*)(mesh_time_node_stats_t *, size_t))node_sym(&sim_nodes[0], "mesh_time_sync_root_get_nodes");
+	mesh_time_node_stats_t tbl[SIM_MAX_NODES];
+	size_t n_tbl = nodes(tbl, SIM_MAX_NODES);
+
+	printf("time sync: %d/%d node(s) synced, |true err| avg %.0f us, max %" PRId64 " us; root knows %zu node(s)\n",
+		n_synced, sim_node_count - 1, n_synced ? sum / n_synced : 0.0, worst, n_tbl);
+}
+
+static void report(double secs)
+{
+	uint64_t tx = 0, txb = 0, rx = 0, rxb = 0, lost = 0, drops = 0;
+
+	printf("\n%-5s %-5s %9s %11s %9s %11s %7s %7s %6s %7s %9s %9s\n",
+		"node", "layer", "tx_pkts", "tx_bytes", "rx_pkts", "rx_bytes",
+		"lost", "rxq_dr", "rxq_mx", "txq_ful", "log_lines", "log_us/l");
+
+	for (int i = 0; i < sim_node_count; i++) {
+		sim_node_t *n = &sim_nodes[i];
+
+		pthread_mutex_lock(&n->mu);
+		double log_us = n->log_lines ? (double)n->log_ns / 1000.0 / (double)n->log_lines : 0.0;
+		printf("%-5d %-5d %9" PRIu64 " %11" PRIu64 " %9" PRIu64 " %11" PRIu64
+		       " %7" PRIu64 " %7" PRIu64 " %6d %7" PRIu64 " %9" PRIu64 " %9.2f\n",
+			n->id, n->layer, n->tx_pkts, n->tx_bytes, n->rx_pkts, n->rx_bytes,
+			n->lost, n->rxq_drops, n->rxq_max, n->tx_full, n->log_lines, log_us);
+
+		tx += n->tx_pkts;
+		txb += n->tx_bytes;
+		rx += n->rx_pkts;
+		rxb += n->rx_bytes;
+		lost += n->lost;
+		drops += n->rxq_drops;
+		pthread_mutex_unlock(&n->mu);
+	}
+
+	// mesh_rx: сумарно по всіх нодах, по типах
+	printf("\n%-6s %9s %11s %7s %7s %8s %8s\n", "type", "rx_pkts", "rx_bytes", "short", "err", "avg_us", "max_us");
+	for (int type = 0; type < 256; type++) {
+		mesh_rx_type_stats_t sum = { 0 };
+		bool any = false;
+
+		for (int i = 0; i < sim_node_count; i++) {
+			esp_err_t (*get)(uint8_t, mesh_rx_type_stats_t *) =
+				(esp_err_t (*)(uint8_t, mesh_rx_type_stats_t *))node_sym(&sim_nodes[i], "mesh_rx_get_type_stats");
+			mesh_rx_type_stats_t st;
+			if (get((uint8_t)type, &st) != ESP_OK) continue;
+
+			any = true;
+			sum.rx_pkts += st.rx_pkts;
+			sum.rx_bytes += st.rx_bytes;
+			sum.short_pkts += st.short_pkts;
+			sum.handler_err += st.handler_err;
+			sum.handler_us_total += st.handler_us_total;
+			if (st.handler_us_max > sum.handler_us_max) sum.handler_us_max = st.handler_us_max;
+		}
+		if (!any || (sum.rx_pkts == 0 && sum.short_pkts == 0)) continue;
+
+		printf("%-6d %9" PRIu32 " %11" PRIu64 " %7" PRIu32 " %7" PRIu32 " %8.1f %8" PRIu32 "\n",
+			type, sum.rx_pkts, sum.rx_bytes, sum.short_pkts, sum.handler_err,
+			sum.rx_pkts ? (double)sum.handler_us_total / (double)sum.rx_pkts : 0.0,
+			sum.handler_us_max);
+	}
+
+	uint32_t pool_ex = 0, work_q_max = 0;
+	for (int i = 0; i < sim_node_count; i++) {
+		void (*get)(mesh_rx_stats_t *) = (void (*)(mesh_rx_stats_t *))node_sym(&sim_nodes[i], "mesh_rx_get_stats");
+		mesh_rx_stats_t g;
+		get(&g);
+		pool_ex += g.pool_exhausted;
+		if (g.work_q_max > work_q_max) work_q_max = g.work_q_max;
+	}
+	mesh_log_stream_stats_t ls = { 0 };
+	for (int i = 0; i < sim_node_count; i++) {
+		void (*get)(mesh_log_stream_stats_t *) =
+			(void (*)(mesh_log_stream_stats_t *))node_sym(&sim_nodes[i], "mesh_log_stream_get_stats");
+		mesh_log_stream_stats_t st;
+		get(&st);
+		ls.captured += st.captured;
+		ls.dropped += st.dropped;
+		ls.truncated += st.truncated;
+		ls.sent_pkts += st.sent_pkts;
+		ls.send_err += st.send_err;
+		ls.filtered += st.filtered;
+		ls.rate_limited += st.rate_limited;
+		ls.deduped += st.deduped;
+		ls.lz_in += st.lz_in;
+		ls.lz_out += st.lz_out;
+		ls.id_collisions += st.id_collisions;
+		if (st.ring_max > ls.ring_max) ls.ring_max = st.ring_max;
+	}
+	printf("\nlog stream: captured %" PRIu32 ", filtered %" PRIu32 ", rate limited %" PRIu32
+	       ", deduped %" PRIu32 ", dropped %" PRIu32 ", truncated %" PRIu32 ", ring max %" PRIu32
+	       ", sent %" PRIu32 " pkts, send err %" PRIu32 "\n",
+		ls.captured, ls.filtered, ls.rate_limited, ls.deduped, ls.dropped, ls.truncated,
+		ls.ring_max, ls.sent_pkts, ls.send_err);
+	if (ls.lz_in) {
+		printf("log lz: %" PRIu32 " -> %" PRIu32 " B (%.1f%%)\n",
+			ls.lz_in, ls.lz_out, 100.0 * ls.lz_out / ls.lz_in);
+	}
+	if (ls.id_collisions) {
+		printf("log node_id collisions: %" PRIu32 "\n", ls.id_collisions);
+	}
+
+	if (s_opt.time_sync_ms) report_time();
+
+	if (s_opt.cmd_bin) {
+		void (*get)(mesh_cmd_stats_t *) = (void (*)(mesh_cmd_stats_t *))node_sym(&sim_nodes[0], "mesh_cmd_get_stats");
+		mesh_cmd_stats_t root_st, sum = { 0 };
+		get(&root_st);
+
+		for (int i = 1; i < sim_node_count; i++) {
+			get = (void (*)(mesh_cmd_stats_t *))node_sym(&sim_nodes[i], "mesh_cmd_get_stats");
+			mesh_cmd_stats_t st;
+			get(&st);
+			sum.rx += st.rx;
+			sum.dup += st.dup;
+			sum.bad += st.bad;
+			if (st.node_us_max > sum.node_us_max) sum.node_us_max = st.node_us_max;
+		}
+		printf("\ncmd: root tx %" PRIu32 " (err %" PRIu32 "), nodes rx %" PRIu32 ", dup %" PRIu32 ", bad %" PRIu32
+		       ", rx->apply max %" PRIu32 " us\n",
+			root_st.tx, root_st.tx_err, sum.rx, sum.dup, sum.bad, sum.node_us_max);
+		if (root_st.acks) {
+			printf("cmd ack: %" PRIu32 " (unknown %" PRIu32 "), RTT avg %.0f us, max %" PRIu32 " us\n",
+				root_st.acks, root_st.ack_unknown,
+				(double)root_st.ack_rtt_us_total / root_st.acks, root_st.ack_rtt_us_max);
+		}
+		if (root_st.trace_acks) {
+			int (*rows_fn)(mesh_cmd_trace_row_t *, int);
+			mesh_cmd_trace_row_t rows[SIM_MAX_NODES];
+
+			printf("cmd trace: %" PRIu32 " ack(s), unsynced %" PRIu32 ", no slot %" PRIu32
+			       "; root send -> output written\n",
+				root_st.trace_acks, root_st.trace_unsynced, root_st.trace_no_slot);
+			printf("layer        n   p50_us   p99_us   max_us   net_p50  queue_p50  apply_p50\n");
+			rows_fn = (int (*)(mesh_cmd_trace_row_t *, int))node_sym(&sim_nodes[0], "mesh_cmd_trace_layers");
+			int n = rows_fn(rows, SIM_MAX_NODES);
+			for (int i = 0; i < n; i++) {
+				printf("%-5u %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %9" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+					(unsigned)rows[i].layer, rows[i].n, rows[i].p50_us, rows[i].p99_us, rows[i].max_us,
+					rows[i].net_p50_us, rows[i].queue_p50_us, rows[i].apply_p50_us);
+			}
+
+			printf("node  layer        n   p50_us   p99_us   max_us\n");
+			rows_fn = (int (*)(mesh_cmd_trace_row_t *, int))node_sym(&sim_nodes[0], "mesh_cmd_trace_nodes");
+			n = rows_fn(rows, SIM_MAX_NODES);
+			for (int i = 0; i < n; i++) {
+				printf("%-5d %5u %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n",
+					sim_mesh_find_mac(rows[i].mac), (unsigned)rows[i].layer, rows[i].n,
+					rows[i].p50_us, rows[i].p99_us, rows[i].max_us);
+			}
+		}
+	}
+
+	if (s_opt.uplink_period_ms) {
+		printf("\nnode  queued     sent  tx_pkts  batched  coalesced  retries  disc  drop_full  drop_exp  drop_err"
+		       "  q_p50_us  q_p99_us  q_max_us\n");
+		legacy_root_sender_stats_t sum = { 0 };
+		for (int i = 1; i < sim_node_count; i++) {
+			void (*get)(legacy_root_sender_stats_t *) =
+				(void (*)(legacy_root_sender_stats_t *))node_sym(&sim_nodes[i], "legacy_root_sender_get_stats");
+			legacy_root_sender_stats_t st;
+			get(&st);
+			sum.queued += st.queued;
+			sum.sent += st.sent;
+			sum.tx_pkts += st.tx_pkts;
+			sum.batched += st.batched;
+			sum.coalesced += st.coalesced;
+			sum.retries += st.retries;
+			sum.drop_full += st.drop_full;
+			sum.drop_expired += st.drop_expired;
+			sum.drop_err += st.drop_err;
+			sum.q_lat_us_total += st.q_lat_us_total;
+			sum.store_sent += st.store_sent;
+			if (st.q_lat_us_max > sum.q_lat_us_max) sum.q_lat_us_max = st.q_lat_us_max;
+
+			// тільки цікаві ноди: з --flap або з втратами
+			if (!sim_nodes[i].flap_period_us && !st.drop_full && !st.drop_expired && !st.retries && !st.store_sent &&
+			    !st.batched && !st.coalesced) continue;
+			printf("%-5d %6" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %8" PRIu32 " %5" PRIu64
+			       " %10" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 "\n",
+				i, st.queued, st.sent, st.tx_pkts, st.batched, st.coalesced, st.retries, sim_nodes[i].tx_disc,
+				st.drop_full, st.drop_expired, st.drop_err, st.q_lat_p50_us, st.q_lat_p99_us, st.q_lat_us_max);
+		}
+		uint32_t ram_sent = sum.sent - sum.store_sent;
+		printf("uplink: queued %" PRIu32 ", sent %" PRIu32 " in %" PRIu32 " pkt(s) (%" PRIu32 " batched), coalesced %" PRIu32
+		       ", retries %" PRIu32 ", dropped full %" PRIu32 " / expired %" PRIu32 " / err %" PRIu32
+		       ", queue latency avg %.0f us, max %" PRIu32 " us\n",
+			sum.queued, sum.sent, sum.tx_pkts, sum.batched, sum.coalesced, sum.retries, sum.drop_full,
+			sum.drop_expired, sum.drop_err,
+			ram_sent ? (double)sum.q_lat_us_total / ram_sent : 0.0, sum.q_lat_us_max);
+	}
+
+	if (s_opt.uplink_period_ms && s_opt.flash_kb) {
+		printf("\nnode  stored  st_sent  pending  boot_pend  mount_us  recover_ms  commits  erases  erase_max_ms"
+		       "  overwr  payload_B   prog_B    WA\n");
+		flash_ring_stats_t fsum = { 0 };
+		uint32_t stored = 0, store_sent = 0;
+		for (int i = 1; i < sim_node_count; i++) {
+			void (*get)(legacy_root_sender_stats_t *) =
+				(void (*)(legacy_root_sender_stats_t *))node_sym(&sim_nodes[i], "legacy_root_sender_get_stats");
+			void (*fget)(flash_ring_stats_t *) =
+				(void (*)(flash_ring_stats_t *))node_sym(&sim_nodes[i], "flash_ring_get_stats");
+			legacy_root_sender_stats_t st;
+			flash_ring_stats_t fs;
+			get(&st);
+			fget(&fs);
+			stored += st.stored;
+			store_sent += st.store_sent;
+			fsum.pending += fs.pending;
+			fsum.commits += fs.commits;
+			fsum.erases += fs.erases;
+			fsum.overwritten += fs.overwritten;
+			fsum.payload_bytes += fs.payload_bytes;
+			fsum.prog_bytes += fs.prog_bytes;
+			if (fs.erase_us_max > fsum.erase_us_max) fsum.erase_us_max = fs.erase_us_max;
+
+			if (!st.stored && !fs.mount_pending && !fs.prog_bytes) continue;
+			printf("%-5d %6" PRIu32 " %8" PRIu32 " %8" PRIu32 " %10" PRIu32 " %9" PRIu32 " %11.0f %8" PRIu32
+			       " %7" PRIu32 " %13.1f %7" PRIu32 " %10" PRIu64 " %8" PRIu64 " %5.2f\n",
+				i, st.stored, st.store_sent, fs.pending, fs.mount_pending, fs.mount_us,
+				st.store_recover_us / 1000.0, fs.commits, fs.erases, fs.erase_us_max / 1000.0,
+				fs.overwritten, fs.payload_bytes, fs.prog_bytes,
+				fs.payload_bytes ? (double)fs.prog_bytes / fs.payload_bytes : 0.0);
+		}
+		printf("flash store: stored %" PRIu32 ", sent from flash %" PRIu32 ", pending %" PRIu32 ", overwritten %" PRIu32
+		       ", %" PRIu32 " page write(s), %" PRIu32 " erase(s) (max %.1f ms), write amplification %.2f"
+		       " (%" PRIu64 " B programmed / %" PRIu64 " B payload)\n",
+			stored, store_sent, fsum.pending, fsum.overwritten, fsum.commits, fsum.erases,
+			fsum.erase_us_max / 1000.0,
+			fsum.payload_bytes ? (double)fsum.prog_bytes / fsum.payload_bytes : 0.0,
+			fsum.prog_bytes, fsum.payload_bytes);
+	}
+
+	if (s_sw.cmds) {
+		powled_node_stats_t ps = { 0 };
+		for (int i = 1; i < sim_node_count; i++) {
+			void (*get)(powled_node_stats_t *) =
+				(void (*)(powled_node_stats_t *))node_sym(&sim_nodes[i], "powled_node_get_stats");
+			powled_node_stats_t st;
+			get(&st);
+			ps.scheduled += st.scheduled;
+			ps.late += st.late;
+			ps.unsynced += st.unsynced;
+			if (st.max_abs_err_us > ps.max_abs_err_us) ps.max_abs_err_us = st.max_abs_err_us;
+		}
+
+		printf("\npowled switch: %" PRIu32 " cmd(s), skew across nodes avg %.0f us, max %" PRId64 " us, missed %" PRIu32 "\n",
+			s_sw.cmds, s_sw.skew_sum / s_sw.cmds, s_sw.skew_max, s_sw.missed);
+
+		uint64_t hal = 0, pin_writes = 0;
+		for (int i = 1; i < sim_node_count; i++) {
+			hal += sim_nodes[i].hal_writes;
+			pin_writes += sim_nodes[i].gpio_writes;
+		}
+		printf("powled outputs: %d pin(s)/node, register writes %" PRIu64 " (%.2f per node per cmd), "
+		       "gpio_set_level %" PRIu64 ", nodes with channels out of step %" PRIu32 "\n",
+			__builtin_popcountll(sim_nodes[1].hal_pins), hal,
+			(double)hal / (sim_node_count - 1) / s_sw.cmds, pin_writes, s_sw.bad_state);
+
+		if (s_opt.dim) {
+			powled_fade_stats_t fs = { 0 };
+			uint64_t waits = 0;
+			for (int i = 1; i < sim_node_count; i++) {
+				void (*get)(powled_fade_stats_t *) =
+					(void (*)(powled_fade_stats_t *))node_sym(&sim_nodes[i], "powled_fade_get_stats");
+				powled_fade_stats_t st;
+				get(&st);
+				fs.fades += st.fades;
+				fs.coalesced += st.coalesced;
+				fs.deferred += st.deferred;
+				fs.clamped += st.clamped;
+				waits += sim_nodes[i].hal_fade_waits;
+			}
+			printf("powled fade: %" PRIu32 " fade(s) started, deferred %" PRIu32 ", coalesced %" PRIu32
+			       ", clamped %" PRIu32 ", blocked in driver %" PRIu64 ", ch0 off target at next cmd %" PRIu32 "\n",
+				fs.fades, fs.deferred, fs.coalesced, fs.clamped, waits, s_sw.bad_duty);
+		}
+		if (s_sw.lat_n) {
+			printf("powled latency: root send -> GPIO avg %.0f us, max %" PRId64 " us\n",
+				s_sw.lat_sum / s_sw.lat_n, s_sw.lat_max);
+		}
+		if (s_sw.err_n) {
+			printf("powled at: |switch - target| avg %.0f us, max %" PRId64 " us; nodes: scheduled %" PRIu32
+			       ", late %" PRIu32 ", unsynced %" PRIu32 ", self-measured max err %" PRId32 " us\n",
+				s_sw.err_sum / s_sw.err_n, s_sw.err_max, ps.scheduled, ps.late, ps.unsynced,
+				ps.max_abs_err_us);
+		}
+	}
+
+	// mesh_tx: суми по всіх нодах, перцентилі — найгірша нода, темп — середній і найменший
+	static const char *cls_name[MESH_TX_CLASSES] = { "ctrl", "time", "telemetry", "log" };
+	mesh_tx_class_stats_t txs[MESH_TX_CLASSES] = { 0 };
+	uint64_t pps_sum[MESH_TX_CLASSES] = { 0 };
+	for (int i = 0; i < sim_node_count; i++) {
+		void (*get)(mesh_tx_class_stats_t *) =
+			(void (*)(mesh_tx_class_stats_t *))node_sym(&sim_nodes[i], "mesh_tx_get_stats");
+		mesh_tx_class_stats_t st[MESH_TX_CLASSES];
+		get(st);
+		for (int c = 0; c < MESH_TX_CLASSES; c++) {
+			txs[c].sent += st[c].sent;
+			txs[c].bytes += st[c].bytes;
+			txs[c].err += st[c].err;
+			txs[c].held += st[c].held;
+			txs[c].refused += st[c].refused;
+			txs[c].dropped += st[c].dropped;
+			txs[c].decreases += st[c].decreases;
+			if (st[c].q_p50_us > txs[c].q_p50_us) txs[c].q_p50_us = st[c].q_p50_us;
+			if (st[c].q_p99_us > txs[c].q_p99_us) txs[c].q_p99_us = st[c].q_p99_us;
+			if (st[c].q_max_us > txs[c].q_max_us) txs[c].q_max_us = st[c].q_max_us;
+			if (st[c].pps) {
+				pps_sum[c] += st[c].pps;
+				txs[c].pps++;	// нод з темпом
+				if (!txs[c].pps_min || st[c].pps_min < txs[c].pps_min) txs[c].pps_min = st[c].pps_min;
+			}
+		}
+	}
+	printf("\ntx class      sent   pkt/s    kB/s     err  dropped  drop%%    held  refused  q_p50_us  q_p99_us  q_max_us"
+	       "  pace/s  pace_min  cuts\n");
+	for (int c = 0; c < MESH_TX_CLASSES; c++) {
+		uint32_t lost = txs[c].dropped;
+		printf("%-10s %7" PRIu32 " %7.1f %7.2f %7" PRIu32 " %8" PRIu32 " %6.2f %7" PRIu32 " %8" PRIu32
+		       " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %7.0f %9" PRIu32 " %5" PRIu32 "\n",
+			cls_name[c], txs[c].sent, txs[c].sent / secs, txs[c].bytes / 1024.0 / secs,
+			txs[c].err, txs[c].dropped,
+			txs[c].sent + lost ? 100.0 * lost / (txs[c].sent + lost) : 0.0,
+			txs[c].held, txs[c].refused, txs[c].q_p50_us, txs[c].q_p99_us, txs[c].q_max_us,
+			txs[c].pps ? (double)pps_sum[c] / txs[c].pps : 0.0, txs[c].pps_min, txs[c].decreases);
+	}
+	printf("(q_*: worst node; pace/s: avg over nodes)\n");
+
+	// mesh_hdr: скільки пакетів пішло з v2 і середній заголовок на дроті
+	mesh_hdr_stats_t hs = { 0 };
+	int v1_fw = 0, with_id = 0;
+	for (int i = 0; i < sim_node_count; i++) {
+		void (*get)(mesh_hdr_stats_t *) =
+			(void (*)(mesh_hdr_stats_t *))node_sym(&sim_nodes[i], "mesh_hdr_get_stats");
+		mesh_hdr_stats_t st;
+		get(&st);
+		hs.tx_v2 += st.tx_v2;
+		hs.tx_v1 += st.tx_v1;
+		hs.hdr_saved += st.hdr_saved;
+		hs.rx_v2 += st.rx_v2;
+		hs.bad_crc += st.bad_crc;
+		hs.bad_v2 += st.bad_v2;
+		hs.ids_assigned += st.ids_assigned;
+		hs.id_sent += st.id_sent;
+		if (s_opt.v1[i]) v1_fw++;
+		if (st.root_v2) with_id++;
+	}
+	printf("\nheader: tx v2 %" PRIu32 " (avg %.1f B), v1 %" PRIu32 " (14 B), saved %.1f kB; rx v2 %" PRIu32
+	       ", bad crc %" PRIu32 ", bad %" PRIu32 "; ids %" PRIu32 " (NODE_ID sent %" PRIu32 "),"
+	       " nodes on v2 %d, v1 firmware %d\n",
+		hs.tx_v2, hs.tx_v2 ? 14.0 - (double)hs.hdr_saved / hs.tx_v2 : 0.0, hs.tx_v1,
+		hs.hdr_saved / 1024.0, hs.rx_v2, hs.bad_crc, hs.bad_v2, hs.ids_assigned, hs.id_sent,
+		with_id, v1_fw);
+
+	printf("\nrx pool: exhausted %" PRIu32 ", max worker queue %" PRIu32 "\n", pool_ex, work_q_max);
+
+	printf("\ntotal: tx %" PRIu64 " pkts (%.1f pkt/s, %.1f kB/s), rx %" PRIu64
+	       " pkts (%" PRIu64 " B), lost %" PRIu64 ", rxq drops %" PRIu64 " in %.1f s\n",
+		tx, (double)tx / secs, (double)txb / 1024.0 / secs, rx, rxb, lost, drops, secs);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option opts[] = {
+		{ "nodes",		required_argument,	NULL, 'n' },
+		{ "fanout",		required_argument,	NULL, 'f' },
+		{ "chain",		no_argument,		NULL, 'c' },
+		{ "latency-us",		required_argument,	NULL, 'l' },
+		{ "jitter-us",		required_argument,	NULL, 'j' },
+		{ "loss",		required_argument,	NULL, 'p' },
+		{ "link",		required_argument,	NULL, 'L' },
+		{ "link-kbps",		required_argument,	NULL, 'H' },
+		{ "seed",		required_argument,	NULL, 's' },
+		{ "drift-ppm",		required_argument,	NULL, 'D' },
+		{ "duration-s",		required_argument,	NULL, 'd' },
+		{ "uart",		no_argument,		NULL, 'u' },
+		{ "uart-dir",		required_argument,	NULL, 'U' },
+		{ "log-stream",		no_argument,		NULL, 'S' },
+		{ "log-batch",		no_argument,		NULL, 'B' },
+		{ "log-bin",		no_argument,		NULL, 'b' },
+		{ "log-compact",	no_argument,		NULL, 'k' },
+		{ "log-lz",		no_argument,		NULL, 'z' },
+		{ "log-level",		required_argument,	NULL, 'v' },
+		{ "log-allow",		required_argument,	NULL, 'a' },
+		{ "log-deny",		required_argument,	NULL, 'x' },
+		{ "log-storm",		required_argument,	NULL, 'E' },
+		{ "log-storm-seq",	no_argument,		NULL, 'e' },
+		{ "capture",		required_argument,	NULL, 'W' },
+		{ "cmd-period-ms",	required_argument,	NULL, 'C' },
+		{ "cmd-at-ms",		required_argument,	NULL, 'A' },
+		{ "cmd-bin",		no_argument,		NULL, 'M' },
+		{ "cmd-ack",		no_argument,		NULL, 'K' },
+		{ "cmd-mask",		required_argument,	NULL, 'm' },
+		{ "cmd-level",		required_argument,	NULL, 'V' },
+		{ "cmd-fade-ms",	required_argument,	NULL, 'F' },
+		{ "dim",		no_argument,		NULL, 'i' },
+		{ "v1-nodes",		required_argument,	NULL, '1' },
+		{ "cmd-trace",		no_argument,		NULL, 'R' },
+		{ "uplink-period-ms",	required_argument,	NULL, 'P' },
+		{ "uplink-burst",	required_argument,	NULL, 'N' },
+		{ "uplink-keyed",	no_argument,		NULL, 'O' },
+		{ "flap",		required_argument,	NULL, 'G' },
+		{ "flash-kb",		required_argument,	NULL, 'Q' },
+		{ "flash-dir",		required_argument,	NULL, 'Y' },
+		{ "time-sync-ms",	required_argument,	NULL, 'T' },
+		{ "help",		no_argument,		NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	struct { int id; uint32_t lat; double loss; } links[SIM_MAX_NODES];
+	int nlinks = 0;
+	struct { int id; uint32_t period_ms, down_ms; } flaps[SIM_MAX_NODES];
+	int nflaps = 0;
+
+	sim_core_init();
+
+	int c;
+	while ((c = getopt_long(argc, argv, "h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'n': s_opt.nodes = atoi(optarg); break;
+		case 'f': s_opt.fanout = atoi(optarg); break;
+		case 'c': s_opt.chain = true; break;
+		case 'l': s_opt.latency_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'j': s_opt.jitter_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'p': s_opt.loss_pct = atof(optarg); break;
+		case 'H': sim_link_kbps = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 's': s_opt.seed = strtoull(optarg, NULL, 0); break;
+		case 'D': s_opt.drift_ppm = atof(optarg); break;
+		case 'd': s_opt.duration_s = atoi(optarg); break;
+		case 'u': s_opt.uart = true; break;
+		case 'U': s_opt.uart_dir = optarg; break;
+		case 'S': s_opt.log_stream = true; break;
+		case 'B': s_opt.log_stream = true; s_opt.log_batch = true; break;
+		case 'b': s_opt.log_stream = true; s_opt.log_bin = true; break;
+		case 'k': s_opt.log_stream = true; s_opt.log_compact = true; break;
+		case 'z': s_opt.log_stream = true; s_opt.log_lz = true; break;
+		case 'W': s_opt.capture = optarg; break;
+		case 'E': s_opt.log_storm_hz = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'e': s_opt.log_storm_seq = true; break;
+		case 'v': s_opt.log_level = atoi(optarg); break;
+		case 'a': s_opt.log_tags = optarg; s_opt.log_tag_mode = MESH_LOG_TAGS_ALLOW; break;
+		case 'x': s_opt.log_tags = optarg; s_opt.log_tag_mode = MESH_LOG_TAGS_DENY; break;
+		case 'C': s_opt.cmd_period_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'A': s_opt.cmd_at_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'M': s_opt.cmd_bin = true; break;
+		case 'K': s_opt.cmd_bin = true; s_opt.cmd_ack = true; break;
+		case 'm': s_opt.cmd_bin = true; s_opt.cmd_mask = (uint8_t)strtoul(optarg, NULL, 0); break;
+		case 'V': s_opt.cmd_bin = true; s_opt.cmd_level = (uint8_t)strtoul(optarg, NULL, 0); break;
+		case 'F': s_opt.cmd_bin = true; s_opt.cmd_fade_ms = (uint16_t)strtoul(optarg, NULL, 0); break;
+		case 'i': s_opt.dim = true; break;
+		case '1':
+			for (char *t = strtok(optarg, ","); t; t = strtok(NULL, ",")) {
+				int id = atoi(t);
+				if (id < 0 || id >= SIM_MAX_NODES) {
+					fprintf(stderr, "sim: bad --v1-nodes %s\n", t);
+					return 2;
+				}
+				s_opt.v1[id] = true;
+			}
+			break;
+		case 'R': s_opt.cmd_bin = true; s_opt.cmd_trace = true; break;
+		case 'P': s_opt.uplink_period_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'N': s_opt.uplink_burst = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'O': s_opt.uplink_keyed = true; break;
+		case 'Q': s_opt.flash_kb = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'Y': s_opt.flash_dir = optarg; break;
+		case 'T': s_opt.time_sync_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'G':
+			if (nflaps < SIM_MAX_NODES &&
+			    sscanf(optarg, "%d:%u:%u", &flaps[nflaps].id, &flaps[nflaps].period_ms, &flaps[nflaps].down_ms) == 3 &&
+			    flaps[nflaps].period_ms) {
+				nflaps++;
+				break;
+			}
+			fprintf(stderr, "sim: bad --flap %s\n", optarg);
+			return 2;
+		case 'L':
+			if (nlinks < SIM_MAX_NODES &&
+			    sscanf(optarg, "%d:%u:%lf", &links[nlinks].id, &links[nlinks].lat, &links[nlinks].loss) == 3) {
+				nlinks++;
+				break;
+			}
+			fprintf(stderr, "sim: bad --link %s\n", optarg);
+			return 2;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 2;
+		}
+	}
+
+	if (s_opt.nodes < 1 || s_opt.nodes > SIM_MAX_NODES || s_opt.fanout < 1 || s_opt.uplink_burst < 1) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	build_topology();
+	for (int i = 0; i < nlinks; i++) {
+		if (links[i].id > 0 && links[i].id < sim_node_count) {
+			sim_nodes[links[i].id].uplink.latency_us = links[i].lat;
+			sim_nodes[links[i].id].uplink.loss_ppm = (uint32_t)(links[i].loss * 10000.0);
+		}
+	}
+	for (int i = 0; i < nflaps; i++) {
+		if (flaps[i].id > 0 && flaps[i].id < sim_node_count) {
+			sim_nodes[flaps[i].id].flap_period_us = (int64_t)flaps[i].period_ms * 1000;
+			sim_nodes[flaps[i].id].flap_down_us = (int64_t)flaps[i].down_ms * 1000;
+		}
+	}
+
+	if (s_opt.capture) {
+		FILE *f = fopen(s_opt.capture, "wb");
+		if (!f) {
+			fprintf(stderr, "sim: can't open %s\n", s_opt.capture);
+			return 1;
+		}
+		sim_mesh_set_capture(f);
+	}
+	sim_mesh_start();
+
+	// root "має SNTP": реальний час хоста
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	sim_clock_set_us(&sim_nodes[0], (int64_t)now.tv_sec * 1000000 + now.tv_usec);
+
+	for (int i = 0; i < sim_node_count; i++) {
+		sim_nodes[i].uart = open_uart(i);
+		if (s_opt.flash_kb) flash_attach(&sim_nodes[i]);
+		node_boot(&sim_nodes[i]);
+	}
+
+	printf("sim: %d node(s), %s, hop latency %u us (+%u jitter), loss %.2f%%, seed %" PRIu64 "\n",
+		sim_node_count, s_opt.chain ? "chain" : "tree", s_opt.latency_us, s_opt.jitter_us,
+		s_opt.loss_pct, s_opt.seed);
+
+	sim_node_t *root = &sim_nodes[0];
+	sim_cur = root;
+	if (s_opt.time_sync_ms) {
+		esp_err_t (*start)(uint32_t) = (esp_err_t (*)(uint32_t))node_sym(root, "mesh_time_sync_root_start");
+		start(s_opt.time_sync_ms);
+	}
+	if (s_opt.log_stream || s_opt.cmd_period_ms) {
+		xTaskCreate(root_ctrl_task, "sim_ctrl", 4096, NULL, 5, NULL);
+	}
+	for (int i = 1; s_opt.uplink_period_ms && i < sim_node_count; i++) {
+		sim_cur = &sim_nodes[i];
+		xTaskCreate(node_uplink_task, "sim_uplink", 4096, NULL, 5, NULL);
+	}
+	for (int i = 1; s_opt.log_storm_hz && i < sim_node_count; i++) {
+		sim_cur = &sim_nodes[i];
+		xTaskCreate(node_log_storm_task, "sim_storm", 4096, NULL, 4, NULL);
+	}
+	sim_cur = NULL;
+
+	int64_t t0 = sim_mono_us();
+	sleep((unsigned)s_opt.duration_s);
+	report((double)(sim_mono_us() - t0) / 1e6);
+
+	fflush(NULL);
+	_exit(0);
+}
@@ -0,0 +1,513 @@
+/*
+ * Host-симулятор: віртуальна mesh-мережа.
+ *
+ * Ноди з'єднані деревом (sim_node_t.parent). esp_mesh_send() прокладає шлях
+ * src -> LCA -> dst, на кожному хопі додає затримку/джитер лінка і розігрує
+ * втрату від власного PRNG лінка (тобто втрати детерміновані для заданого seed
+ * і порядку пакетів). З --link-kbps лінк ще й передає по одному пакету за раз:
+ * наступний чекає, поки попередній не пройде (FIFO драйвера в кожному напрямку). Пакет потрапляє в "ефір" (heap за часом доставки), а
+ * окремий потік кладе його в RX-чергу ноди-одержувача, звідки його забирає
+ * esp_mesh_recv().
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_mesh.h"
+#include "esp_wifi.h"
+
+#include "sim.h"
+
+const char *MESH_EVENT = "MESH_EVENT";
+
+struct sim_pkt {
+	int64_t		at_us;
+	uint64_t	seq;
+	int		src;
+	int		dst;
+	int		flag;
+	uint16_t	size;
+	uint8_t		data[];
+};
+
+#define AIR_MAX		4096
+
+static pthread_mutex_t	s_air_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	s_air_cv;
+static sim_pkt_t	*s_air[AIR_MAX];
+static int		s_air_n = 0;
+static uint64_t		s_air_seq = 0;
+static int64_t		s_last_at[SIM_MAX_NODES][SIM_MAX_NODES];
+
+static FILE		*s_capture = NULL;	// пакети для root: { uint16_t len; data[len] }
+
+/* -------------------------------------------------------------------------- */
+/*  "Ефір": мін-heap пакетів за часом доставки                                */
+/* -------------------------------------------------------------------------- */
+
+static bool air_less(const sim_pkt_t *a, const sim_pkt_t *b)
+{
+	if (a->at_us != b->at_us) return a->at_us < b->at_us;
+	return a->seq < b->seq;
+}
+
+static void air_push(sim_pkt_t *p)
+{
+	int i = s_air_n++;
+	s_air[i] = p;
+	while (i > 0) {
+		int up = (i - 1) / 2;
+		if (!air_less(s_air[i], s_air[up])) break;
+		sim_pkt_t *t = s_air[i]; s_air[i] = s_air[up]; s_air[up] = t;
+		i = up;
+	}
+}
+
+static sim_pkt_t *air_pop(void)
+{
+	sim_pkt_t *top = s_air[0];
+	s_air[0] = s_air[--s_air_n];
+
+	int i = 0;
+	for (;;) {
+		int l = 2 * i + 1, r = l + 1, m = i;
+		if (l < s_air_n && air_less(s_air[l], s_air[m])) m = l;
+		if (r < s_air_n && air_less(s_air[r], s_air[m])) m = r;
+		if (m == i) break;
+		sim_pkt_t *t = s_air[i]; s_air[i] = s_air[m]; s_air[m] = t;
+		i = m;
+	}
+	return top;
+}
+
+static void deliver(sim_pkt_t *p)
+{
+	sim_node_t *src = &sim_nodes[p->src];
+	sim_node_t *dst = &sim_nodes[p->dst];
+
+	pthread_mutex_lock(&src->mu);
+	src->tx_pending--;
+	pthread_cond_broadcast(&src->cv);
+	pthread_mutex_unlock(&src->mu);
+
+	// пише тільки air-потік
+	if (s_capture && p->dst == 0) {
+		uint8_t hdr[2] = { (uint8_t)p->size, (uint8_t)(p->size >> 8) };
+		fwrite(hdr, 1, sizeof(hdr), s_capture);
+		fwrite(p->data, 1, p->size, s_capture);
+	}
+
+	pthread_mutex_lock(&dst->mu);
+	if (dst->rxq_count >= SIM_RXQ_LEN) {
+		dst->rxq_drops++;
+		pthread_mutex_unlock(&dst->mu);
+		free(p);
+		return;
+	}
+	dst->rxq[(dst->rxq_head + dst->rxq_count) % SIM_RXQ_LEN] = p;
+	dst->rxq_count++;
+	if (dst->rxq_count > dst->rxq_max) dst->rxq_max = dst->rxq_count;
+	pthread_cond_broadcast(&dst->cv);
+	pthread_mutex_unlock(&dst->mu);
+}
+
+void sim_mesh_set_capture(FILE *f)
+{
+	s_capture = f;
+}
+
+static void *air_thread(void *arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&s_air_mu);
+	for (;;) {
+		while (s_air_n == 0) {
+			pthread_cond_wait(&s_air_cv, &s_air_mu);
+		}
+
+		int64_t now = sim_mono_us();
+		if (s_air[0]->at_us > now) {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			int64_t wait = s_air[0]->at_us - now;
+			ts.tv_sec  += (time_t)(wait / 1000000);
+			ts.tv_nsec += (long)(wait % 1000000) * 1000;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&s_air_cv, &s_air_mu, &ts);
+			continue;
+		}
+
+		sim_pkt_t *p = air_pop();
+		pthread_mutex_unlock(&s_air_mu);
+		deliver(p);
+		pthread_mutex_lock(&s_air_mu);
+	}
+	return NULL;
+}
+
+void sim_mesh_start(void)
+{
+	pthread_condattr_t a;
+	pthread_condattr_init(&a);
+	pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+	pthread_cond_init(&s_air_cv, &a);
+	pthread_condattr_destroy(&a);
+
+	pthread_t th;
+	pthread_create(&th, NULL, air_thread, NULL);
+	pthread_detach(th);
+}
+
+void sim_mesh_node_init(sim_node_t *n)
+{
+	pthread_condattr_t a;
+	pthread_condattr_init(&a);
+	pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+	pthread_mutex_init(&n->mu, NULL);
+	pthread_cond_init(&n->cv, &a);
+	pthread_condattr_destroy(&a);
+}
+
+int sim_mesh_find_mac(const uint8_t mac[6])
+{
+	for (int i = 0; i < sim_node_count; i++) {
+		if (memcmp(sim_nodes[i].mac, mac, 6) == 0) return i;
+	}
+	return -1;
+}
+
+void sim_mesh_post_event(sim_node_t *n, int32_t event_id, void *event_data)
+{
+	if (!n->mesh_handler) return;
+
+	sim_node_t *prev = sim_cur;
+	sim_cur = n;
+	n->mesh_handler(n->mesh_handler_arg, MESH_EVENT, event_id, event_data);
+	sim_cur = prev;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Маршрут і модель лінків                                                   */
+/* -------------------------------------------------------------------------- */
+
+static bool is_ancestor(int anc, int node)
+{
+	for (int x = node; x >= 0; x = sim_nodes[x].parent) {
+		if (x == anc) return true;
+	}
+	return false;
+}
+
+uint32_t sim_link_kbps = 0;
+
+// true => пакет пройшов хоп; *t_us — коли він буде на іншому кінці лінка
+static bool link_hop(sim_link_t *l, int64_t *busy_us, uint16_t size, int64_t *t_us)
+{
+	uint64_t r = sim_rand_next(&l->rng);
+
+	if (sim_link_kbps) {
+		if (*t_us < *busy_us) *t_us = *busy_us;
+		*t_us += (int64_t)size * 8000 / sim_link_kbps;
+		*busy_us = *t_us;
+	}
+
+	*t_us += l->latency_us;
+	if (l->jitter_us) *t_us += (int64_t)((r >> 16) % (l->jitter_us + 1));
+
+	return ((r >> 40) % 1000000) >= l->loss_ppm;
+}
+
+// Повертає false, якщо пакет загубився на одному з хопів
+static bool route(int src, int dst, uint16_t size, int64_t *t_us)
+{
+	bool ok = true;
+
+	// вгору до спільного предка
+	int x = src;
+	while (!is_ancestor(x, dst)) {
+		sim_link_t *l = &sim_nodes[x].uplink;
+		if (!link_hop(l, &l->busy_up_us, size, t_us)) ok = false;
+		x = sim_nodes[x].parent;
+	}
+
+	// вниз від предка до dst (лінки дітей на шляху, з кінця)
+	int path[SIM_MAX_NODES];
+	int n = 0;
+	for (int y = dst; y != x; y = sim_nodes[y].parent) path[n++] = y;
+	while (n > 0) {
+		sim_link_t *l = &sim_nodes[path[--n]].uplink;
+		if (!link_hop(l, &l->busy_down_us, size, t_us)) ok = false;
+	}
+	return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  esp_mesh API                                                              */
+/* -------------------------------------------------------------------------- */
+
+esp_err_t esp_mesh_init(void)					{ return ESP_OK; }
+esp_err_t esp_mesh_start(void)					{ return ESP_OK; }
+esp_err_t esp_mesh_stop(void)					{ return ESP_OK; }
+esp_err_t esp_mesh_set_config(const mesh_cfg_t *config)	{ (void)config; return ESP_OK; }
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo)	{ (void)topo; return ESP_OK; }
+esp_mesh_topology_t esp_mesh_get_topology(void)			{ return MESH_TOPO_TREE; }
+esp_err_t esp_mesh_set_max_layer(int max_layer)			{ (void)max_layer; return ESP_OK; }
+esp_err_t esp_mesh_set_vote_percentage(float percentage)	{ (void)percentage; return ESP_OK; }
+esp_err_t esp_mesh_set_xon_qsize(int qsize)			{ (void)qsize; return ESP_OK; }
+int esp_mesh_get_xon_qsize(void)				{ return SIM_RXQ_LEN; }
+esp_err_t esp_mesh_set_ap_authmode(wifi_auth_mode_t authmode)	{ (void)authmode; return ESP_OK; }
+esp_err_t esp_mesh_set_ap_assoc_expire(int seconds)		{ (void)seconds; return ESP_OK; }
+esp_err_t esp_mesh_fix_root(bool enable)			{ (void)enable; return ESP_OK; }
+bool esp_mesh_is_root_fixed(void)				{ return false; }
+esp_err_t esp_mesh_enable_ps(void)				{ return ESP_OK; }
+esp_err_t esp_mesh_disable_ps(void)				{ return ESP_OK; }
+bool esp_mesh_is_ps_enabled(void)				{ return false; }
+
+bool esp_mesh_is_root(void)
+{
+	return sim_cur && sim_cur->parent < 0;
+}
+
+int esp_mesh_get_layer(void)
+{
+	return sim_cur ? sim_cur->layer : -1;
+}
+
+esp_err_t esp_mesh_get_id(mesh_addr_t *id)
+{
+	if (!id) return ESP_ERR_MESH_ARGUMENT;
+	memset(id->addr, 0x77, sizeof(id->addr));
+	return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_parent_bssid(mesh_addr_t *bssid)
+{
+	if (!bssid || !sim_cur) return ESP_ERR_MESH_ARGUMENT;
+	if (sim_cur->parent < 0) return ESP_ERR_MESH_NOT_START;
+	memcpy(bssid->addr, sim_nodes[sim_cur->parent].mac, 6);
+	bssid->addr[5]++;	// softAP MAC батька
+	return ESP_OK;
+}
+
+// Діти ноди — станції на її softAP (їх STA MAC = mesh-адреса)
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta)
+{
+	if (!sta || !sim_cur) return ESP_ERR_INVALID_ARG;
+
+	sta->num = 0;
+	for (int i = 0; i < sim_node_count && sta->num < ESP_WIFI_MAX_CONN_NUM; i++) {
+		if (sim_nodes[i].parent != sim_cur->id) continue;
+		memcpy(sta->sta[sta->num].mac, sim_nodes[i].mac, 6);
+		sta->sta[sta->num].rssi = -50;
+		sta->num++;
+	}
+	return ESP_OK;
+}
+
+int esp_mesh_get_routing_table_size(void)
+{
+	int n = 0;
+	for (int i = 0; sim_cur && i < sim_node_count; i++) {
+		if (is_ancestor(sim_cur->id, i)) n++;
+	}
+	return n;
+}
+
+esp_err_t esp_mesh_get_routing_table(mesh_addr_t *mac, int len, int *size)
+{
+	if (!mac || !size || !sim_cur) return ESP_ERR_MESH_ARGUMENT;
+
+	int cap = len / 6;
+	int n = 0;
+	for (int i = 0; i < sim_node_count && n < cap; i++) {
+		if (is_ancestor(sim_cur->id, i)) {
+			memcpy(mac[n].addr, sim_nodes[i].mac, 6);
+			n++;
+		}
+	}
+	*size = n;
+	return ESP_OK;
+}
+
+int esp_mesh_get_total_node_num(void)
+{
+	return sim_node_count;
+}
+
+esp_err_t esp_mesh_get_tx_pending(mesh_tx_pending_t *pending)
+{
+	if (!pending || !sim_cur) return ESP_ERR_MESH_ARGUMENT;
+
+	memset(pending, 0, sizeof(*pending));
+	pthread_mutex_lock(&sim_cur->mu);
+	pending->to_parent_p2p = sim_cur->tx_pending;
+	pthread_mutex_unlock(&sim_cur->mu);
+	return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_rx_pending(mesh_rx_pending_t *pending)
+{
+	if (!pending || !sim_cur) return ESP_ERR_MESH_ARGUMENT;
+
+	pthread_mutex_lock(&sim_cur->mu);
+	pending->toDS = 0;
+	pending->toSelf = sim_cur->rxq_count;
+	pthread_mutex_unlock(&sim_cur->mu);
+	return ESP_OK;
+}
+
+int esp_mesh_available_txupQ_num(const mesh_addr_t *addr, uint32_t *xseqno_in)
+{
+	(void)addr;
+	if (xseqno_in) *xseqno_in = 0;
+	if (!sim_cur) return 0;
+
+	pthread_mutex_lock(&sim_cur->mu);
+	int n = SIM_TXQ_LEN - sim_cur->tx_pending;
+	pthread_mutex_unlock(&sim_cur->mu);
+	return n;
+}
+
+esp_err_t esp_mesh_send(const mesh_addr_t *to, const mesh_data_t *data,
+			int flag, const mesh_opt_t opt[], int opt_count)
+{
+	(void)opt;
+	(void)opt_count;
+
+	sim_node_t *n = sim_cur;
+	if (!n || !data || !data->data) return ESP_ERR_MESH_ARGUMENT;
+	if (data->size > MESH_MPS) return ESP_ERR_MESH_EXCEED_MTU;
+
+	static const uint8_t zero[6] = { 0 };
+	int dst = 0;
+	if (to && memcmp(to->addr, zero, 6) != 0) {
+		dst = sim_mesh_find_mac(to->addr);
+		if (dst < 0) return ESP_ERR_MESH_NO_ROUTE_FOUND;
+	}
+
+	// батько "зник" (--flap): вгору відправити нічим
+	if (n->parent >= 0 && n->flap_period_us && !is_ancestor(n->id, dst) &&
+	    sim_mono_us() % n->flap_period_us < n->flap_down_us) {
+		__atomic_add_fetch(&n->tx_disc, 1, __ATOMIC_RELAXED);
+		return ESP_ERR_MESH_DISCONNECTED;
+	}
+
+	// місце в TX-черзі
+	pthread_mutex_lock(&n->mu);
+	while (n->tx_pending >= SIM_TXQ_LEN) {
+		if (flag & MESH_DATA_NONBLOCK) {
+			n->tx_full++;
+			pthread_mutex_unlock(&n->mu);
+			return ESP_ERR_MESH_QUEUE_FULL;
+		}
+		pthread_cond_wait(&n->cv, &n->mu);
+	}
+	n->tx_pending++;
+	n->tx_pkts++;
+	n->tx_bytes += data->size;
+	pthread_mutex_unlock(&n->mu);
+
+	sim_pkt_t *p = (sim_pkt_t *)malloc(sizeof(*p) + data->size);
+	if (!p) {
+		pthread_mutex_lock(&n->mu);
+		n->tx_pending--;
+		pthread_mutex_unlock(&n->mu);
+		return ESP_ERR_MESH_NO_MEMORY;
+	}
+	p->src = n->id;
+	p->dst = dst;
+	p->flag = flag & (MESH_DATA_P2P | MESH_DATA_FROMDS | MESH_DATA_TODS);
+	p->size = data->size;
+	memcpy(p->data, data->data, data->size);
+
+	pthread_mutex_lock(&s_air_mu);
+
+	int64_t at = sim_mono_us();
+	bool ok = route(n->id, dst, p->size, &at);
+
+	if (!ok || s_air_n >= AIR_MAX) {
+		pthread_mutex_unlock(&s_air_mu);
+		free(p);
+		pthread_mutex_lock(&n->mu);
+		n->tx_pending--;
+		n->lost++;
+		pthread_cond_broadcast(&n->cv);
+		pthread_mutex_unlock(&n->mu);
+		// відправник про втрату на проміжному хопі не дізнається
+		return ESP_OK;
+	}
+
+	// P2P esp-mesh зберігає порядок між парою нод
+	p->at_us = at;
+	if (p->at_us < s_last_at[n->id][dst]) p->at_us = s_last_at[n->id][dst];
+	s_last_at[n->id][dst] = p->at_us;
+	p->seq = ++s_air_seq;
+
+	air_push(p);
+	pthread_cond_signal(&s_air_cv);
+	pthread_mutex_unlock(&s_air_mu);
+	return ESP_OK;
+}
+
+esp_err_t esp_mesh_recv(mesh_addr_t *from, mesh_data_t *data, int timeout_ms,
+			int *flag, mesh_opt_t opt[], int opt_count)
+{
+	(void)opt;
+	(void)opt_count;
+
+	sim_node_t *n = sim_cur;
+	if (!n || !data || !data->data) return ESP_ERR_MESH_ARGUMENT;
+
+	struct timespec dl;
+	clock_gettime(CLOCK_MONOTONIC, &dl);
+	if (timeout_ms > 0) {
+		dl.tv_sec  += timeout_ms / 1000;
+		dl.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+		if (dl.tv_nsec >= 1000000000L) {
+			dl.tv_sec++;
+			dl.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&n->mu);
+	while (n->rxq_count == 0) {
+		if (timeout_ms == 0) {
+			pthread_mutex_unlock(&n->mu);
+			return ESP_ERR_MESH_TIMEOUT;
+		}
+		if (timeout_ms < 0) {
+			pthread_cond_wait(&n->cv, &n->mu);
+		} else if (pthread_cond_timedwait(&n->cv, &n->mu, &dl) == ETIMEDOUT) {
+			pthread_mutex_unlock(&n->mu);
+			return ESP_ERR_MESH_TIMEOUT;
+		}
+	}
+
+	sim_pkt_t *p = n->rxq[n->rxq_head];
+	n->rxq_head = (n->rxq_head + 1) % SIM_RXQ_LEN;
+	n->rxq_count--;
+	n->rx_pkts++;
+	n->rx_bytes += p->size;
+	pthread_mutex_unlock(&n->mu);
+
+	esp_err_t err = ESP_OK;
+	if (p->size > data->size) {
+		err = ESP_ERR_MESH_ARGUMENT;
+	} else {
+		memcpy(data->data, p->data, p->size);
+		data->size = p->size;
+		data->proto = MESH_PROTO_BIN;
+		data->tos = MESH_TOS_P2P;
+	}
+	if (from) memcpy(from->addr, sim_nodes[p->src].mac, 6);
+	if (flag) *flag = p->flag;
+
+	free(p);
+	return err;
+}
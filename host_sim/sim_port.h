@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * Примусовий include (-include sim_port.h) для вихідників прошивки у host-збірці.
+ *
+ * Кожна віртуальна нода — окрема копія прошивки (dlopen), але процес один, тому
+ * "UART" і годинник реального часу мають бути свої на кожну ноду. Перенаправляємо
+ * stdout/time()/gettimeofday()/settimeofday()/adjtime() у симулятор.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FILE	*sim_node_stdout(void);
+time_t	sim_time(time_t *t);
+int	sim_gettimeofday(struct timeval *tv, void *tz);
+int	sim_settimeofday(const struct timeval *tv, const void *tz);
+int	sim_adjtime(const struct timeval *delta, struct timeval *olddelta);
+unsigned	sim_fmt_id(const void *fmt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef stdout
+#define stdout			sim_node_stdout()
+#define time(t)			sim_time(t)
+#define gettimeofday(tv, tz)	sim_gettimeofday((tv), (tz))
+#define settimeofday(tv, tz)	sim_settimeofday((tv), (tz))
+#define adjtime(d, o)		sim_adjtime((d), (o))
+
+// ID формату для бінарного логу: зсув від бази .so (= адреса в ELF), а не адреса в процесі
+#define LOG_BIN_FMT_ID(fmt)	((uint32_t)sim_fmt_id(fmt))
@@ -0,0 +1,478 @@
+#include "flash_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "flash_ring";
+
+/*
+ * Сектор — послідовність записів [fr_hdr_t][дані][0xFF до кратного 4], далі
+ * стерте (0xFF). Порядок записів — seq, сектори йдуть по колу. Стан запису
+ * лише скидає біти (LIVE -> DONE), тож позначка — запис одного байта без
+ * стирання; DONE на записі означає "прочитано все до його seq включно".
+ */
+
+#define FR_SECTOR	4096
+#define FR_BATCH	256	// сторінка flash: батч пишеться одним програмуванням
+
+#define FR_FREE		0xFF
+#define FR_LIVE		0xFE
+#define FR_DONE		0x00
+
+typedef struct __attribute__((packed)) {
+	uint8_t		state;
+	uint8_t		len;
+	uint16_t	crc;	// esp_rom_crc16_le по seq і даних
+	uint32_t	seq;
+} fr_hdr_t;
+
+#define FR_REC_SIZE(len)	((sizeof(fr_hdr_t) + (len) + 3) & ~3u)
+
+typedef struct {
+	uint16_t	used;	// байтів цілих записів від початку сектора
+	uint16_t	live;	// з них непрочитаних
+	bool		closed;	// далі не пишемо (зіпсований запис або помилка запису)
+} fr_sec_t;
+
+static const esp_partition_t	*s_part = NULL;
+static fr_sec_t			*s_sec;
+static uint32_t			s_nsec;
+static uint32_t			s_seq;
+
+static uint32_t		s_w_sec;		// сюди дописуємо, з s_sec[].used
+static uint32_t		s_r_sec, s_r_off;	// найстаріший непрочитаний
+static uint32_t		s_peek_size;		// розмір запису з останнього peek
+static bool		s_mark;			// є прочитане без позначки DONE
+static uint32_t		s_m_sec, s_m_off;	// останній прочитаний
+
+static uint8_t		s_buf[FR_BATCH];
+static uint16_t		s_buf_len;
+static uint16_t		s_buf_cnt;
+static int64_t		s_dirty_us = INT64_MAX;	// найстаріша незакомічена зміна
+
+static portMUX_TYPE		s_lock = portMUX_INITIALIZER_UNLOCKED;
+static flash_ring_stats_t	s_stats;
+
+static uint16_t rec_crc(uint32_t seq, const uint8_t *data, size_t len)
+{
+	uint16_t crc = esp_rom_crc16_le(0, (const uint8_t *)&seq, sizeof(seq));
+	return esp_rom_crc16_le(crc, data, len);
+}
+
+static void dirty(void)
+{
+	if (s_dirty_us == INT64_MAX) s_dirty_us = esp_timer_get_time();
+}
+
+static esp_err_t fr_write(uint32_t off, const void *src, size_t len)
+{
+	esp_err_t err = esp_partition_write(s_part, off, src, len);
+	if (err == ESP_OK) {
+		portENTER_CRITICAL(&s_lock);
+		s_stats.prog_bytes += len;
+		portEXIT_CRITICAL(&s_lock);
+	}
+	return err;
+}
+
+static esp_err_t fr_erase(uint32_t sec)
+{
+	int64_t t0 = esp_timer_get_time();
+	esp_err_t err = esp_partition_erase_range(s_part, sec * FR_SECTOR, FR_SECTOR);
+	uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.erases++;
+	if (us > s_stats.erase_us_max) s_stats.erase_us_max = us;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (err != ESP_OK) {
+		ESP_LOGE(TAG, "erase sector %" PRIu32 ": %s", sec, esp_err_to_name(err));
+		return err;
+	}
+
+	memset(&s_sec[sec], 0, sizeof(s_sec[sec]));
+	if (s_r_sec == sec) {
+		s_r_off = 0;
+		s_peek_size = 0;
+	}
+	if (s_mark && s_m_sec == sec) s_mark = false;	// разом з записом
+	return ESP_OK;
+}
+
+// Наступний сектор для запису; якщо в ньому ще непрочитане — кільце повне
+static esp_err_t w_advance(void)
+{
+	uint32_t  nx = (s_w_sec + 1) % s_nsec;
+	fr_sec_t *s  = &s_sec[nx];
+
+	if (s->live) {
+		ESP_LOGW(TAG, "ring full, %u record(s) overwritten", s->live);
+		portENTER_CRITICAL(&s_lock);
+		s_stats.overwritten += s->live;
+		s_stats.pending -= s->live;
+		portEXIT_CRITICAL(&s_lock);
+		s->live = 0;
+		if (s_r_sec == nx) {
+			s_r_sec = (nx + 1) % s_nsec;
+			s_r_off = 0;
+			s_peek_size = 0;
+		}
+	}
+	if (s->used || s->closed) {
+		esp_err_t err = fr_erase(nx);
+		if (err != ESP_OK) return err;
+	}
+	s_w_sec = nx;
+	return ESP_OK;
+}
+
+esp_err_t flash_ring_commit(void)
+{
+	if (!s_part) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	if (s_buf_len) {
+		fr_sec_t *w = &s_sec[s_w_sec];
+		esp_err_t err = fr_write(s_w_sec * FR_SECTOR + w->used, s_buf, s_buf_len);
+		if (err != ESP_OK) {
+			// батч лишається, наступний коміт — у новий сектор
+			ESP_LOGE(TAG, "write sector %" PRIu32 ": %s", s_w_sec, esp_err_to_name(err));
+			w->closed = true;
+			w_advance();
+			return err;
+		}
+		w->used += s_buf_len;
+		w->live += s_buf_cnt;
+		s_buf_len = 0;
+		s_buf_cnt = 0;
+
+		portENTER_CRITICAL(&s_lock);
+		s_stats.commits++;
+		portEXIT_CRITICAL(&s_lock);
+	}
+
+	// Прочитані сектори — від найстарішого: позначка DONE не переживе старші записи
+	for (uint32_t i = 1; i < s_nsec; i++) {
+		uint32_t sec = (s_w_sec + i) % s_nsec;
+		if ((s_sec[sec].used || s_sec[sec].closed) && !s_sec[sec].live) {
+			fr_erase(sec);
+		}
+	}
+
+	if (s_mark) {
+		uint8_t done = FR_DONE;
+		if (fr_write(s_m_sec * FR_SECTOR + s_m_off, &done, 1) == ESP_OK) {
+			s_mark = false;
+		}
+	}
+
+	s_dirty_us = INT64_MAX;
+	return ESP_OK;
+}
+
+esp_err_t flash_ring_append(const void *data, size_t len)
+{
+	if (!s_part) {
+		return ESP_ERR_INVALID_STATE;
+	}
+	if (!data || !len || len > FLASH_RING_REC_MAX) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	size_t    sz = FR_REC_SIZE(len);
+	fr_sec_t *w  = &s_sec[s_w_sec];
+
+	if (s_buf_len + sz > FR_BATCH || w->closed || w->used + s_buf_len + sz > FR_SECTOR) {
+		esp_err_t err;
+		if (s_buf_len && (err = flash_ring_commit()) != ESP_OK) {
+			return err;
+		}
+		w = &s_sec[s_w_sec];
+		if (w->closed || w->used + sz > FR_SECTOR) {
+			if ((err = w_advance()) != ESP_OK) {
+				return err;
+			}
+		}
+	}
+
+	fr_hdr_t h = {
+		.state	= FR_LIVE,
+		.len	= (uint8_t)len,
+		.seq	= s_seq++,
+	};
+	h.crc = rec_crc(h.seq, data, len);
+
+	uint8_t *p = s_buf + s_buf_len;
+	memcpy(p, &h, sizeof(h));
+	memcpy(p + sizeof(h), data, len);
+	memset(p + sizeof(h) + len, 0xFF, sz - sizeof(h) - len);	// не програмуємо
+	s_buf_len += sz;
+	s_buf_cnt++;
+	dirty();
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.appended++;
+	s_stats.pending++;
+	s_stats.payload_bytes += len;
+	portEXIT_CRITICAL(&s_lock);
+	return ESP_OK;
+}
+
+size_t flash_ring_peek(void *buf, size_t max)
+{
+	uint8_t  data[FLASH_RING_REC_MAX];
+	uint32_t hops = 0;
+
+	s_peek_size = 0;
+	if (!s_part || !s_stats.pending) {
+		return 0;
+	}
+
+	for (;;) {
+		fr_sec_t *s = &s_sec[s_r_sec];
+
+		if (s_r_off >= s->used) {
+			if (s_r_sec != s_w_sec) {
+				if (++hops > s_nsec) return 0;	// лічильники розійшлися — не крутимось
+				s_r_sec = (s_r_sec + 1) % s_nsec;
+				s_r_off = 0;
+				continue;
+			}
+			// лишилось тільки незакомічене
+			if (!s_buf_len || flash_ring_commit() != ESP_OK) {
+				return 0;
+			}
+			continue;
+		}
+
+		fr_hdr_t  h;
+		uint32_t  off = s_r_sec * FR_SECTOR + s_r_off;
+		if (esp_partition_read(s_part, off, &h, sizeof(h)) != ESP_OK) {
+			return 0;
+		}
+		if (!h.len || h.len > FLASH_RING_REC_MAX || s_r_off + FR_REC_SIZE(h.len) > s->used) {
+			// межі вже перевірені при записі/монтуванні — решта сектора не читається
+			ESP_LOGW(TAG, "bad record at 0x%" PRIx32 ", skip %u", off, s->live);
+			portENTER_CRITICAL(&s_lock);
+			s_stats.corrupt += s->live;
+			s_stats.pending -= s->live;
+			portEXIT_CRITICAL(&s_lock);
+			s->live = 0;
+			s_r_off = s->used;
+			if (!s_stats.pending) return 0;
+			continue;
+		}
+		if (esp_partition_read(s_part, off + sizeof(h), data, h.len) != ESP_OK) {
+			return 0;
+		}
+		if (h.crc != rec_crc(h.seq, data, h.len)) {
+			ESP_LOGW(TAG, "bad crc at 0x%" PRIx32 ", skip", off);
+			portENTER_CRITICAL(&s_lock);
+			s_stats.corrupt++;
+			s_stats.pending--;
+			portEXIT_CRITICAL(&s_lock);
+			s->live--;
+			s_r_off += FR_REC_SIZE(h.len);
+			if (!s_stats.pending) return 0;
+			continue;
+		}
+
+		memcpy(buf, data, h.len < max ? h.len : max);
+		s_peek_size = FR_REC_SIZE(h.len);
+		return h.len;
+	}
+}
+
+void flash_ring_consume(void)
+{
+	if (!s_peek_size) {
+		return;
+	}
+
+	s_m_sec = s_r_sec;
+	s_m_off = s_r_off;
+	s_mark = true;
+	s_r_off += s_peek_size;
+	s_peek_size = 0;
+	s_sec[s_r_sec].live--;
+	dirty();
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.consumed++;
+	s_stats.pending--;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+int64_t flash_ring_commit_due_us(int64_t max_age_us)
+{
+	return s_dirty_us == INT64_MAX ? INT64_MAX : s_dirty_us + max_age_us;
+}
+
+uint32_t flash_ring_pending(void)
+{
+	return s_stats.pending;
+}
+
+bool flash_ring_mounted(void)
+{
+	return s_part != NULL;
+}
+
+void flash_ring_get_stats(flash_ring_stats_t *out)
+{
+	if (!out) {
+		return;
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+// -----------------------------------------------------------------------------
+//  Монтування
+// -----------------------------------------------------------------------------
+
+typedef struct {
+	uint16_t	used;
+	uint16_t	live;		// записів з seq > after
+	uint16_t	live_off;	// перший з них
+	bool		closed;
+	bool		any;
+	uint32_t	last_seq;
+	int64_t		max_done;	// -1 — позначок немає
+} fr_scan_t;
+
+static void scan_sector(const uint8_t *img, int64_t after, fr_scan_t *sc)
+{
+	uint32_t off = 0;
+
+	memset(sc, 0, sizeof(*sc));
+	sc->max_done = -1;
+
+	while (off + sizeof(fr_hdr_t) <= FR_SECTOR) {
+		fr_hdr_t h;
+		memcpy(&h, img + off, sizeof(h));
+		if (h.state == FR_FREE && h.len == 0xFF) {
+			break;	// далі не писали
+		}
+
+		uint32_t sz = FR_REC_SIZE(h.len);
+		if ((h.state != FR_LIVE && h.state != FR_DONE) || !h.len || h.len > FLASH_RING_REC_MAX ||
+		    off + sz > FR_SECTOR || h.crc != rec_crc(h.seq, img + off + sizeof(h), h.len)) {
+			sc->closed = true;	// обірваний запис (або сміття) — сюди не дописуємо
+			break;
+		}
+
+		sc->any = true;
+		sc->last_seq = h.seq;
+		if (h.state == FR_DONE && (int64_t)h.seq > sc->max_done) sc->max_done = h.seq;
+		if ((int64_t)h.seq > after) {
+			if (!sc->live) sc->live_off = off;
+			sc->live++;
+		}
+		off += sz;
+	}
+	sc->used = off;
+}
+
+esp_err_t flash_ring_mount(const char *label)
+{
+	if (s_part) {
+		return ESP_OK;
+	}
+
+	const esp_partition_t *p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+							    ESP_PARTITION_SUBTYPE_ANY, label);
+	if (!p) {
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	uint32_t nsec = p->size / FR_SECTOR;
+	if (nsec < 2) {
+		ESP_LOGE(TAG, "partition \"%s\" too small: %" PRIu32 " bytes", label, (uint32_t)p->size);
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	uint8_t *img = malloc(FR_SECTOR);
+	s_sec = calloc(nsec, sizeof(*s_sec));
+	if (!img || !s_sec) {
+		free(img);
+		free(s_sec);
+		s_sec = NULL;
+		return ESP_ERR_NO_MEM;
+	}
+
+	int64_t   t0 = esp_timer_get_time();
+	fr_scan_t sc;
+	int64_t   max_done = -1;
+	uint32_t  max_seq = 0;
+	bool      any = false;
+	esp_err_t err = ESP_OK;
+
+	s_part = p;
+	s_nsec = nsec;
+
+	// 1: позначка прочитаного, останній запис
+	for (uint32_t sec = 0; sec < nsec && err == ESP_OK; sec++) {
+		if ((err = esp_partition_read(p, sec * FR_SECTOR, img, FR_SECTOR)) != ESP_OK) break;
+		scan_sector(img, INT64_MAX, &sc);
+		if (sc.max_done > max_done) max_done = sc.max_done;
+		if (sc.any && (!any || sc.last_seq > max_seq)) {
+			max_seq = sc.last_seq;
+			s_w_sec = sec;
+		}
+		any |= sc.any;
+	}
+
+	// 2: непрочитане — після позначки
+	for (uint32_t sec = 0; sec < nsec && err == ESP_OK; sec++) {
+		if ((err = esp_partition_read(p, sec * FR_SECTOR, img, FR_SECTOR)) != ESP_OK) break;
+		scan_sector(img, max_done, &sc);
+		s_sec[sec].used = sc.used;
+		s_sec[sec].live = sc.live;
+		s_sec[sec].closed = sc.closed;
+		s_stats.pending += sc.live;
+		if (sc.closed) s_stats.corrupt++;
+	}
+
+	// найстаріший непрочитаний: по колу від сектора після останнього запису
+	s_r_sec = s_w_sec;
+	s_r_off = s_sec[s_w_sec].used;
+	for (uint32_t i = 1; i <= nsec && err == ESP_OK; i++) {
+		uint32_t sec = (s_w_sec + i) % nsec;
+		if (!s_sec[sec].live) continue;
+		if ((err = esp_partition_read(p, sec * FR_SECTOR, img, FR_SECTOR)) != ESP_OK) break;
+		scan_sector(img, max_done, &sc);
+		s_r_sec = sec;
+		s_r_off = sc.live_off;
+		break;
+	}
+	free(img);
+
+	if (err != ESP_OK) {
+		ESP_LOGE(TAG, "read \"%s\": %s", label, esp_err_to_name(err));
+		free(s_sec);
+		s_sec = NULL;
+		s_part = NULL;
+		memset(&s_stats, 0, sizeof(s_stats));
+		return err;
+	}
+
+	s_seq = any ? max_seq + 1 : 0;
+	s_stats.mount_us = (uint32_t)(esp_timer_get_time() - t0);
+	s_stats.mount_pending = s_stats.pending;
+
+	ESP_LOGI(TAG, "\"%s\": %" PRIu32 " sectors, %" PRIu32 " pending, next seq %" PRIu32 ", mount %" PRIu32 " us",
+		 label, nsec, s_stats.pending, s_seq, s_stats.mount_us);
+	return ESP_OK;
+}
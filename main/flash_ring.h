@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Кільце записів (FIFO) на окремому data-розділі flash. Пишеться тільки
+ * послідовно: append накопичує записи в RAM-батч (сторінка flash), який
+ * пишеться одним esp_partition_write на flash_ring_commit() або коли
+ * заповнений. Прочитане позначається одним байтом на останньому записі
+ * при коміті; сектор стирається, коли в ньому не лишилося непрочитаного,
+ * тож при додаванні стирання не чекаємо (крім переповнення: тоді найстаріший
+ * сектор губиться, overwritten). Після перезавантаження — з того ж місця;
+ * прочитане, але ще не закомічене, буде прочитане вдруге.
+ *
+ * Один екземпляр, без блокувань: усі виклики — з однієї задачі
+ * (крім flash_ring_get_stats).
+ */
+
+#define FLASH_RING_REC_MAX	120	// байтів даних у записі
+
+typedef struct {
+	uint32_t	appended;
+	uint32_t	consumed;
+	uint32_t	overwritten;	// непрочитані, стерті при переповненні
+	uint32_t	corrupt;	// зіпсовані записи (обірваний запис при втраті живлення)
+	uint32_t	pending;	// чекають читання зараз
+	uint32_t	commits;	// esp_partition_write батчу
+	uint32_t	erases;		// секторів
+	uint32_t	erase_us_max;
+	uint32_t	mount_us;	// скан розділу при монтуванні
+	uint32_t	mount_pending;	// знайдено непрочитаних при монтуванні
+	uint64_t	payload_bytes;	// дані з append
+	uint64_t	prog_bytes;	// записано у flash: заголовки, вирівнювання, позначки
+} flash_ring_stats_t;
+
+// ESP_ERR_NOT_FOUND — розділу з такою міткою немає
+esp_err_t	flash_ring_mount(const char *label);
+bool		flash_ring_mounted(void);
+
+esp_err_t	flash_ring_append(const void *data, size_t len);
+
+// Найстаріший непрочитаний запис: довжина, 0 — порожньо. Не знімає його.
+size_t		flash_ring_peek(void *buf, size_t max);
+void		flash_ring_consume(void);
+
+// Записати батч і позначку прочитаного, стерти прочитані сектори
+esp_err_t	flash_ring_commit(void);
+
+// esp_timer, коли найстаріше незакомічене чекає вже max_age_us; INT64_MAX — нічого
+int64_t		flash_ring_commit_due_us(int64_t max_age_us);
+
+uint32_t	flash_ring_pending(void);
+void		flash_ring_get_stats(flash_ring_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+#include "lat_hist.h"
+
+// 0..3 — точно; далі октава o (2^o..2^(o+1)-1) ділиться на 4 рівні частини
+static uint32_t bucket_of(uint32_t us)
+{
+	if (us < 4) return us;
+
+	uint32_t o = 31 - (uint32_t)__builtin_clz(us);
+	uint32_t idx = (o - 1) * 4 + ((us >> (o - 2)) & 3);
+	return idx < LAT_HIST_BUCKETS ? idx : LAT_HIST_BUCKETS - 1;
+}
+
+// середина кошика
+static uint32_t bucket_value(uint32_t idx)
+{
+	if (idx < 4) return idx;
+
+	uint32_t o = idx / 4 + 1;
+	uint32_t w = 1u << (o - 2);
+	return (4 + idx % 4) * w + w / 2;
+}
+
+void lat_hist_add(lat_hist_t *h, uint32_t us)
+{
+	uint32_t i = bucket_of(us);
+
+	if (h->b[i] == UINT16_MAX) {
+		for (uint32_t k = 0; k < LAT_HIST_BUCKETS; k++) h->b[k] >>= 1;
+	}
+	h->b[i]++;
+	h->n++;
+	if (us > h->max_us) h->max_us = us;
+}
+
+uint32_t lat_hist_pct(const lat_hist_t *h, uint32_t pct)
+{
+	uint32_t total = 0;
+	for (uint32_t k = 0; k < LAT_HIST_BUCKETS; k++) total += h->b[k];
+	if (!total) return 0;
+
+	// найменший кошик, до якого включно набралось pct% вимірів
+	uint32_t want = (total * pct + 99) / 100;
+	if (!want) want = 1;
+
+	uint32_t acc = 0;
+	for (uint32_t k = 0; k < LAT_HIST_BUCKETS; k++) {
+		acc += h->b[k];
+		if (acc >= want) {
+			uint32_t v = bucket_value(k);
+			return v < h->max_us ? v : h->max_us;
+		}
+	}
+	return h->max_us;
+}
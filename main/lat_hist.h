@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Гістограма затримок (мкс) з логарифмічними кошиками: 4 на октаву, тож
+ * перцентиль — з похибкою до ~12%; до ~8 с, більше — в останній кошик.
+ * 184 байти; коли кошик переповнюється, всі лічильники діляться навпіл
+ * (свіжі виміри важать більше, форма розподілу лишається).
+ */
+
+#define LAT_HIST_BUCKETS	88
+
+typedef struct {
+	uint32_t	n;			// всього вимірів
+	uint32_t	max_us;
+	uint16_t	b[LAT_HIST_BUCKETS];
+} lat_hist_t;
+
+void		lat_hist_add(lat_hist_t *h, uint32_t us);
+
+// pct 0..100; 0 якщо порожня
+uint32_t	lat_hist_pct(const lat_hist_t *h, uint32_t pct);
+
+#ifdef __cplusplus
+}
+#endif
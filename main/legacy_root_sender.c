@@ -1,7 +1,9 @@
 #include "legacy_root_sender.h"
 
 #include <string.h>
+#include <inttypes.h>
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -9,31 +11,26 @@
 #include "esp_wifi.h"
 #include "esp_mesh.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 
-// -----------------------------------------------------------------------------
-//  Локальна копія формату mesh_packet_t (має збігатися з тим, що в mesh_main.c)
-// -----------------------------------------------------------------------------
-
-typedef struct __attribute__((packed)) {
-	uint8_t  magic;
-	uint8_t  version;
-	uint8_t  type;
-	uint8_t  reserved;
-	uint32_t counter;
-	uint8_t  src_mac[6];
-	char     payload[32];
-} mesh_packet_t;
-
-#define MESH_PKT_MAGIC        0xA5
-#define MESH_PKT_VERSION      1
-#define MESH_PKT_TYPE_TEXT    1    // той самий тип, що й "Hello N"
+#include "mesh_hdr.h"
+#include "mesh_proto.h"
+#include "mesh_tx.h"
+#include "lat_hist.h"
+#include "flash_ring.h"
 
 // -----------------------------------------------------------------------------
 //  Черга
 // -----------------------------------------------------------------------------
 
 typedef struct {
-	char text[LEGACY_ROOT_MSG_MAX_LEN];
+	char    text[LEGACY_ROOT_MSG_MAX_LEN];
+	int64_t enq_us;       // esp_timer на момент legacy_send_to_root
+	int64_t deadline_us;  // після цього не шлемо — застаріле
+	bool    durable;      // legacy_send_to_root: можна у flash-сховище
+	uint32_t key;         // legacy_send_to_root_keyed: хеш ключа, 0 — без ключа
+	char    key_str[LEGACY_ROOT_KEY_MAX_LEN];  // сам ключ: хеші можуть збігтися
 } legacy_msg_t;
 
 static const char   *TAG    = "legacy_root_tx";
@@ -43,65 +40,354 @@ static uint32_t      s_cnt  = 0;
 
 #define LEGACY_ROOT_QUEUE_LEN  16
 
+static portMUX_TYPE                s_lock = portMUX_INITIALIZER_UNLOCKED;
+static legacy_root_sender_stats_t  s_stats;
+static lat_hist_t                  s_q_lat;
+
 // -----------------------------------------------------------------------------
 //  Таска, яка реально шле на root
 // -----------------------------------------------------------------------------
 
+/*
+ * Повідомлення з черги переходять у власний FIFO таски (s_pend), тож черга
+ * продюсерів не забивається, поки лінк лежить. Усі йдуть на root через одного
+ * батька, тому backoff — на лінк: після невдачі наступна спроба через
+ * min(MIN << n, MAX) з джитером [1/2, 1], після успіху — знову одразу.
+ * Поки чекаємо, прострочені (deadline) викидаються, а не відправляються із
+ * запізненням і не тримають свіжі. Шле через mesh_tx (клас TELEMETRY) з
+ * MESH_DATA_NONBLOCK, таска не блокується; ESP_ERR_MESH_QUEUE_FULL — черга
+ * вгору зайнята (логами понад ліміт чи важливішим трафіком) або не настав
+ * темп класу, а не лінк: наступна спроба через тік або коли дозволить темп,
+ * без backoff і без сховища. Поки чекаємо, нові додаються в той самий батч.
+ *
+ * З CONFIG_LEGACY_ROOT_FLASH_STORE і розділом у таблиці: щойно лінк впав
+ * (або s_pend повний), повідомлення legacy_send_to_root переходять у кільце
+ * на flash (flash_ring) і лишаються там, поки не підуть, — без дедлайну,
+ * переживаючи перезавантаження. Доки у сховищі щось є, нові теж ідуть туди
+ * (порядок). Після відновлення спершу s_pend (свіже, з дедлайнами), а
+ * сховище — не частіше за LEGACY_ROOT_FLASH_DRAIN_PER_SEC, щоб не забити лінк.
+ */
+
+static legacy_msg_t s_pend[LEGACY_ROOT_QUEUE_LEN];
+static int          s_pend_head = 0;
+static int          s_pend_cnt  = 0;
+
+static bool    s_store       = false;  // flash_ring змонтовано
+static int64_t s_recover_us  = 0;      // лінк повернувся, сховище ще не порожнє
+
+static void stat_inc(uint32_t *ctr)
+{
+	portENTER_CRITICAL(&s_lock);
+	(*ctr)++;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+// drop_*: ще й у частку втрат класу TELEMETRY (mesh_tx)
+static void drop_inc(uint32_t *ctr)
+{
+	stat_inc(ctr);
+	mesh_tx_note_drop(MESH_TX_TELEMETRY);
+}
+
+static void pend_pop(void)
+{
+	s_pend_head = (s_pend_head + 1) % LEGACY_ROOT_QUEUE_LEN;
+	s_pend_cnt--;
+}
+
+static void pend_push(const legacy_msg_t *m)
+{
+	s_pend[(s_pend_head + s_pend_cnt) % LEGACY_ROOT_QUEUE_LEN] = *m;
+	s_pend_cnt++;
+}
+
+static void store_put(const legacy_msg_t *m)
+{
+	esp_err_t err = flash_ring_append(m->text, strnlen(m->text, sizeof(m->text)));
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "flash store: %s, drop \"%s\"", esp_err_to_name(err), m->text);
+		drop_inc(&s_stats.drop_err);
+		return;
+	}
+	stat_inc(&s_stats.stored);
+}
+
+// Нове з черги: заміняє не відправлене з тим самим ключем, інакше у s_pend,
+// або у сховище, поки воно не порожнє / лінк лежить
+static void route(const legacy_msg_t *m, uint32_t fails)
+{
+	for (int i = 0; m->key && i < s_pend_cnt; i++) {
+		legacy_msg_t *p = &s_pend[(s_pend_head + i) % LEGACY_ROOT_QUEUE_LEN];
+		if (p->key == m->key && strcmp(p->key_str, m->key_str) == 0) {
+			*p = *m;	// місце в черзі лишається — свіже значення не чекає довше
+			stat_inc(&s_stats.coalesced);
+			return;
+		}
+	}
+
+	if (s_store && m->durable && (fails || flash_ring_pending() || s_pend_cnt == LEGACY_ROOT_QUEUE_LEN)) {
+		store_put(m);
+	} else if (s_pend_cnt < LEGACY_ROOT_QUEUE_LEN) {
+		pend_push(m);
+	} else {
+		drop_inc(&s_stats.drop_full);
+		ESP_LOGW(TAG, "queue full, drop \"%s\"", m->text);
+	}
+}
+
+// Лінк щойно впав: все, що може пережити перезавантаження, — у сховище
+static void spill_pending(void)
+{
+	for (int n = s_pend_cnt; n > 0; n--) {
+		legacy_msg_t m = s_pend[s_pend_head];
+		pend_pop();
+		if (m.durable) store_put(&m);
+		else pend_push(&m);
+	}
+}
+
+// Помилки, які повтор не виправить
+static bool send_err_permanent(esp_err_t err)
+{
+	return err == ESP_ERR_MESH_ARGUMENT || err == ESP_ERR_MESH_EXCEED_MTU ||
+	       err == ESP_ERR_MESH_NOT_SUPPORT;
+}
+
+static int64_t backoff_us(uint32_t fails)
+{
+	int64_t b = (int64_t)CONFIG_LEGACY_ROOT_BACKOFF_MIN_MS * 1000;
+	int64_t max = (int64_t)CONFIG_LEGACY_ROOT_BACKOFF_MAX_MS * 1000;
+
+	for (uint32_t i = 1; i < fails && b < max; i++) b <<= 1;
+	if (b > max) b = max;
+
+	// джитер: ноди, що втратили одного батька, не повторюють синхронно
+	return b / 2 + (int64_t)(esp_random() % (uint32_t)(b / 2 + 1));
+}
+
+// Пакет на root: з LEGACY_ROOT_BATCH_MAX_BYTES кілька текстів з голови s_pend
+// йдуть одним MESH_PKT_TYPE_TEXT_BATCH, якщо root його знає (mesh_hdr_root_v2);
+// інакше й один текст — як і раніше, mesh_packet_t
+static uint8_t s_tx[CONFIG_LEGACY_ROOT_BATCH_MAX_BYTES > sizeof(mesh_packet_t) ?
+                    CONFIG_LEGACY_ROOT_BATCH_MAX_BYTES : sizeof(mesh_packet_t)];
+
+static void pack_hdr(uint8_t type)
+{
+	mesh_hdr_fill((mesh_pkt_hdr_t *)s_tx, type, ++s_cnt);
+}
+
+static size_t pack_text(const char *text)
+{
+	mesh_packet_t *p = (mesh_packet_t *)s_tx;
+
+	memset(p->payload, 0, sizeof(p->payload));
+	memcpy(p->payload, text, strnlen(text, sizeof(p->payload) - 1));
+	pack_hdr(MESH_PKT_TYPE_TEXT);
+	return sizeof(*p);
+}
+
+// Скільки повідомлень з голови s_pend у s_tx (>= 1), *size — розмір пакета
+static int pack_pending(int64_t now, size_t *size)
+{
+#if CONFIG_LEGACY_ROOT_BATCH_MAX_BYTES
+	mesh_text_batch_packet_t *b   = (mesh_text_batch_packet_t *)s_tx;
+	size_t                    off = sizeof(*b);
+	int                       n   = 0;
+	// старий root тип 13 мовчки викидає — поки не показав v2, по одному
+	bool                      can = mesh_hdr_root_v2();
+
+	for (; can && n < s_pend_cnt && n < UINT8_MAX; n++) {
+		const legacy_msg_t *m   = &s_pend[(s_pend_head + n) % LEGACY_ROOT_QUEUE_LEN];
+		size_t              len = strnlen(m->text, sizeof(m->text) - 1);
+
+		// прострочене не веземо: стане головою і викинеться
+		if (m->deadline_us <= now || off + 1 + len > sizeof(s_tx)) break;
+		s_tx[off] = (uint8_t)len;
+		memcpy(&s_tx[off + 1], m->text, len);
+		off += 1 + len;
+	}
+	if (n > 1) {
+		b->count = (uint8_t)n;
+		pack_hdr(MESH_PKT_TYPE_TEXT_BATCH);
+		*size = off;
+		return n;
+	}
+#else
+	(void)now;
+#endif
+	*size = pack_text(s_pend[s_pend_head].text);
+	return 1;
+}
+
 static void legacy_root_sender_task(void *arg)
 {
-	mesh_data_t   data;
+	size_t        tx_len   = 0;
 	mesh_addr_t   dest;
-	mesh_packet_t pkt;
 	esp_err_t     err;
-
-	data.data  = (uint8_t *)&pkt;
-	data.proto = MESH_PROTO_BIN;
-	data.tos   = MESH_TOS_P2P;
+	uint32_t      fails    = 0;
+	int64_t       next_us  = 0;  // раніше не пробуємо (backoff)
+	int64_t       drain_us = 0;  // наступний зі сховища
+
+#if CONFIG_LEGACY_ROOT_FLASH_STORE
+	const int64_t commit_age_us = (int64_t)CONFIG_LEGACY_ROOT_FLASH_COMMIT_MS * 1000;
+	const int64_t drain_gap_us  = 1000000 / CONFIG_LEGACY_ROOT_FLASH_DRAIN_PER_SEC;
+#else
+	const int64_t commit_age_us = 0;
+	const int64_t drain_gap_us  = 0;
+#endif
 
 	// 00:00:00:00:00:00 -> root
 	memset(&dest, 0, sizeof(dest));
 
 	while (1) {
-		legacy_msg_t msg;
+		int64_t now = esp_timer_get_time();
 
-		if (xQueueReceive(s_q, &msg, portMAX_DELAY) != pdTRUE) {
-			continue;
+		// Застарілі — геть, незалежно від лінка
+		while (s_pend_cnt && s_pend[s_pend_head].deadline_us <= now) {
+			ESP_LOGD(TAG, "expired, drop \"%s\"", s_pend[s_pend_head].text);
+			pend_pop();
+			drop_inc(&s_stats.drop_expired);
 		}
 
-		// Збираємо mesh_packet
-		memset(&pkt, 0, sizeof(pkt));
-		pkt.magic   = MESH_PKT_MAGIC;
-		pkt.version = MESH_PKT_VERSION;
-		pkt.type    = MESH_PKT_TYPE_TEXT;
-		pkt.counter = ++s_cnt;
+		// Чекаємо нове повідомлення, поки не час повторювати / комітити / зливати сховище
+		int64_t until = INT64_MAX;
+		if (s_pend_cnt) {
+			until = next_us > now ? next_us : now;
+			if (s_pend[s_pend_head].deadline_us < until) until = s_pend[s_pend_head].deadline_us;
+		} else if (s_store && flash_ring_pending()) {
+			until = next_us > drain_us ? next_us : drain_us;
+		}
+		if (s_store) {
+			int64_t due = flash_ring_commit_due_us(commit_age_us);
+			if (due < until) until = due;
+		}
+		TickType_t wait = until == INT64_MAX ? portMAX_DELAY :
+		                  until > now ? pdMS_TO_TICKS((until - now + 999) / 1000) : 0;
+
+		if (s_pend_cnt < LEGACY_ROOT_QUEUE_LEN || s_store) {
+			legacy_msg_t m;
+			if (xQueueReceive(s_q, &m, wait) == pdTRUE) {
+				route(&m, fails);
+				// забираємо все, що вже є, без очікування
+				while ((s_pend_cnt < LEGACY_ROOT_QUEUE_LEN || s_store) && xQueueReceive(s_q, &m, 0) == pdTRUE) {
+					route(&m, fails);
+				}
+			}
+		} else if (wait) {
+			vTaskDelay(wait);
+		}
 
-		esp_wifi_get_mac(WIFI_IF_STA, pkt.src_mac);
-		strncpy(pkt.payload, msg.text, sizeof(pkt.payload) - 1);
+		now = esp_timer_get_time();
+		if (s_store && flash_ring_commit_due_us(commit_age_us) <= now) {
+			flash_ring_commit();
+		}
+		if (now < next_us) continue;
+
+		while (1) {
+			char text[LEGACY_ROOT_MSG_MAX_LEN];  // для логу
+			int  n = 0;                          // з s_pend; 0 — зі сховища
+
+			if (s_pend_cnt) {
+				if (s_pend[s_pend_head].deadline_us <= now) break;	// викине початок циклу
+				n = pack_pending(now, &tx_len);
+				memcpy(text, s_pend[s_pend_head].text, sizeof(text));
+			} else if (s_store && flash_ring_pending() && now >= drain_us) {
+				memset(text, 0, sizeof(text));
+				if (!flash_ring_peek(text, sizeof(text) - 1)) {
+					drain_us = now + drain_gap_us;	// помилка читання — не крутимось
+					break;
+				}
+				tx_len = pack_text(text);
+			} else {
+				break;
+			}
 
-		data.size = sizeof(pkt);
+			// запис зі сховища стирається, щойно драйвер його прийняв: далі його
+			// тримають тільки ретрансміти на хопах, тож для нього MESH_TOS_P2P
+			err = mesh_tx_send_tos(MESH_TX_TELEMETRY, n ? MESH_TOS_DEF : MESH_TOS_P2P,
+			                       &dest, s_tx, tx_len, MESH_DATA_NONBLOCK);
+			now = esp_timer_get_time();
 
-		// Поки не відправиться / не приймемо рішення дропнути
-		for (;;) {
-			err = esp_mesh_send(&dest, &data, MESH_DATA_P2P, NULL, 0);
 			if (err == ESP_OK) {
-				ESP_LOGI(TAG, "TX -> ROOT legacy: \"%s\"", msg.text);
-				break;
+				if (fails) {
+					ESP_LOGI(TAG, "uplink back after %" PRIu32 " failed attempt(s)", fails);
+					if (s_store && flash_ring_pending() && !s_recover_us) s_recover_us = now;
+				}
+				fails = 0;
+				stat_inc(&s_stats.tx_pkts);
+
+				if (!n) {
+					ESP_LOGI(TAG, "TX -> ROOT legacy: \"%s\"", text);
+					flash_ring_consume();
+					drain_us = now + drain_gap_us;
+
+					portENTER_CRITICAL(&s_lock);
+					s_stats.sent++;
+					s_stats.store_sent++;
+					portEXIT_CRITICAL(&s_lock);
+
+					if (!flash_ring_pending()) {
+						// сховище злите: одразу позначка, щоб після перезавантаження не повторювати
+						flash_ring_commit();
+						if (s_recover_us) {
+							uint32_t us = (uint32_t)(now - s_recover_us);
+							ESP_LOGI(TAG, "flash store drained in %" PRIu32 " ms", us / 1000);
+							portENTER_CRITICAL(&s_lock);
+							s_stats.store_recover_us = us;
+							portEXIT_CRITICAL(&s_lock);
+							s_recover_us = 0;
+						}
+					}
+					continue;
+				}
+
+				if (n > 1) ESP_LOGI(TAG, "TX -> ROOT legacy: \"%s\" +%d in batch", text, n - 1);
+				else ESP_LOGI(TAG, "TX -> ROOT legacy: \"%s\"", text);
+
+				portENTER_CRITICAL(&s_lock);
+				if (n > 1) s_stats.batched += n;
+				for (int i = 0; i < n; i++) {
+					uint32_t lat = (uint32_t)(now - s_pend[s_pend_head].enq_us);
+					s_stats.sent++;
+					s_stats.q_lat_us_total += lat;
+					if (lat > s_stats.q_lat_us_max) s_stats.q_lat_us_max = lat;
+					lat_hist_add(&s_q_lat, lat);
+					pend_pop();
+				}
+				portEXIT_CRITICAL(&s_lock);
+				continue;
 			}
 
-			ESP_LOGW(TAG,
-			         "esp_mesh_send failed: 0x%x (%s), retry later",
-			         err, esp_err_to_name(err));
+			if (send_err_permanent(err)) {
+				ESP_LOGW(TAG, "esp_mesh_send failed: 0x%x (%s), drop \"%s\"%s",
+				         err, esp_err_to_name(err), text, n > 1 ? " and the rest of the batch" : "");
+				if (!n) {
+					flash_ring_consume();
+					drop_inc(&s_stats.drop_err);
+				}
+				for (int i = 0; i < n; i++) {
+					pend_pop();
+					drop_inc(&s_stats.drop_err);
+				}
+				continue;
+			}
 
-			// Пробуємо покласти повідомлення назад у початок черги
-			if (xQueueSendToFront(s_q, &msg, 0) != pdPASS) {
-				ESP_LOGW(TAG,
-				         "queue full on retry, drop message \"%s\"",
-				         msg.text);
-				break;  // щоб не зациклитися
+			if (err == ESP_ERR_MESH_QUEUE_FULL) {
+				int64_t pace = mesh_tx_pace_next_us(MESH_TX_TELEMETRY);
+				next_us = pace > now + 1000 ? pace : now + 1000;
+				break;
 			}
 
-			// Чекаємо секунду, даємо mesh'у шанс відновитися
-			vTaskDelay(pdMS_TO_TICKS(1000));
+			// Тимчасово: лінк — чекаємо всі разом
+			if (!fails) {
+				ESP_LOGW(TAG, "esp_mesh_send failed: 0x%x (%s), backing off",
+				         err, esp_err_to_name(err));
+				if (s_store) spill_pending();
+			}
+			fails++;
+			next_us = now + backoff_us(fails);
+			stat_inc(&s_stats.retries);
+			break;
 		}
 	}
 }
@@ -121,6 +407,18 @@ void legacy_root_sender_start(UBaseType_t task_prio)
         task_prio = 5;
     }
 
+#if CONFIG_LEGACY_ROOT_FLASH_STORE
+    esp_err_t err = flash_ring_mount(CONFIG_LEGACY_ROOT_FLASH_LABEL);
+    if (err == ESP_OK) {
+        s_store = true;
+        // непрочитане з минулого запуску піде, щойно буде лінк
+        if (flash_ring_pending()) s_recover_us = esp_timer_get_time();
+    } else {
+        ESP_LOGW(TAG, "no flash store (\"%s\": %s), RAM queue only",
+                 CONFIG_LEGACY_ROOT_FLASH_LABEL, esp_err_to_name(err));
+    }
+#endif
+
     s_q = xQueueCreate(LEGACY_ROOT_QUEUE_LEN, sizeof(legacy_msg_t));
     if (!s_q) {
         ESP_LOGE(TAG, "failed to create queue");
@@ -147,7 +445,7 @@ void legacy_root_sender_start(UBaseType_t task_prio)
 }
 
 
-bool legacy_send_to_root(const char *text)
+static bool enqueue(const char *text, uint32_t ttl_ms, bool durable, uint32_t key, const char *key_str)
 {
 	if (!s_q || !text || !text[0]) {
 		return false;
@@ -155,11 +453,59 @@ bool legacy_send_to_root(const char *text)
 
 	legacy_msg_t msg = {0};
 	strncpy(msg.text, text, sizeof(msg.text) - 1);
+	msg.enq_us = esp_timer_get_time();
+	msg.deadline_us = msg.enq_us + (int64_t)ttl_ms * 1000;
+	msg.durable = durable;
+	msg.key = key;
+	if (key_str) strncpy(msg.key_str, key_str, sizeof(msg.key_str) - 1);
 
 	BaseType_t ok = xQueueSend(s_q, &msg, 0);
 	if (ok != pdPASS) {
+		drop_inc(&s_stats.drop_full);
 		ESP_LOGW(TAG, "queue full, drop \"%s\"", msg.text);
 		return false;
 	}
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.queued++;
+	portEXIT_CRITICAL(&s_lock);
 	return true;
 }
+
+bool legacy_send_to_root_ttl(const char *text, uint32_t ttl_ms)
+{
+	return enqueue(text, ttl_ms, false, 0, NULL);
+}
+
+bool legacy_send_to_root(const char *text)
+{
+	return enqueue(text, CONFIG_LEGACY_ROOT_TTL_MS, true, 0, NULL);
+}
+
+bool legacy_send_to_root_keyed(const char *key, const char *text)
+{
+	if (!key || strnlen(key, LEGACY_ROOT_KEY_MAX_LEN) == LEGACY_ROOT_KEY_MAX_LEN) {
+		return false;
+	}
+
+	// FNV-1a; 0 — "без ключа"
+	uint32_t h = 2166136261u;
+	for (const char *k = key; *k; k++) {
+		h = (h ^ (uint8_t)*k) * 16777619u;
+	}
+	return enqueue(text, CONFIG_LEGACY_ROOT_TTL_MS, false, h ? h : 1, key);
+}
+
+void legacy_root_sender_get_stats(legacy_root_sender_stats_t *out)
+{
+	if (!out) {
+		return;
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	out->q_lat_p50_us = lat_hist_pct(&s_q_lat, 50);
+	out->q_lat_p99_us = lat_hist_pct(&s_q_lat, 99);
+	portEXIT_CRITICAL(&s_lock);
+	out->store_pending = flash_ring_pending();
+}
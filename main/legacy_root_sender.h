@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "freertos/FreeRTOS.h"   // для UBaseType_t
 
 #ifdef __cplusplus
@@ -8,13 +9,48 @@ extern "C" {
 #endif
 
 #define LEGACY_ROOT_MSG_MAX_LEN  32
+#define LEGACY_ROOT_KEY_MAX_LEN  16   // з '\0'
 
 // prio – пріоритет таски (як у xTaskCreate).
 // Якщо передати 0 – всередині підставимо дефолт (5).
 void legacy_root_sender_start(UBaseType_t prio);
 
+typedef struct {
+	uint32_t queued;          // прийнято в чергу
+	uint32_t sent;
+	uint32_t tx_pkts;         // успішних esp_mesh_send (батч — один)
+	uint32_t batched;         // повідомлень, що пішли в MESH_PKT_TYPE_TEXT_BATCH
+	uint32_t coalesced;       // замінено новішим з тим самим ключем до відправки
+	uint32_t retries;         // невдалих спроб esp_mesh_send (тимчасові помилки)
+	uint32_t drop_full;       // черга повна
+	uint32_t drop_expired;    // дедлайн минув до відправки
+	uint32_t drop_err;        // помилка, яку повтор не виправить
+	uint64_t q_lat_us_total;  // від legacy_send_to_root до успішної відправки (з RAM)
+	uint32_t q_lat_us_max;
+	uint32_t q_lat_p50_us;
+	uint32_t q_lat_p99_us;
+	// CONFIG_LEGACY_ROOT_FLASH_STORE (лічильники flash — flash_ring_get_stats)
+	uint32_t stored;          // записано у flash-сховище
+	uint32_t store_sent;      // з них відправлено (входить у sent)
+	uint32_t store_pending;
+	uint32_t store_recover_us;  // останнє: від повернення лінка до порожнього сховища
+} legacy_root_sender_stats_t;
+
+// Дедлайн — CONFIG_LEGACY_ROOT_TTL_MS; з flash-сховищем, поки лінк лежить,
+// чекає у flash без дедлайну (і переживає перезавантаження)
 bool legacy_send_to_root(const char *text);
 
+// Не відправлене за ttl_ms викидається (drop_expired); тільки RAM
+bool legacy_send_to_root_ttl(const char *text, uint32_t ttl_ms);
+
+// Останнє значення перемагає: ще не відправлене повідомлення з тим самим key
+// замінюється новим на тому ж місці в черзі (coalesced). Тільки RAM, дедлайн —
+// CONFIG_LEGACY_ROOT_TTL_MS від останнього значення. key довший за
+// LEGACY_ROOT_KEY_MAX_LEN - 1 символів не приймається (false).
+bool legacy_send_to_root_keyed(const char *key, const char *text);
+
+void legacy_root_sender_get_stats(legacy_root_sender_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,330 @@
+#include "log_binary.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+	const char	*start;		// '%'
+	const char	*end;		// після символу конверсії
+	int		stars;		// скільки '*' (ширина/точність з аргументів)
+	bool		prec_star;	// точність — останній з '*'
+	int		prec;		// точність з формату, -1 — нема
+	bool		wide;		// ll / j => 64 біти
+	bool		ldbl;		// L
+	char		conv;
+} fmt_spec_t;
+
+// NULL => специфікаторів більше немає
+static const char *next_spec(const char *p, fmt_spec_t *s)
+{
+	for (;;) {
+		p = strchr(p, '%');
+		if (!p) return NULL;
+		if (p[1] != '%') break;
+		p += 2;
+	}
+
+	memset(s, 0, sizeof(*s));
+	s->prec = -1;
+	s->start = p++;
+
+	while (*p && strchr("-+ #0", *p)) p++;
+	if (*p == '*') { s->stars++; p++; }
+	while (*p >= '0' && *p <= '9') p++;
+	if (*p == '.') {
+		p++;
+		s->prec = 0;
+		if (*p == '*') { s->stars++; s->prec_star = true; p++; }
+		while (*p >= '0' && *p <= '9') s->prec = s->prec * 10 + (*p++ - '0');
+	}
+
+	if (p[0] == 'l' && p[1] == 'l') { s->wide = true; p += 2; }
+	else if (p[0] == 'h' && p[1] == 'h') p += 2;
+	else if (*p == 'j') { s->wide = true; p++; }
+	else if (*p == 'L') { s->ldbl = true; p++; }
+	else if (*p && strchr("hlzt", *p)) p++;
+
+	s->conv = *p;
+	if (*p) p++;
+	s->end = p;
+	return s->start;
+}
+
+static bool put_le(uint8_t **cur, const uint8_t *end, uint64_t v, size_t n)
+{
+	if ((size_t)(end - *cur) < n) return false;
+	for (size_t i = 0; i < n; i++) {
+		(*cur)[i] = (uint8_t)(v >> (8 * i));
+	}
+	*cur += n;
+	return true;
+}
+
+static bool put_var(uint8_t **cur, const uint8_t *end, uint64_t v)
+{
+	do {
+		if (*cur >= end) return false;
+		uint8_t b = v & 0x7F;
+		v >>= 7;
+		*(*cur)++ = b | (v ? 0x80 : 0);
+	} while (v);
+	return true;
+}
+
+static bool put_svar(uint8_t **cur, const uint8_t *end, int64_t v)
+{
+	return put_var(cur, end, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static uint64_t get_le(const uint8_t *p, size_t n)
+{
+	uint64_t v = 0;
+	for (size_t i = 0; i < n; i++) {
+		v |= (uint64_t)p[i] << (8 * i);
+	}
+	return v;
+}
+
+static bool get_var(const uint8_t **cur, const uint8_t *end, uint64_t *v)
+{
+	*v = 0;
+	for (unsigned sh = 0; sh < 64; sh += 7) {
+		if (*cur >= end) return false;
+		uint8_t b = *(*cur)++;
+		*v |= (uint64_t)(b & 0x7F) << sh;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+static bool get_svar(const uint8_t **cur, const uint8_t *end, int64_t *v)
+{
+	uint64_t u;
+	if (!get_var(cur, end, &u)) return false;
+	*v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+	return true;
+}
+
+size_t log_bin_encode(uint8_t *out, size_t cap, uint32_t epoch_sec, const char *fmt, va_list ap)
+{
+	uint8_t *cur = out;
+	const uint8_t *end = out + cap;
+
+	if (!put_le(&cur, end, LOG_BIN_FMT_ID(fmt), 4)) return 0;
+	if (!put_var(&cur, end, epoch_sec)) return 0;
+
+	va_list aq;
+	va_copy(aq, ap);
+
+	bool ok = true;
+	fmt_spec_t s;
+	for (const char *p = fmt; ok && next_spec(p, &s); p = s.end) {
+		for (int i = 0; ok && i < s.stars; i++) {
+			int a = va_arg(aq, int);
+			ok = put_svar(&cur, end, a);
+			if (s.prec_star && i == s.stars - 1) s.prec = a < 0 ? -1 : a;	// від'ємна — як без точності
+		}
+		if (!ok) break;
+
+		switch (s.conv) {
+		case 'd': case 'i':
+		case 'u': case 'o': case 'x': case 'X': case 'c': {
+			const char *m = s.start + 1;
+			while (m < s.end - 1 && !strchr("lzt", *m)) m++;
+
+			bool sgn = (s.conv == 'd' || s.conv == 'i');
+			int64_t v;
+			if (s.wide) {
+				v = va_arg(aq, long long);
+			} else if (m < s.end - 1 && *m == 'l') {
+				long l = va_arg(aq, long);
+				v = sgn ? (int64_t)(int32_t)l : (int64_t)(uint32_t)l;
+			} else if (m < s.end - 1) {
+				size_t z = va_arg(aq, size_t);
+				v = sgn ? (int64_t)(int32_t)z : (int64_t)(uint32_t)z;
+			} else {
+				int i = va_arg(aq, int);
+				v = sgn ? (int64_t)i : (int64_t)(uint32_t)i;
+			}
+			ok = sgn ? put_svar(&cur, end, v) : put_var(&cur, end, (uint64_t)v);
+			break;
+		}
+		case 'p':
+			ok = put_var(&cur, end, (uint32_t)(uintptr_t)va_arg(aq, void *));
+			break;
+		case 'f': case 'F': case 'e': case 'E':
+		case 'g': case 'G': case 'a': case 'A': {
+			double d = s.ldbl ? (double)va_arg(aq, long double) : va_arg(aq, double);
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			ok = put_le(&cur, end, bits, 8);
+			break;
+		}
+		case 's': {
+			const char *str = va_arg(aq, const char *);
+			if (!str) str = "(null)";
+
+			// з точністю строка може бути без '\0' — далі за неї не читаємо
+			size_t n = s.prec >= 0 ? strnlen(str, (size_t)s.prec) : strlen(str);
+			size_t room = (size_t)(end - cur);
+			if (room == 0) { ok = false; break; }
+			if (n > room - 1) n = room - 1;
+			if (n > UINT8_MAX) n = UINT8_MAX;
+
+			*cur++ = (uint8_t)n;
+			memcpy(cur, str, n);
+			cur += n;
+			break;
+		}
+		case 'n':
+			(void)va_arg(aq, void *);
+			break;
+		default:
+			ok = false;
+			break;
+		}
+	}
+	va_end(aq);
+
+	return ok ? (size_t)(cur - out) : 0;
+}
+
+size_t log_bin_parse_hdr(const uint8_t *rec, size_t len, uint32_t *fmt_id, uint32_t *epoch_sec)
+{
+	const uint8_t *cur = rec + 4;
+	uint64_t epoch;
+
+	if (len < 5 || !get_var(&cur, rec + len, &epoch)) return 0;
+
+	*fmt_id = (uint32_t)get_le(rec, 4);
+	*epoch_sec = (uint32_t)epoch;
+	return (size_t)(cur - rec);
+}
+
+size_t log_bin_msg_offset(const uint8_t *rec, size_t len)
+{
+	uint32_t id, epoch;
+	size_t hdr = log_bin_parse_hdr(rec, len, &id, &epoch);
+	if (!hdr) return 0;
+
+	const uint8_t *cur = rec + hdr;
+	uint64_t ts;
+	if (!get_var(&cur, rec + len, &ts)) return 0;
+	return (size_t)(cur - rec);
+}
+
+#define EMIT(v)	(s.stars == 0 ? snprintf(o, room, spec, (v)) :			\
+		 s.stars == 1 ? snprintf(o, room, spec, star[0], (v)) :		\
+				snprintf(o, room, spec, star[0], star[1], (v)))
+
+int log_bin_render(char *out, size_t cap, const char *fmt, const uint8_t *args, size_t args_len)
+{
+	if (!out || cap == 0) return -1;
+
+	const uint8_t *cur = args;
+	const uint8_t *end = args + args_len;
+	size_t w = 0;
+	out[0] = '\0';
+
+	fmt_spec_t s;
+	const char *p = fmt;
+	for (;;) {
+		const char *lit_end = next_spec(p, &s);
+		if (!lit_end) lit_end = p + strlen(p);
+
+		// літерали ("%%" => "%")
+		for (const char *q = p; q < lit_end && w + 1 < cap; q++) {
+			out[w++] = *q;
+			if (q[0] == '%' && q[1] == '%') q++;
+		}
+		out[w] = '\0';
+		if (!*lit_end) break;
+
+		int star[2] = { 0, 0 };
+		for (int i = 0; i < s.stars; i++) {
+			int64_t v;
+			if (!get_svar(&cur, end, &v)) return -1;
+			star[i] = (int)v;
+		}
+
+		// той самий специфікатор без модифікаторів довжини
+		char spec[24];
+		size_t sl = 0;
+		for (const char *q = s.start; q < s.end - 1 && sl < sizeof(spec) - 4; q++) {
+			if (!strchr("hljztL", *q)) spec[sl++] = *q;
+		}
+
+		char *o = out + w;
+		size_t room = cap - w;
+		int n = 0;
+
+		switch (s.conv) {
+		case 'd': case 'i': {
+			int64_t v;
+			if (!get_svar(&cur, end, &v)) return -1;
+			spec[sl++] = 'l'; spec[sl++] = 'l';
+			spec[sl++] = s.conv;
+			spec[sl] = '\0';
+			n = EMIT((long long)v);
+			break;
+		}
+		case 'u': case 'o': case 'x': case 'X': case 'c': {
+			uint64_t v;
+			if (!get_var(&cur, end, &v)) return -1;
+			if (s.conv == 'c') {
+				spec[sl++] = 'c';
+				spec[sl] = '\0';
+				n = EMIT((int)v);
+			} else {
+				spec[sl++] = 'l'; spec[sl++] = 'l';
+				spec[sl++] = s.conv;
+				spec[sl] = '\0';
+				n = EMIT((unsigned long long)v);
+			}
+			break;
+		}
+		case 'p': {
+			uint64_t v;
+			if (!get_var(&cur, end, &v)) return -1;
+			n = snprintf(o, room, "0x%" PRIx32, (uint32_t)v);
+			break;
+		}
+		case 'f': case 'F': case 'e': case 'E':
+		case 'g': case 'G': case 'a': case 'A': {
+			if (end - cur < 8) return -1;
+			uint64_t bits = get_le(cur, 8);
+			double d;
+			memcpy(&d, &bits, sizeof(d));
+			cur += 8;
+
+			spec[sl++] = s.conv;
+			spec[sl] = '\0';
+			n = EMIT(d);
+			break;
+		}
+		case 's': {
+			if (end - cur < 1 || (size_t)(end - cur - 1) < cur[0]) return -1;
+			char str[UINT8_MAX + 1];
+			memcpy(str, cur + 1, cur[0]);
+			str[cur[0]] = '\0';
+			cur += 1 + cur[0];
+
+			spec[sl++] = 's';
+			spec[sl] = '\0';
+			n = EMIT(str);
+			break;
+		}
+		case 'n':
+			break;
+		default:
+			return -1;
+		}
+
+		if (n > 0) w += ((size_t)n < room) ? (size_t)n : room - 1;
+		p = s.end;
+	}
+
+	return (cur == end) ? (int)w : -1;
+}
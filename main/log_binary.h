@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Відкладений бінарний лог: замість відрендереної строки нода шле ID
+ * формат-строки (її адреса в образі прошивки), epoch і сирі аргументи.
+ * Текст відновлює host за ELF прошивки (host_sim/log_decode.c).
+ *
+ * Запис:
+ *	uint32_t fmt_id;		// little-endian
+ *	varint   epoch_sec;		// 0 якщо час ще не синхронізований
+ *	args...				// по специфікаторах формату:
+ *	  d i, '*'			— zigzag varint (до 64 біт)
+ *	  u o x X c p			— varint
+ *	  f e g a			— 8 байт (double, little-endian)
+ *	  s				— uint8_t len + байти без '\0'
+ *
+ * varint — LEB128 (7 біт на байт): дрібні числа (MAC, лічильники) — 1-2 байти.
+ */
+
+// На ESP32 формат-строки лежать у flash (DROM): адреса стабільна в межах збірки
+#ifndef LOG_BIN_FMT_ID
+	#define LOG_BIN_FMT_ID(fmt)	((uint32_t)(uintptr_t)(fmt))
+#endif
+
+// 0 => запис не влазить у cap або формат не підтримується
+size_t	log_bin_encode(uint8_t *out, size_t cap, uint32_t epoch_sec, const char *fmt, va_list ap);
+
+// Для host-декодера. Повертає довжину заголовка (fmt_id + epoch), 0 => битий запис
+size_t	log_bin_parse_hdr(const uint8_t *rec, size_t len, uint32_t *fmt_id, uint32_t *epoch_sec);
+
+// Зсув аргументів після timestamp esp_log (перший аргумент), 0 => битий запис.
+// Для порівняння строк без часу (дедуплікація).
+size_t	log_bin_msg_offset(const uint8_t *rec, size_t len);
+
+// fmt узятий з ELF по fmt_id. -1 => аргументи не відповідають формату
+int	log_bin_render(char *out, size_t cap, const char *fmt, const uint8_t *args, size_t args_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,287 @@
+#include "log_core.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+#ifndef LOG_CORE_LINE_MAX
+	#define LOG_CORE_LINE_MAX	320
+#endif
+
+#ifndef LOG_CORE_POOL_BUFS
+	#define LOG_CORE_POOL_BUFS	4
+#endif
+
+#define TIME_VALID_EPOCH	1577836800LL	// 2020-01-01
+
+// "[YYYY-MM-DD HH:MM:SS] " — рівно 22 символи
+#define TS_LEN			22
+
+typedef struct {
+	log_sink_fn_t	fn;
+	void		*ctx;
+} log_sink_t;
+
+static bool		s_started = false;
+static volatile bool	s_ts_enabled = true;
+
+static log_sink_t	s_sinks[LOG_CORE_MAX_SINKS];
+static atomic_int	s_sink_count;
+
+typedef struct {
+	log_raw_sink_fn_t	fn;
+	void			*ctx;
+} log_raw_sink_t;
+
+static log_raw_sink_t	s_raw_sinks[LOG_CORE_MAX_RAW_SINKS];
+static atomic_int	s_raw_sink_count;
+
+// Пул буферів: біт = буфер зайнятий
+static char		s_pool[LOG_CORE_POOL_BUFS][LOG_CORE_LINE_MAX];
+static atomic_uint	s_pool_busy;
+
+// Кеш часу: перерендер тільки коли змінилась секунда
+static portMUX_TYPE	s_lock = portMUX_INITIALIZER_UNLOCKED;
+static time_t		s_ts_sec = 0;
+static char		s_ts_str[TS_LEN + 1];
+
+static log_core_stats_t	s_stats;
+
+_Static_assert(LOG_CORE_POOL_BUFS <= 32, "pool mask is 32 bit");
+
+static int pool_get(void)
+{
+	unsigned busy = atomic_load_explicit(&s_pool_busy, memory_order_relaxed);
+
+	for (;;) {
+		unsigned free_mask = ~busy & ((1u << LOG_CORE_POOL_BUFS) - 1u);
+		if (!free_mask) return -1;
+
+		int idx = __builtin_ctz(free_mask);
+		if (atomic_compare_exchange_weak_explicit(&s_pool_busy, &busy, busy | (1u << idx),
+				memory_order_acquire, memory_order_relaxed)) {
+			return idx;
+		}
+	}
+}
+
+static void pool_put(int idx)
+{
+	atomic_fetch_and_explicit(&s_pool_busy, ~(1u << idx), memory_order_release);
+}
+
+// false => час ще не синхронізований
+static bool get_ts(char out[TS_LEN + 1], time_t *now_out)
+{
+	time_t now = time(NULL);
+	*now_out = now;
+
+	if ((int64_t)now < TIME_VALID_EPOCH) return false;
+
+	portENTER_CRITICAL(&s_lock);
+	bool hit = (now == s_ts_sec);
+	if (hit) memcpy(out, s_ts_str, TS_LEN + 1);
+	portEXIT_CRITICAL(&s_lock);
+
+	if (hit) return true;
+
+	// localtime_r/strftime — поза критичною секцією
+	struct tm tm_now;
+	localtime_r(&now, &tm_now);
+	if (strftime(out, TS_LEN + 1, "[%Y-%m-%d %H:%M:%S] ", &tm_now) != TS_LEN) {
+		return false;
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	s_ts_sec = now;
+	memcpy(s_ts_str, out, TS_LEN + 1);
+	portEXIT_CRITICAL(&s_lock);
+	return true;
+}
+
+/*
+ * Формат esp_log: [колір "\033[0;32m"] "I (%" PRIu32 ") %s: ...", аргументи —
+ * timestamp і тег. Дістаємо рівень і тег без рендеру, щоб sink'и могли
+ * відфільтрувати строку ще до vsnprintf.
+ */
+static char peek_level_tag(const char *fmt, va_list ap, const char **tag)
+{
+	*tag = NULL;
+
+	if (fmt[0] == '\033' && fmt[1] == '[') {
+		const char *m = strchr(fmt, 'm');
+		if (!m) return 0;
+		fmt = m + 1;
+	}
+
+	char lvl = fmt[0];
+	if (lvl == '\0' || !strchr("EWIDV", lvl) || strncmp(fmt + 1, " (%", 3) != 0) return 0;
+
+	const char *p = strchr(fmt + 4, ')');
+	if (!p || strncmp(p, ") %s: ", 6) != 0) return 0;
+
+	va_list aq;
+	va_copy(aq, ap);
+	(void)va_arg(aq, uint32_t);
+	*tag = va_arg(aq, const char *);
+	va_end(aq);
+
+	return lvl;
+}
+
+/*
+ * buf: [TS_LEN місця під час][строка від vsnprintf]
+ * Для рядка esp_log час вставляємо після "I (1234) ", щоб строка все ще
+ * починалась з рівня (кольори/парсери), інакше — на початок.
+ */
+static void render_and_dispatch(char *buf, size_t cap, char level, const char *tag, const char *fmt, va_list ap)
+{
+	char *msg = buf + TS_LEN;
+	size_t msg_cap = cap - TS_LEN;
+
+	int w = vsnprintf(msg, msg_cap, fmt, ap);
+	if (w < 0) return;
+
+	size_t len = (size_t)w;
+	if (len >= msg_cap) {
+		len = msg_cap - 1;
+		portENTER_CRITICAL(&s_lock);
+		s_stats.truncated++;
+		portEXIT_CRITICAL(&s_lock);
+	}
+
+	log_line_t line = {
+		.text		= msg,
+		.len		= len,
+		.level		= level,	// з формату (peek_level_tag), колір його не ховає
+		.tag		= tag,
+		.epoch_sec	= 0,
+	};
+
+	char ts[TS_LEN + 1];
+	time_t now;
+	if (get_ts(ts, &now)) {
+		line.epoch_sec = (uint32_t)now;
+
+		if (s_ts_enabled) {
+			char *start = buf;
+			size_t head = 0;
+
+			if (line.level) {
+				const char *p = memchr(msg, ')', len);
+				if (p && (size_t)(p - msg) + 1 < len && p[1] == ' ') {
+					head = (size_t)(p - msg) + 2;	// включно ") "
+				}
+			}
+
+			memmove(start, msg, head);
+			memcpy(start + head, ts, TS_LEN);
+			line.text = start;
+			line.len = len + TS_LEN;
+		}
+	}
+
+	int n = atomic_load_explicit(&s_sink_count, memory_order_acquire);
+	for (int i = 0; i < n; i++) {
+		s_sinks[i].fn(s_sinks[i].ctx, &line);
+	}
+}
+
+static int log_core_vprintf(const char *fmt, va_list ap)
+{
+	const char *tag;
+	char level = peek_level_tag(fmt, ap, &tag);
+
+	int nraw = atomic_load_explicit(&s_raw_sink_count, memory_order_acquire);
+	for (int i = 0; i < nraw; i++) {
+		va_list aq;
+		va_copy(aq, ap);
+		s_raw_sinks[i].fn(s_raw_sinks[i].ctx, level, tag, fmt, aq);
+		va_end(aq);
+	}
+
+	int idx = pool_get();
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.lines++;
+	if (idx < 0) s_stats.pool_miss++;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (idx >= 0) {
+		render_and_dispatch(s_pool[idx], sizeof(s_pool[idx]), level, tag, fmt, ap);
+		pool_put(idx);
+	} else {
+		// рідко: більше одночасних логерів, ніж буферів
+		char stack_buf[LOG_CORE_LINE_MAX];
+		render_and_dispatch(stack_buf, sizeof(stack_buf), level, tag, fmt, ap);
+	}
+
+	return 0;
+}
+
+esp_err_t log_core_start(void)
+{
+	if (s_started) {
+		return ESP_OK;
+	}
+	s_started = true;
+
+	esp_log_set_vprintf(log_core_vprintf);
+	return ESP_OK;
+}
+
+esp_err_t log_core_add_sink(log_sink_fn_t fn, void *ctx)
+{
+	if (!fn) return ESP_ERR_INVALID_ARG;
+
+	portENTER_CRITICAL(&s_lock);
+	int n = atomic_load_explicit(&s_sink_count, memory_order_relaxed);
+	if (n >= LOG_CORE_MAX_SINKS) {
+		portEXIT_CRITICAL(&s_lock);
+		return ESP_ERR_NO_MEM;
+	}
+	s_sinks[n].fn = fn;
+	s_sinks[n].ctx = ctx;
+	atomic_store_explicit(&s_sink_count, n + 1, memory_order_release);
+	portEXIT_CRITICAL(&s_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t log_core_add_raw_sink(log_raw_sink_fn_t fn, void *ctx)
+{
+	if (!fn) return ESP_ERR_INVALID_ARG;
+
+	portENTER_CRITICAL(&s_lock);
+	int n = atomic_load_explicit(&s_raw_sink_count, memory_order_relaxed);
+	if (n >= LOG_CORE_MAX_RAW_SINKS) {
+		portEXIT_CRITICAL(&s_lock);
+		return ESP_ERR_NO_MEM;
+	}
+	s_raw_sinks[n].fn = fn;
+	s_raw_sinks[n].ctx = ctx;
+	atomic_store_explicit(&s_raw_sink_count, n + 1, memory_order_release);
+	portEXIT_CRITICAL(&s_lock);
+
+	return ESP_OK;
+}
+
+void log_core_set_timestamps(bool en)
+{
+	s_ts_enabled = en;
+}
+
+void log_core_get_stats(log_core_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
+}
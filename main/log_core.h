@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Єдиний хук esp_log: кожна строка рендериться ОДИН раз (vsnprintf у буфер з
+ * пулу), час вставляється з кешу (strftime раз на секунду), далі строка йде
+ * у всі зареєстровані sink'и (UART, mesh-стрім, RAM-кільце).
+ */
+
+#define LOG_CORE_MAX_SINKS	4
+#define LOG_CORE_MAX_RAW_SINKS	2
+
+typedef struct {
+	const char	*text;		// '\0' в кінці, час уже вставлений
+	size_t		len;
+	char		level;		// 'E','W','I','D','V' або 0, якщо це не рядок esp_log
+	const char	*tag;		// тег esp_log або NULL
+	uint32_t	epoch_sec;	// 0 якщо час ще не синхронізований
+} log_line_t;
+
+// Викликається з контексту таски, що логує. НЕ логувати всередині!
+typedef void (*log_sink_fn_t)(void *ctx, const log_line_t *line);
+
+// Sink без рендеру: отримує формат і аргументи як є (бінарний лог).
+// level/tag — як у log_line_t, витягнуті з формату до будь-якого рендеру.
+typedef void (*log_raw_sink_fn_t)(void *ctx, char level, const char *tag, const char *fmt, va_list ap);
+
+typedef struct {
+	uint32_t	lines;
+	uint32_t	pool_miss;	// всі буфери пулу зайняті => рендер у стек
+	uint32_t	truncated;
+} log_core_stats_t;
+
+// Ставить хук (1 раз). Можна викликати повторно.
+esp_err_t	log_core_start(void);
+
+esp_err_t	log_core_add_sink(log_sink_fn_t fn, void *ctx);
+esp_err_t	log_core_add_raw_sink(log_raw_sink_fn_t fn, void *ctx);
+
+// Вставляти "[YYYY-MM-DD HH:MM:SS] " у строки (коли час валідний)
+void		log_core_set_timestamps(bool en);
+
+void		log_core_get_stats(log_core_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+#include "log_lz.h"
+
+#include <string.h>
+
+#define HASH_MASK	((1u << LOG_LZ_HASH_BITS) - 1)
+#define WIN_MASK	(LOG_LZ_WINDOW - 1)
+
+_Static_assert((LOG_LZ_WINDOW & WIN_MASK) == 0, "LOG_LZ_WINDOW must be a power of two");
+
+static unsigned hash3(const uint8_t *p)
+{
+	return ((p[0] << 5) ^ (p[1] << 2) ^ p[2] ^ (p[0] >> 3)) & HASH_MASK;
+}
+
+static void insert(log_lz_state_t *st, const uint8_t *in, size_t pos)
+{
+	unsigned h = hash3(in + pos);
+	st->prev[pos & WIN_MASK] = st->head[h];
+	st->head[h] = (uint16_t)(pos + 1);
+}
+
+size_t log_lz_compress(log_lz_state_t *st, uint8_t *out, size_t cap, const uint8_t *in, size_t len)
+{
+	if (!st || !out || !in || len == 0 || len > UINT16_MAX - 1) return 0;
+
+	memset(st->head, 0, sizeof(st->head));
+
+	// не менше ніж на байт коротше — інакше стискати нема сенсу
+	size_t lim = (cap < len) ? cap : len - 1;
+	size_t o = 0, flags_at = 0;
+	unsigned bit = 8;
+
+	for (size_t pos = 0; pos < len; ) {
+		if (bit == 8) {
+			if (o >= lim) return 0;
+			flags_at = o;
+			out[o++] = 0;
+			bit = 0;
+		}
+
+		size_t best_len = 0, best_off = 0;
+		size_t max = len - pos;
+		if (max > LOG_LZ_MAX_MATCH) max = LOG_LZ_MAX_MATCH;
+
+		if (max >= LOG_LZ_MIN_MATCH) {
+			size_t cand = st->head[hash3(in + pos)];
+			for (unsigned depth = 0; cand && depth < LOG_LZ_CHAIN; depth++) {
+				size_t c = cand - 1;
+				if (c >= pos || pos - c > LOG_LZ_WINDOW) break;
+
+				size_t n = 0;
+				while (n < max && in[c + n] == in[pos + n]) n++;
+				if (n > best_len) {
+					best_len = n;
+					best_off = pos - c;
+					if (n == max) break;
+				}
+
+				size_t next = st->prev[c & WIN_MASK];
+				if (next >= cand) break;	// запис уже перезаписаний новішою позицією
+				cand = next;
+			}
+		}
+
+		if (best_len >= LOG_LZ_MIN_MATCH) {
+			if (o + 2 > lim) return 0;
+			out[flags_at] |= (uint8_t)(1u << bit);
+			out[o++] = (uint8_t)((best_off - 1) & 0xFF);
+			out[o++] = (uint8_t)(((best_off - 1) >> 8) << 6 | (best_len - LOG_LZ_MIN_MATCH));
+
+			for (size_t end = pos + best_len; pos < end; pos++) {
+				if (pos + LOG_LZ_MIN_MATCH <= len) insert(st, in, pos);
+			}
+		} else {
+			if (o >= lim) return 0;
+			out[o++] = in[pos];
+			if (pos + LOG_LZ_MIN_MATCH <= len) insert(st, in, pos);
+			pos++;
+		}
+		bit++;
+	}
+	return o;
+}
+
+int log_lz_decompress(uint8_t *out, size_t cap, const uint8_t *in, size_t len)
+{
+	if (!out || !in) return -1;
+
+	size_t i = 0, o = 0;
+
+	while (i < len) {
+		uint8_t flags = in[i++];
+
+		for (unsigned bit = 0; bit < 8 && i < len; bit++) {
+			if (!(flags & (1u << bit))) {
+				if (o >= cap) return -1;
+				out[o++] = in[i++];
+				continue;
+			}
+
+			if (i + 2 > len) return -1;
+			size_t off = ((size_t)(in[i + 1] >> 6) << 8 | in[i]) + 1;
+			size_t n = (in[i + 1] & 0x3F) + LOG_LZ_MIN_MATCH;
+			i += 2;
+
+			if (off > o || o + n > cap) return -1;
+			// побайтово: збіг може перекривати сам себе
+			for (size_t k = 0; k < n; k++, o++) {
+				out[o] = out[o - off];
+			}
+		}
+	}
+	return (int)o;
+}
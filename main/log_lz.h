@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Маленький LZSS для лог-фреймів (MESH_LOG_TYPE_F_LZ). Стискається кожен фрейм
+ * окремо (втрата пакета не ламає наступні), вікно — LOG_LZ_WINDOW байт назад.
+ * RAM енкодера — тільки log_lz_state_t (~2.5 kB), декодеру пам'ять не потрібна:
+ * вікно — це вже розпакований вихід.
+ *
+ * Потік: групи { uint8_t flags; 8 x елемент }, біт i (з молодшого) = 1 => збіг:
+ *	b0 = (off - 1) & 0xFF
+ *	b1 = ((off - 1) >> 8) << 6 | (len - LOG_LZ_MIN_MATCH)
+ * інакше — 1 байт літерала.
+ */
+
+#define LOG_LZ_WINDOW		1024			// off: 1..1024 (10 біт)
+#define LOG_LZ_MIN_MATCH	3
+#define LOG_LZ_MAX_MATCH	(LOG_LZ_MIN_MATCH + 63)	// len: 6 біт
+#define LOG_LZ_HASH_BITS	8
+#define LOG_LZ_CHAIN		8			// скільки кандидатів перевіряти
+
+typedef struct {
+	uint16_t	head[1 << LOG_LZ_HASH_BITS];	// позиція + 1, 0 => порожньо
+	uint16_t	prev[LOG_LZ_WINDOW];
+} log_lz_state_t;
+
+// 0 => вихід не менший за вхід (шлемо як є) або len > UINT16_MAX
+size_t	log_lz_compress(log_lz_state_t *st, uint8_t *out, size_t cap, const uint8_t *in, size_t len);
+
+// Довжина розпакованого, -1 => битий потік або не влазить у cap
+int	log_lz_decompress(uint8_t *out, size_t cap, const uint8_t *in, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
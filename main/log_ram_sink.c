@@ -0,0 +1,72 @@
+#include "log_ram_sink.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+
+#include "log_core.h"
+
+static char		s_ring[CONFIG_LOG_RAM_RING_SIZE];
+static size_t		s_head = 0;		// куди пишемо далі
+static bool		s_wrapped = false;
+static bool		s_started = false;
+static portMUX_TYPE	s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void ram_sink(void *ctx, const log_line_t *line)
+{
+	(void)ctx;
+
+	const char *src = line->text;
+	size_t n = line->len;
+
+	// довша за кільце строка — лишаємо хвіст
+	if (n > sizeof(s_ring)) {
+		src += n - sizeof(s_ring);
+		n = sizeof(s_ring);
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	size_t first = sizeof(s_ring) - s_head;
+	if (first > n) first = n;
+
+	memcpy(&s_ring[s_head], src, first);
+	memcpy(s_ring, src + first, n - first);
+
+	if (s_head + n >= sizeof(s_ring)) s_wrapped = true;
+	s_head = (s_head + n) % sizeof(s_ring);
+	portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t log_ram_sink_start(void)
+{
+	if (s_started) return ESP_OK;
+	s_started = true;
+
+	log_core_start();
+	return log_core_add_sink(ram_sink, NULL);
+}
+
+size_t log_ram_sink_read(char *out, size_t out_sz)
+{
+	if (!out || out_sz == 0) return 0;
+
+	portENTER_CRITICAL(&s_lock);
+
+	size_t used = s_wrapped ? sizeof(s_ring) : s_head;
+	size_t start = s_wrapped ? s_head : 0;
+
+	// якщо out менший — віддаємо найновіше
+	if (used > out_sz) {
+		start = (start + (used - out_sz)) % sizeof(s_ring);
+		used = out_sz;
+	}
+
+	size_t first = sizeof(s_ring) - start;
+	if (first > used) first = used;
+	memcpy(out, &s_ring[start], first);
+	memcpy(out + first, s_ring, used - first);
+
+	portEXIT_CRITICAL(&s_lock);
+	return used;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RAM-кільце останніх CONFIG_LOG_RAM_RING_SIZE байт логу (sink для log_core)
+esp_err_t	log_ram_sink_start(void);
+
+// Копіює вміст кільця (від найстарішого) в out, повертає кількість байт.
+// out НЕ закінчується '\0'.
+size_t		log_ram_sink_read(char *out, size_t out_sz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,468 @@
+#include "mesh_cmd.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "lat_hist.h"
+#include "mesh_hdr.h"
+#include "mesh_proto.h"
+#include "mesh_rx.h"
+#include "mesh_time_sync.h"
+#include "mesh_tx.h"
+#include "powled_node.h"
+
+static const char *TAG = "mesh_cmd";
+
+/*
+ * Бінарні команди: хендлер з таблиці mesh_rx одразу кличе powled_node_set_mask(),
+ * без строк і логів на шляху. ACK несе час від прийому до виконання на ноді,
+ * root додає RTT за seq — так видно, де губиться час команди.
+ */
+
+#define CMD_PENDING	64		// root: скільки seq пам'ятаємо для RTT (степінь двійки)
+
+typedef struct {
+	uint16_t	seq;
+	bool		used;
+	int64_t		sent_us;
+} cmd_pending_t;
+
+static portMUX_TYPE	s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t		s_pkt_cnt = 0;
+static uint16_t		s_seq = 0;
+static cmd_pending_t	s_pending[CMD_PENDING];
+static mesh_cmd_stats_t	s_stats;
+
+// нода: остання оброблена команда (повтор після втраченого ACK не виконуємо
+// вдруге, а відповідаємо тим самим статусом). seq — лічильник відправника, тож
+// ключ — (MAC, seq), і скидається при зміні root'а (новий root рахує з 1).
+static bool		s_have_last = false;
+static uint8_t		s_last_mac[6];
+static uint16_t		s_last_seq = 0;
+static uint8_t		s_last_status = MESH_CMD_ST_OK;
+
+/*
+ * Трасування (MESH_CMD_F_TRACE): root кладе в CMD свій epoch-час відправки,
+ * нода повертає в ACK три відрізки — мережа (за синхронізованими годинниками),
+ * черга mesh_rx і виконання. Root веде гістограми повної затримки по нодах і
+ * по шарах (з розкладом на відрізки); пам'ять — при першому такому ACK.
+ */
+#define TRACE_LAYERS	CONFIG_MESH_MAX_LAYER
+
+typedef struct {
+	bool		used;
+	uint8_t		mac[6];
+	uint8_t		layer;
+	lat_hist_t	total;
+} trace_node_t;
+
+typedef struct {
+	lat_hist_t	total;
+	lat_hist_t	net;
+	lat_hist_t	queue;
+	lat_hist_t	apply;
+} trace_layer_t;
+
+typedef struct {
+	trace_node_t	node[CONFIG_MESH_CMD_TRACE_NODES];
+	trace_layer_t	layer[TRACE_LAYERS];
+} trace_t;
+
+static bool		s_trace_on = false;
+static trace_t		*s_trace = NULL;
+
+static int64_t now_epoch_us(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void hdr_fill(mesh_pkt_hdr_t *h, uint8_t type)
+{
+	mesh_hdr_fill(h, type, ++s_pkt_cnt);
+}
+
+static esp_err_t send_to(const mesh_addr_t *to, const void *buf, size_t len)
+{
+	return mesh_tx_send(MESH_TX_CTRL, to, buf, len, 0);
+}
+
+static esp_err_t cmd_send(const mesh_addr_t *to, uint8_t channel, uint8_t level, uint8_t flags,
+			  uint16_t fade_ms, bool ack, int64_t at_us)
+{
+	if (!to) return ESP_ERR_INVALID_ARG;
+
+	// mesh_cmd_packet_t [+ int64 at_us] [+ uint16 fade_ms] [+ int64 t_root_us]
+	uint8_t buf[sizeof(mesh_cmd_packet_t) + sizeof(int64_t) + sizeof(uint16_t) + sizeof(int64_t)];
+	mesh_cmd_packet_t *c = (mesh_cmd_packet_t *)buf;
+	size_t len = sizeof(*c);
+
+	memset(buf, 0, sizeof(buf));
+	hdr_fill(&c->h, MESH_PKT_TYPE_CMD);
+	c->channel = channel;
+	c->level = level;
+	c->flags = flags | (ack ? MESH_CMD_F_ACK : 0);
+	if (at_us) {
+		c->flags |= MESH_CMD_F_AT;
+		memcpy(buf + len, &at_us, sizeof(at_us));
+		len += sizeof(at_us);
+	}
+	if (flags & MESH_CMD_F_FADE) {
+		memcpy(buf + len, &fade_ms, sizeof(fade_ms));
+		len += sizeof(fade_ms);
+	}
+	if (s_trace_on) {
+		c->flags |= MESH_CMD_F_TRACE | MESH_CMD_F_ACK;
+		ack = true;
+		len += sizeof(int64_t);	// t_root_us — перед самою відправкою
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	c->seq = ++s_seq;
+	if (ack) {
+		cmd_pending_t *e = &s_pending[c->seq & (CMD_PENDING - 1)];
+		e->seq = c->seq;
+		e->used = true;
+		e->sent_us = esp_timer_get_time();
+	}
+	portEXIT_CRITICAL(&s_lock);
+
+	if (c->flags & MESH_CMD_F_TRACE) {
+		int64_t t_root = now_epoch_us();
+		memcpy(buf + len - sizeof(t_root), &t_root, sizeof(t_root));
+	}
+	esp_err_t err = send_to(to, buf, len);
+
+	portENTER_CRITICAL(&s_lock);
+	if (err == ESP_OK) s_stats.tx++;
+	else s_stats.tx_err++;
+	portEXIT_CRITICAL(&s_lock);
+	return err;
+}
+
+esp_err_t mesh_cmd_send(const mesh_addr_t *to, uint8_t channel, uint8_t level, bool ack, int64_t at_us)
+{
+	return cmd_send(to, channel, level, 0, 0, ack, at_us);
+}
+
+esp_err_t mesh_cmd_send_mask(const mesh_addr_t *to, uint8_t mask, uint8_t on, bool ack, int64_t at_us)
+{
+	return cmd_send(to, mask, on, MESH_CMD_F_MASK, 0, ack, at_us);
+}
+
+esp_err_t mesh_cmd_send_fade(const mesh_addr_t *to, uint8_t channel, uint8_t level, uint16_t fade_ms,
+			     bool ack, int64_t at_us)
+{
+	return cmd_send(to, channel, level, MESH_CMD_F_FADE, fade_ms, ack, at_us);
+}
+
+// tr != NULL — ACK з трасою (a всередині заповнюється тут)
+static void send_ack(const mesh_addr_t *to, const mesh_cmd_packet_t *c, uint8_t status, uint32_t node_us,
+		     mesh_cmd_ack_trace_packet_t *tr)
+{
+	mesh_cmd_ack_trace_packet_t plain;
+	if (!tr) memset(&plain, 0, sizeof(plain));
+	mesh_cmd_ack_trace_packet_t *t = tr ? tr : &plain;
+	mesh_cmd_ack_packet_t *a = &t->a;
+
+	hdr_fill(&a->h, MESH_PKT_TYPE_CMD_ACK);
+	a->seq = c->seq;
+	a->channel = c->channel;
+	a->status = status;
+	a->node_us = node_us;
+
+	esp_err_t err = send_to(to, t, tr ? sizeof(*tr) : sizeof(*a));
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "ACK seq=%u err=%s", (unsigned)c->seq, esp_err_to_name(err));
+	}
+}
+
+esp_err_t mesh_cmd_handle_rx(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	if (!from || !pkt_buf || pkt_len < sizeof(mesh_cmd_packet_t)) return ESP_ERR_INVALID_SIZE;
+
+	int64_t t_dispatch = esp_timer_get_time();
+	const mesh_cmd_packet_t *c = (const mesh_cmd_packet_t *)pkt_buf;
+	uint8_t status = MESH_CMD_ST_OK;
+	bool dup;
+
+	portENTER_CRITICAL(&s_lock);
+	dup = s_have_last && c->seq == s_last_seq && memcmp(s_last_mac, from->addr, 6) == 0;
+	if (dup) {
+		status = s_last_status;
+		s_stats.dup++;
+	} else {
+		s_stats.rx++;
+	}
+	portEXIT_CRITICAL(&s_lock);
+
+	if (dup) {
+		// оброблено раніше; відповідаємо ще раз тим самим, бо попередній ACK, схоже, загубився
+		if (c->flags & MESH_CMD_F_ACK) send_ack(from, c, status, 0, NULL);
+		return status <= MESH_CMD_ST_SCHEDULED ? ESP_OK : ESP_ERR_NOT_FOUND;
+	}
+
+	// канали як маски: один канал — один біт, level 1..255 — увімк./яскравість
+	uint32_t mask, on;
+	uint8_t level;
+	if (c->flags & MESH_CMD_F_MASK) {
+		mask = c->channel;
+		on = c->level;
+		level = 255;
+	} else {
+		mask = c->channel < 32 ? 1u << c->channel : 0;
+		on = c->level ? mask : 0;
+		level = c->level;
+	}
+
+	size_t need = sizeof(*c) + ((c->flags & MESH_CMD_F_AT) ? sizeof(int64_t) : 0) +
+		      ((c->flags & MESH_CMD_F_FADE) ? sizeof(uint16_t) : 0) +
+		      ((c->flags & MESH_CMD_F_TRACE) ? sizeof(int64_t) : 0);
+	const uint8_t *tail = (const uint8_t *)pkt_buf + sizeof(*c);
+	int64_t at_us = 0;
+	uint16_t fade_ms = 0;
+
+	if (pkt_len < need) {
+		status = MESH_CMD_ST_BAD_LEN;
+	} else if (!mask || (mask & ~powled_node_ch_mask())) {
+		status = MESH_CMD_ST_BAD_CHANNEL;
+	} else {
+		if (c->flags & MESH_CMD_F_AT) {
+			memcpy(&at_us, tail, sizeof(at_us));
+			tail += sizeof(at_us);
+		}
+		if (c->flags & MESH_CMD_F_FADE) memcpy(&fade_ms, tail, sizeof(fade_ms));
+
+		if (c->flags & MESH_CMD_F_AT) {
+			powled_node_cmd_at(mask, on, level, fade_ms, at_us);
+			status = MESH_CMD_ST_SCHEDULED;
+		} else {
+			powled_node_fade(mask, on, level, fade_ms);
+		}
+	}
+
+	int64_t t_apply = esp_timer_get_time();
+	int64_t t_rx = mesh_rx_pkt_time_us(pkt_buf);
+	uint32_t node_us = (uint32_t)(t_apply - t_rx);
+
+	portENTER_CRITICAL(&s_lock);
+	s_have_last = true;
+	memcpy(s_last_mac, from->addr, 6);
+	s_last_seq = c->seq;
+	s_last_status = status;
+	if (status == MESH_CMD_ST_BAD_CHANNEL || status == MESH_CMD_ST_BAD_LEN) s_stats.bad++;
+	if (node_us > s_stats.node_us_max) s_stats.node_us_max = node_us;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (!(c->flags & MESH_CMD_F_ACK)) return status <= MESH_CMD_ST_SCHEDULED ? ESP_OK : ESP_ERR_NOT_FOUND;
+
+	if ((c->flags & MESH_CMD_F_TRACE) && pkt_len >= need) {
+		mesh_cmd_ack_trace_packet_t tr;
+		memset(&tr, 0, sizeof(tr));
+
+		int64_t t_root;
+		memcpy(&t_root, (const uint8_t *)pkt_buf + need - sizeof(t_root), sizeof(t_root));
+
+		mesh_time_sync_stats_t ts;
+		mesh_time_sync_get_stats(&ts);
+		if (ts.syncs) {
+			// момент прийому за синхронізованим годинником
+			int64_t rx_epoch = now_epoch_us() - (esp_timer_get_time() - t_rx);
+			tr.net_us = (int32_t)(rx_epoch - t_root);
+		} else {
+			tr.net_us = MESH_CMD_TRACE_NO_TIME;
+		}
+		tr.queue_us = (uint32_t)(t_dispatch - t_rx);
+		tr.apply_us = (uint32_t)(t_apply - t_dispatch);
+		tr.layer = (uint8_t)esp_mesh_get_layer();
+		send_ack(from, c, status, node_us, &tr);
+	} else {
+		send_ack(from, c, status, node_us, NULL);
+	}
+	return status <= MESH_CMD_ST_SCHEDULED ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void mesh_cmd_root_changed(void)
+{
+	portENTER_CRITICAL(&s_lock);
+	s_have_last = false;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+static void trace_add(const mesh_cmd_ack_trace_packet_t *t, uint32_t rtt)
+{
+	if (!s_trace) {
+		trace_t *tr = calloc(1, sizeof(*tr));
+		if (!tr) return;
+
+		portENTER_CRITICAL(&s_lock);
+		if (!s_trace) {
+			s_trace = tr;
+			tr = NULL;
+		}
+		portEXIT_CRITICAL(&s_lock);
+		free(tr);	// інший воркер встиг раніше
+	}
+
+	// нода без часу: мережу в один бік оцінюємо як (RTT - час на ноді) / 2
+	bool unsynced = t->net_us == MESH_CMD_TRACE_NO_TIME;
+	uint32_t net;
+	if (unsynced) net = rtt > t->a.node_us ? (rtt - t->a.node_us) / 2 : 0;
+	else net = t->net_us > 0 ? (uint32_t)t->net_us : 0;
+	uint32_t total = net + t->queue_us + t->apply_us;
+
+	uint8_t layer = t->layer ? t->layer : 1;
+	if (layer > TRACE_LAYERS) layer = TRACE_LAYERS;
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.trace_acks++;
+	if (unsynced) s_stats.trace_unsynced++;
+
+	trace_node_t *n = NULL, *free_slot = NULL;
+	for (int i = 0; i < CONFIG_MESH_CMD_TRACE_NODES; i++) {
+		trace_node_t *e = &s_trace->node[i];
+		if (e->used && memcmp(e->mac, t->a.h.src_mac, 6) == 0) {
+			n = e;
+			break;
+		}
+		if (!e->used && !free_slot) free_slot = e;
+	}
+	if (!n && free_slot) {
+		n = free_slot;
+		n->used = true;
+		memcpy(n->mac, t->a.h.src_mac, 6);
+	}
+	if (n) {
+		n->layer = layer;
+		lat_hist_add(&n->total, total);
+	} else {
+		s_stats.trace_no_slot++;
+	}
+
+	trace_layer_t *l = &s_trace->layer[layer - 1];
+	lat_hist_add(&l->total, total);
+	lat_hist_add(&l->net, net);
+	lat_hist_add(&l->queue, t->queue_us);
+	lat_hist_add(&l->apply, t->apply_us);
+	portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t mesh_cmd_handle_ack(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	(void)from;
+	if (!pkt_buf || pkt_len < sizeof(mesh_cmd_ack_packet_t)) return ESP_ERR_INVALID_SIZE;
+
+	const mesh_cmd_ack_packet_t *a = (const mesh_cmd_ack_packet_t *)pkt_buf;
+	int64_t rx_us = mesh_rx_pkt_time_us(pkt_buf);
+
+	portENTER_CRITICAL(&s_lock);
+	cmd_pending_t *e = &s_pending[a->seq & (CMD_PENDING - 1)];
+	if (!e->used || e->seq != a->seq) {
+		s_stats.ack_unknown++;
+		portEXIT_CRITICAL(&s_lock);
+		return ESP_ERR_NOT_FOUND;
+	}
+	e->used = false;
+
+	uint32_t rtt = (uint32_t)(rx_us - e->sent_us);
+	s_stats.acks++;
+	s_stats.ack_rtt_us_total += rtt;
+	if (rtt > s_stats.ack_rtt_us_max) s_stats.ack_rtt_us_max = rtt;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (pkt_len >= sizeof(mesh_cmd_ack_trace_packet_t)) {
+		trace_add((const mesh_cmd_ack_trace_packet_t *)pkt_buf, rtt);
+	}
+
+	ESP_LOGD(TAG, "ACK seq=%u ch=%u st=%u rtt=%" PRIu32 " us node=%" PRIu32 " us",
+		(unsigned)a->seq, (unsigned)a->channel, (unsigned)a->status, rtt, a->node_us);
+	return ESP_OK;
+}
+
+void mesh_cmd_get_stats(mesh_cmd_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+void mesh_cmd_set_trace(bool on)
+{
+	s_trace_on = on;
+}
+
+static void row_fill(mesh_cmd_trace_row_t *r, const lat_hist_t *h)
+{
+	r->n = h->n;
+	r->p50_us = lat_hist_pct(h, 50);
+	r->p99_us = lat_hist_pct(h, 99);
+	r->max_us = h->max_us;
+}
+
+int mesh_cmd_trace_nodes(mesh_cmd_trace_row_t *out, int max)
+{
+	int cnt = 0;
+	if (!out || !s_trace) return 0;
+
+	portENTER_CRITICAL(&s_lock);
+	for (int i = 0; i < CONFIG_MESH_CMD_TRACE_NODES && cnt < max; i++) {
+		const trace_node_t *e = &s_trace->node[i];
+		if (!e->used) continue;
+
+		mesh_cmd_trace_row_t *r = &out[cnt++];
+		memset(r, 0, sizeof(*r));
+		memcpy(r->mac, e->mac, 6);
+		r->layer = e->layer;
+		row_fill(r, &e->total);
+	}
+	portEXIT_CRITICAL(&s_lock);
+	return cnt;
+}
+
+int mesh_cmd_trace_layers(mesh_cmd_trace_row_t *out, int max)
+{
+	int cnt = 0;
+	if (!out || !s_trace) return 0;
+
+	portENTER_CRITICAL(&s_lock);
+	for (int i = 0; i < TRACE_LAYERS && cnt < max; i++) {
+		const trace_layer_t *l = &s_trace->layer[i];
+		if (!l->total.n) continue;
+
+		mesh_cmd_trace_row_t *r = &out[cnt++];
+		memset(r, 0, sizeof(*r));
+		r->layer = (uint8_t)(i + 1);
+		row_fill(r, &l->total);
+		r->net_p50_us = lat_hist_pct(&l->net, 50);
+		r->queue_p50_us = lat_hist_pct(&l->queue, 50);
+		r->apply_p50_us = lat_hist_pct(&l->apply, 50);
+	}
+	portEXIT_CRITICAL(&s_lock);
+	return cnt;
+}
+
+void mesh_cmd_trace_log(void)
+{
+	mesh_cmd_trace_row_t rows[TRACE_LAYERS];
+	int n = mesh_cmd_trace_layers(rows, TRACE_LAYERS);
+
+	for (int i = 0; i < n; i++) {
+		const mesh_cmd_trace_row_t *r = &rows[i];
+		ESP_LOGI(TAG, "layer %u: n=%" PRIu32 " p50=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32
+			 " us (net %" PRIu32 ", queue %" PRIu32 ", apply %" PRIu32 ")",
+			 (unsigned)r->layer, r->n, r->p50_us, r->p99_us, r->max_us,
+			 r->net_p50_us, r->queue_p50_us, r->apply_p50_us);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	// нода
+	uint32_t	rx;			// CMD прийнято
+	uint32_t	dup;			// повтор останнього seq (тільки ACK, без виконання)
+	uint32_t	bad;			// невідомий канал / короткий пакет
+	uint32_t	node_us_max;		// найдовше від прийому до виконання
+
+	// root
+	uint32_t	tx;			// CMD відправлено
+	uint32_t	tx_err;
+	uint32_t	acks;			// CMD_ACK зіставлено з відправленим
+	uint32_t	ack_unknown;		// ACK на невідомий/старий seq
+	uint64_t	ack_rtt_us_total;
+	uint32_t	ack_rtt_us_max;
+	uint32_t	trace_acks;		// ACK з трасою
+	uint32_t	trace_unsynced;		// ... від ноди без часу: мережа = (RTT - нода) / 2
+	uint32_t	trace_no_slot;		// нода не влізла в CONFIG_MESH_CMD_TRACE_NODES
+} mesh_cmd_stats_t;
+
+// Root: затримка від відправки CMD до запису виходу, перцентилі гістограм
+typedef struct {
+	uint8_t		mac[6];			// рядок шару — нулі
+	uint8_t		layer;
+	uint32_t	n;
+	uint32_t	p50_us;
+	uint32_t	p99_us;
+	uint32_t	max_us;
+	uint32_t	net_p50_us;		// тільки рядки шарів: медіани відрізків
+	uint32_t	queue_p50_us;
+	uint32_t	apply_p50_us;
+} mesh_cmd_trace_row_t;
+
+// Root (або будь-хто): команда на ноду to. at_us != 0 => MESH_CMD_F_AT
+esp_err_t	mesh_cmd_send(const mesh_addr_t *to, uint8_t channel, uint8_t level, bool ack, int64_t at_us);
+
+// Кілька каналів разом (MESH_CMD_F_MASK): біт n у mask — канал n, у on — увімк.
+esp_err_t	mesh_cmd_send_mask(const mesh_addr_t *to, uint8_t mask, uint8_t on, bool ack, int64_t at_us);
+
+// Яскравість level за fade_ms (MESH_CMD_F_FADE, нода з CONFIG_POWLED_DIM)
+esp_err_t	mesh_cmd_send_fade(const mesh_addr_t *to, uint8_t channel, uint8_t level, uint16_t fade_ms,
+				   bool ack, int64_t at_us);
+
+// RX: type == MESH_PKT_TYPE_CMD / MESH_PKT_TYPE_CMD_ACK
+esp_err_t	mesh_cmd_handle_rx(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len);
+esp_err_t	mesh_cmd_handle_ack(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len);
+
+// MESH_EVENT_ROOT_ADDRESS: забути останню команду (у нового root'а seq знову з 1)
+void		mesh_cmd_root_changed(void);
+
+void		mesh_cmd_get_stats(mesh_cmd_stats_t *out);
+
+// Root: трасувати наступні CMD (MESH_CMD_F_TRACE, завжди з ACK)
+void		mesh_cmd_set_trace(bool on);
+
+// Root: рядки по нодах / по шарах (від 1), повертає кількість
+int		mesh_cmd_trace_nodes(mesh_cmd_trace_row_t *out, int max);
+int		mesh_cmd_trace_layers(mesh_cmd_trace_row_t *out, int max);
+void		mesh_cmd_trace_log(void);
+
+#ifdef __cplusplus
+}
+#endif
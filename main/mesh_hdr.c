@@ -0,0 +1,430 @@
+#include "mesh_hdr.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "mesh_tx.h"
+
+static const char *TAG = "mesh_hdr";
+
+#define V1_HDR		sizeof(mesh_pkt_hdr_t)
+
+/*
+ * Оренда v2 у ноди: root'а вважаємо v2, поки чули від нього v2 або NODE_ID не
+ * пізніше за LEASE_US (root, перепрошитий на старий, інакше мовчки викидав би
+ * все). Root повторює NODE_ID на v1-пакет з max_version >= 2: поки нода не
+ * відповіла v2 — не частіше за ID_RETRY_US (NODE_ID міг загубитись), далі —
+ * за ID_REFRESH_US (довгі пакети нода шле з v1, це не привід слати щосекунди),
+ * що й продовжує оренду.
+ */
+#define LEASE_US	(30 * 1000000LL)
+#define ID_RETRY_US	(1000000LL)
+#define ID_REFRESH_US	(LEASE_US / 2)
+
+#if CONFIG_MESH_PROTO_V2_CRC
+#define TX_CRC_LEN	MESH_PKT_V2_CRC_LEN
+#else
+#define TX_CRC_LEN	0
+#endif
+
+static portMUX_TYPE		s_lock = portMUX_INITIALIZER_UNLOCKED;
+static mesh_hdr_stats_t		s_stats = { .node_id = MESH_NODE_ID_NONE };
+
+#if CONFIG_MESH_PROTO_V2
+// Root: node_id = індекс + 1
+typedef struct {
+	uint8_t		mac[6];
+	bool		used;
+	bool		v2;		// розуміє v2 (max_version останнього v1 або v2-пакет)
+	bool		confirmed;	// прийшов v2 після останнього NODE_ID
+	int64_t		id_sent_us;	// 0 — ще не слали
+} hdr_peer_t;
+
+static hdr_peer_t		s_peers[CONFIG_MESH_PROTO_NODES];
+static uint32_t			s_pkt_cnt = 0;		// h.counter для NODE_ID
+
+// Нода
+static uint8_t			s_root_mac[6];
+static int64_t			s_root_heard_us = 0;
+#endif
+
+void mesh_hdr_fill(mesh_pkt_hdr_t *h, uint8_t type, uint32_t counter)
+{
+	h->magic = MESH_PKT_MAGIC;
+	h->version = MESH_PKT_VERSION;
+	h->type = type;
+#if CONFIG_MESH_PROTO_V2
+	h->max_version = MESH_PKT_VERSION_MAX;
+#else
+	h->max_version = 0;
+#endif
+	h->counter = counter;
+	esp_wifi_get_mac(WIFI_IF_STA, h->src_mac);
+}
+
+#if CONFIG_MESH_PROTO_V2
+
+static bool is_root_addr(const mesh_addr_t *a)
+{
+	static const uint8_t zero[6];
+	return !a || memcmp(a->addr, zero, sizeof(zero)) == 0;
+}
+
+// root шле й сам собі (legacy, логи) — собі node_id не видаємо
+static bool is_self(const mesh_addr_t *a)
+{
+	uint8_t mac[6];
+	esp_wifi_get_mac(WIFI_IF_STA, mac);
+	return memcmp(a->addr, mac, 6) == 0;
+}
+
+// Під s_lock
+static hdr_peer_t *peer_find(const uint8_t *mac)
+{
+	for (int i = 0; i < CONFIG_MESH_PROTO_NODES; i++) {
+		if (s_peers[i].used && memcmp(s_peers[i].mac, mac, 6) == 0) return &s_peers[i];
+	}
+	return NULL;
+}
+
+// Під s_lock; NULL — таблиця повна
+static hdr_peer_t *peer_get(const uint8_t *mac)
+{
+	hdr_peer_t *p = peer_find(mac);
+	if (p) return p;
+
+	for (int i = 0; i < CONFIG_MESH_PROTO_NODES; i++) {
+		if (!s_peers[i].used) {
+			p = &s_peers[i];
+			memset(p, 0, sizeof(*p));
+			memcpy(p->mac, mac, 6);
+			p->used = true;
+			s_stats.ids_assigned++;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+static uint16_t peer_id(const hdr_peer_t *p)
+{
+	return (uint16_t)(p - s_peers + 1);
+}
+
+static void send_node_id(const mesh_addr_t *to, uint16_t id)
+{
+	mesh_node_id_packet_t p;
+	memset(&p, 0, sizeof(p));
+	mesh_hdr_fill(&p.h, MESH_PKT_TYPE_NODE_ID, ++s_pkt_cnt);
+	p.node_id = id;
+	p.version = MESH_PKT_VERSION_MAX;
+
+	esp_err_t err = mesh_tx_send(MESH_TX_CTRL, to, &p, sizeof(p), 0);
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "NODE_ID %u -> " MACSTR " failed: 0x%x (%s)",
+			(unsigned)id, MAC2STR(to->addr), err, esp_err_to_name(err));
+	}
+}
+
+// Root: v1 від ноди — чи вона v2 і чи (пере)слати їй node_id
+static void root_note_v1(const mesh_addr_t *from, const mesh_pkt_hdr_t *h)
+{
+	bool v2 = h->max_version >= 2;
+	uint16_t id = MESH_NODE_ID_NONE;
+	int64_t now = esp_timer_get_time();
+
+	portENTER_CRITICAL(&s_lock);
+	hdr_peer_t *p = v2 ? peer_get(from->addr) : peer_find(from->addr);
+	if (p) {
+		p->v2 = v2;
+		int64_t gap = p->confirmed ? ID_REFRESH_US : ID_RETRY_US;
+		if (v2 && (!p->id_sent_us || now - p->id_sent_us >= gap)) {
+			p->id_sent_us = now;
+			s_stats.id_sent++;
+			id = peer_id(p);
+		}
+	}
+	portEXIT_CRITICAL(&s_lock);
+
+	if (v2 && !p) ESP_LOGW(TAG, MACSTR " stays v1: node table full", MAC2STR(from->addr));
+	if (id != MESH_NODE_ID_NONE) send_node_id(from, id);
+}
+
+// Root: v2 від ноди. Невідомий id (root перезавантажився) — забираємо собі,
+// чужий — видаємо ноді її власний.
+static void root_note_v2(const mesh_addr_t *from, uint16_t id)
+{
+	uint16_t resend = MESH_NODE_ID_NONE;
+	int64_t now = esp_timer_get_time();
+
+	portENTER_CRITICAL(&s_lock);
+	hdr_peer_t *p = NULL;
+	if (id >= 1 && id <= CONFIG_MESH_PROTO_NODES) {
+		p = &s_peers[id - 1];
+		if (!p->used && !peer_find(from->addr)) {
+			memset(p, 0, sizeof(*p));
+			memcpy(p->mac, from->addr, 6);
+			p->used = true;
+			p->id_sent_us = now;
+		} else if (memcmp(p->mac, from->addr, 6) != 0) {
+			p = NULL;
+		}
+	}
+	if (p) {
+		p->v2 = true;
+		p->confirmed = true;
+	} else if ((p = peer_get(from->addr)) != NULL) {
+		p->v2 = true;
+		if (!p->id_sent_us || now - p->id_sent_us >= ID_RETRY_US) {
+			p->id_sent_us = now;
+			p->confirmed = false;
+			s_stats.id_sent++;
+			resend = peer_id(p);
+		}
+	}
+	portEXIT_CRITICAL(&s_lock);
+
+	if (resend != MESH_NODE_ID_NONE) send_node_id(from, resend);
+}
+
+#endif // CONFIG_MESH_PROTO_V2
+
+size_t mesh_hdr_encode(const mesh_addr_t *to, const void *pkt, size_t len, uint8_t *out, size_t max)
+{
+#if CONFIG_MESH_PROTO_V2
+	const mesh_pkt_hdr_t *h = (const mesh_pkt_hdr_t *)pkt;
+
+	// компактні лог-пакети вже мають свій короткий заголовок
+	if (!pkt || len < V1_HDR || h->magic != MESH_PKT_MAGIC || h->version != MESH_PKT_VERSION ||
+	    (h->type & MESH_LOG_TYPE_F_COMPACT)) {
+		return 0;
+	}
+
+	size_t body = len - V1_HDR;
+	size_t crc_len = TX_CRC_LEN;
+	uint16_t id = MESH_NODE_ID_NONE;
+	bool root = esp_mesh_is_root();
+	int64_t now = esp_timer_get_time();
+
+	portENTER_CRITICAL(&s_lock);
+	if (root) {
+		hdr_peer_t *p = is_root_addr(to) ? NULL : peer_find(to->addr);
+		if (p && p->v2) id = MESH_NODE_ID_ROOT;
+	} else if (s_stats.root_v2 && now - s_root_heard_us < LEASE_US &&
+		   (is_root_addr(to) || memcmp(to->addr, s_root_mac, 6) == 0)) {
+		id = s_stats.node_id;
+	}
+	if (id == MESH_NODE_ID_NONE || MESH_PKT_V2_HDR_MAX + body + crc_len > max) {
+		s_stats.tx_v1++;
+		portEXIT_CRITICAL(&s_lock);
+		return 0;
+	}
+	portEXIT_CRITICAL(&s_lock);
+
+	uint16_t seq = (uint16_t)(h->counter & MESH_PKT_V2_SEQ_MASK);
+	size_t n = 0;
+
+	out[n++] = MESH_PKT_V2_MARK | (crc_len ? MESH_PKT_V2_F_CRC : 0);
+	out[n++] = h->type;
+	out[n++] = (uint8_t)id;
+	out[n++] = (uint8_t)(id >> 8);
+	if (seq < 0x80) {
+		out[n++] = (uint8_t)seq;
+	} else {
+		out[n++] = (uint8_t)(0x80 | (seq & 0x7F));
+		out[n++] = (uint8_t)(seq >> 7);
+	}
+	memcpy(out + n, h + 1, body);
+	n += body;
+
+	if (crc_len) {
+		uint16_t crc = esp_rom_crc16_le(0, out, (uint32_t)n);
+		out[n++] = (uint8_t)crc;
+		out[n++] = (uint8_t)(crc >> 8);
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.tx_v2++;
+	s_stats.hdr_saved += len - n;
+	portEXIT_CRITICAL(&s_lock);
+	return n;
+#else
+	(void)to; (void)pkt; (void)len; (void)out; (void)max;
+	return 0;
+#endif
+}
+
+size_t mesh_hdr_rx(const mesh_addr_t *from, uint8_t *buf, size_t len, size_t cap)
+{
+#if CONFIG_MESH_PROTO_V2
+	if (!from || len < 1) return len;
+
+	// v1 (і все чуже — його відкине mesh_rx_dispatch)
+	if ((buf[0] & MESH_PKT_V2_MARK_MASK) != MESH_PKT_V2_MARK) {
+		const mesh_pkt_hdr_t *h = (const mesh_pkt_hdr_t *)buf;
+		if (len >= V1_HDR && h->magic == MESH_PKT_MAGIC && h->version == MESH_PKT_VERSION &&
+		    !(h->type & MESH_LOG_TYPE_F_COMPACT)) {
+			portENTER_CRITICAL(&s_lock);
+			s_stats.rx_v1++;
+			portEXIT_CRITICAL(&s_lock);
+			if (esp_mesh_is_root() && !is_self(from)) root_note_v1(from, h);
+		}
+		return len;
+	}
+
+	size_t end = len;
+	if (buf[0] & MESH_PKT_V2_F_CRC) {
+		if (len < MESH_PKT_V2_HDR_MIN + MESH_PKT_V2_CRC_LEN) goto bad;
+		end -= MESH_PKT_V2_CRC_LEN;
+		uint16_t crc = (uint16_t)(buf[end] | (buf[end + 1] << 8));
+		if (esp_rom_crc16_le(0, buf, (uint32_t)end) != crc) {
+			portENTER_CRITICAL(&s_lock);
+			s_stats.bad_crc++;
+			portEXIT_CRITICAL(&s_lock);
+			return 0;
+		}
+	}
+	if (end < MESH_PKT_V2_HDR_MIN) goto bad;
+
+	uint8_t type = buf[1];
+	uint16_t id = (uint16_t)(buf[2] | (buf[3] << 8));
+	size_t n = 4;
+	uint16_t seq = buf[n] & 0x7F;
+	if (buf[n++] & 0x80) {
+		if (n >= end) goto bad;
+		seq |= (uint16_t)(buf[n++] << 7);
+	}
+
+	size_t body = end - n;
+	if (V1_HDR + body > cap) goto bad;
+	memmove(buf + V1_HDR, buf + n, body);
+
+	mesh_pkt_hdr_t *h = (mesh_pkt_hdr_t *)buf;
+	h->magic = MESH_PKT_MAGIC;
+	h->version = MESH_PKT_VERSION;
+	h->type = type;
+	h->max_version = MESH_PKT_VERSION_MAX;
+	h->counter = seq;
+	memcpy(h->src_mac, from->addr, 6);
+
+	bool root = esp_mesh_is_root();
+	int64_t now = esp_timer_get_time();
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.rx_v2++;
+	if (!root && s_stats.root_v2 && memcmp(from->addr, s_root_mac, 6) == 0) s_root_heard_us = now;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (root && !is_self(from)) root_note_v2(from, id);
+	return V1_HDR + body;
+
+bad:
+	portENTER_CRITICAL(&s_lock);
+	s_stats.bad_v2++;
+	portEXIT_CRITICAL(&s_lock);
+	return 0;
+#else
+	(void)from; (void)buf; (void)cap;
+	return len;
+#endif
+}
+
+esp_err_t mesh_hdr_handle_node_id(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+#if CONFIG_MESH_PROTO_V2
+	const mesh_node_id_packet_t *p = (const mesh_node_id_packet_t *)pkt_buf;
+
+	if (esp_mesh_is_root()) return ESP_OK;
+	if (p->node_id == MESH_NODE_ID_ROOT || p->node_id == MESH_NODE_ID_NONE) return ESP_ERR_INVALID_ARG;
+
+	bool changed;
+	int64_t now = esp_timer_get_time();
+
+	portENTER_CRITICAL(&s_lock);
+	changed = s_stats.node_id != p->node_id || !s_stats.root_v2;
+	s_stats.node_id = p->node_id;
+	s_stats.root_v2 = p->version >= 2;
+	memcpy(s_root_mac, from->addr, 6);
+	s_root_heard_us = now;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (changed) {
+		ESP_LOGI(TAG, "node_id %u from root " MACSTR ", v%u",
+			(unsigned)p->node_id, MAC2STR(from->addr), (unsigned)p->version);
+	}
+	return ESP_OK;
+#else
+	(void)from; (void)pkt_buf; (void)pkt_len;
+	return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void mesh_hdr_set_root(const uint8_t *root_mac)
+{
+#if CONFIG_MESH_PROTO_V2
+	if (!root_mac) return;
+
+	portENTER_CRITICAL(&s_lock);
+	if (memcmp(root_mac, s_root_mac, 6) != 0) {
+		s_stats.root_v2 = false;
+		s_stats.node_id = MESH_NODE_ID_NONE;
+	}
+	portEXIT_CRITICAL(&s_lock);
+#else
+	(void)root_mac;
+#endif
+}
+
+uint16_t mesh_hdr_node_id(void)
+{
+	portENTER_CRITICAL(&s_lock);
+	uint16_t id = s_stats.node_id;
+	portEXIT_CRITICAL(&s_lock);
+	return id;
+}
+
+bool mesh_hdr_root_v2(void)
+{
+	if (esp_mesh_is_root()) return true;
+
+	mesh_hdr_stats_t st;
+	mesh_hdr_get_stats(&st);
+	return st.root_v2;
+}
+
+void mesh_hdr_get_stats(mesh_hdr_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	out->peers_v2 = 0;
+#if CONFIG_MESH_PROTO_V2
+	int64_t now = esp_timer_get_time();
+	for (int i = 0; i < CONFIG_MESH_PROTO_NODES; i++) {
+		if (s_peers[i].used && s_peers[i].v2) out->peers_v2++;
+	}
+	if (out->root_v2 && now - s_root_heard_us >= LEASE_US) out->root_v2 = false;
+#endif
+	portEXIT_CRITICAL(&s_lock);
+}
+
+void mesh_hdr_log_stats(void)
+{
+	mesh_hdr_stats_t st;
+	mesh_hdr_get_stats(&st);
+
+	ESP_LOGI(TAG, "tx v2=%" PRIu32 " v1=%" PRIu32 " saved=%" PRIu64 " B, rx v2=%" PRIu32 " v1=%" PRIu32
+		" bad_crc=%" PRIu32 " bad=%" PRIu32 ", id=%u%s, peers v2=%" PRIu32,
+		st.tx_v2, st.tx_v1, st.hdr_saved, st.rx_v2, st.rx_v1, st.bad_crc, st.bad_v2,
+		(unsigned)st.node_id, st.root_v2 ? " (root v2)" : "", st.peers_v2);
+}
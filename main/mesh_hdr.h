@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_mesh.h"
+#include "mesh_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Заголовок пакета на дроті: v1 (mesh_pkt_hdr_t) або компактний v2
+ * (mesh_proto.h). Модулі будують і розбирають пакети тільки з v1; v2 — це
+ * кодування між mesh_tx_send і mesh_rx, коли друга сторона його розуміє.
+ *
+ * Узгодження (CONFIG_MESH_PROTO_V2): кожен v1-пакет несе max_version
+ * відправника. Root, побачивши max_version >= 2, видає ноді node_id
+ * (MESH_PKT_TYPE_NODE_ID) і сам шле їй з v2; нода з node_id шле root'у з v2.
+ * Нода без відповіді root'а (старий root, таблиця повна) лишається на v1.
+ * Нода вважає root'а v2, поки чує від нього v2 або NODE_ID (оренда), і до
+ * зміни root'а.
+ */
+
+typedef struct {
+	uint32_t	tx_v2;		// закодовано з v2
+	uint32_t	tx_v1;		// пішли з v1 (друга сторона не v2, довгий пакет)
+	uint64_t	hdr_saved;	// байт заголовків проти v1
+	uint32_t	rx_v2;
+	uint32_t	rx_v1;
+	uint32_t	bad_crc;	// v2 з MESH_PKT_V2_F_CRC, CRC не зійшовся => дроп
+	uint32_t	bad_v2;		// обрізаний / не влазить розгорнутим => дроп
+	uint32_t	ids_assigned;	// root: видано node_id
+	uint32_t	id_sent;	// root: NODE_ID відправлено (з повторами)
+	uint32_t	peers_v2;	// root: нод з v2 зараз
+	uint16_t	node_id;	// нода: свій node_id, MESH_NODE_ID_NONE — нема
+	bool		root_v2;	// нода: шле root'у з v2
+} mesh_hdr_stats_t;
+
+// v1-заголовок власного пакета: magic, version, max_version, src_mac
+void		mesh_hdr_fill(mesh_pkt_hdr_t *h, uint8_t type, uint32_t counter);
+
+// Пакет pkt (v1) для to (NULL або нульова адреса — root) у out з заголовком v2.
+// 0 — слати pkt як є (друга сторона не v2, не v1-пакет, не влазить у max).
+size_t		mesh_hdr_encode(const mesh_addr_t *to, const void *pkt, size_t len, uint8_t *out, size_t max);
+
+// Прийнятий пакет на місці в буфері cap байт: v2 розгортається у v1. Довжина
+// для mesh_rx_dispatch (v1 — без змін), 0 — викинути (CRC, обрізаний).
+// Заодно вчить версії відправників; root тут видає node_id (шле NODE_ID).
+size_t		mesh_hdr_rx(const mesh_addr_t *from, uint8_t *buf, size_t len, size_t cap);
+
+// Хендлер MESH_PKT_TYPE_NODE_ID (нода)
+esp_err_t	mesh_hdr_handle_node_id(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len);
+
+// MESH_EVENT_ROOT_ADDRESS: інший root — назад на v1, поки не видасть node_id
+void		mesh_hdr_set_root(const uint8_t *root_mac);
+
+// Нода: node_id від поточного root'а, MESH_NODE_ID_NONE — ще не видав
+uint16_t	mesh_hdr_node_id(void);
+
+// Поточний root — v2 (оренда, як root_v2 у статистиці) або це ми самі. Root з
+// max_version >= 2 розуміє й решту типів цієї версії (MESH_PKT_TYPE_TEXT_BATCH).
+bool		mesh_hdr_root_v2(void);
+
+void		mesh_hdr_get_stats(mesh_hdr_stats_t *out);
+void		mesh_hdr_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,61 +1,240 @@
 #include "mesh_log_stream.h"
 
+#include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
-#include <sys/time.h>
 
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "esp_mesh.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "log_binary.h"
+#include "log_core.h"
+#include "log_lz.h"
+#include "mesh_hdr.h"
 #include "mesh_proto.h"
+#include "mesh_tx.h"
 
 static const char *TAG = "mesh_log";
 
-typedef int (*vprintf_like_t)(const char *fmt, va_list ap);
-
-static vprintf_like_t	s_prev_vprintf = NULL;
-
 static bool		s_inited = false;
-static bool		s_stream_enabled = false;
-static bool		s_in_hook = false;
+static volatile bool	s_stream_enabled = false;
 
 static char		s_tag[16] = "node";
 
 static uint32_t		s_cnt = 0;
 
-#ifndef LOG_STREAM_STACK_TMP
-	#define LOG_STREAM_STACK_TMP	128
+// Компактні заголовки (MESH_LOG_TYPE_F_COMPACT): вмикає root прапорцем у CTRL
+static volatile bool	s_compact = false;
+static volatile bool	s_nodeinfo_pending = false;
+static uint16_t		s_node_id = 0;
+
+// Батч-режим (MESH_LOG_TYPE_BATCH): вмикає root прапорцем у CTRL
+static volatile bool	s_batch_mode = false;
+// Бінарний режим (MESH_LOG_TYPE_BIN): ID формату + сирі аргументи, завжди батчем
+static volatile bool	s_bin_mode = false;
+// Батч не може бути більшим за RX-буфер root'а, інакше esp_mesh_recv його відкине
+#if CONFIG_MESH_LOG_BATCH_MAX_BYTES > CONFIG_MESH_RX_BUF_SIZE
+#define BATCH_MAX_BYTES		CONFIG_MESH_RX_BUF_SIZE
+#else
+#define BATCH_MAX_BYTES		CONFIG_MESH_LOG_BATCH_MAX_BYTES
 #endif
-
-#ifndef LOG_STREAM_HEAP_MAX
-	#define LOG_STREAM_HEAP_MAX	256
+static uint8_t		s_batch_buf[BATCH_MAX_BYTES];
+static size_t		s_batch_len = 0;
+static TickType_t	s_batch_first = 0;
+
+// Стиснення data батчів (MESH_LOG_TYPE_F_LZ): вмикає root прапорцем у CTRL
+static volatile bool	s_lz = false;
+#if CONFIG_MESH_LOG_LZ
+static log_lz_state_t	s_lz_state;
+static uint8_t		s_lz_buf[BATCH_MAX_BYTES];
 #endif
 
-static void build_time_prefix(char *out, size_t out_sz)
+/*
+ * Фільтр з CTRL v2: рівень + allow/deny список тегів. Перевіряється в sink'у
+ * до копіювання/кодування строки; root бачить тільки те, що просив.
+ */
+typedef struct {
+	uint8_t		min_level;			// esp_log_level_t
+	uint8_t		tag_mode;			// MESH_LOG_TAGS_*
+	uint8_t		tag_count;
+	char		tags[MESH_LOG_CTRL_MAX_TAGS][16];
+	esp_log_level_t	saved[MESH_LOG_CTRL_MAX_TAGS];	// рівні до ALLOW (щоб повернути)
+	bool		raised[MESH_LOG_CTRL_MAX_TAGS];
+} log_filter_t;
+
+static log_filter_t	s_filter = { .min_level = ESP_LOG_VERBOSE };
+static portMUX_TYPE	s_filter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* -------------------------------------------------------------------------- */
+/*  Кільце відкладених строк (MPSC, без блокувань)                            */
+/* -------------------------------------------------------------------------- */
+/*
+ * Хук логів (будь-яка таска, будь-яке ядро) резервує слот атомарним CAS,
+ * рендерить строку прямо в нього і публікує через seq. Єдиний споживач —
+ * s_tx_task — забирає строки і шле їх через mesh_tx (клас LOG). Якщо кільце повне,
+ * строка рахується в dropped і хук одразу повертається (ніколи не чекає mesh).
+ * Схема — bounded queue Д. Вюкова.
+ */
+
+#define RING_SLOTS	CONFIG_MESH_LOG_RING_SLOTS
+#define RING_MASK	(RING_SLOTS - 1)
+#define RING_LINE_MAX	CONFIG_MESH_LOG_RING_LINE_MAX
+
+_Static_assert(sizeof(mesh_log_batch_packet_t) + 1 + RING_LINE_MAX <= BATCH_MAX_BYTES,
+	       "log batch: one ring line must fit (MESH_RX_BUF_SIZE too small)");
+
+_Static_assert((RING_SLOTS & RING_MASK) == 0, "MESH_LOG_RING_SLOTS must be a power of two");
+
+typedef struct {
+	atomic_uint	seq;
+	uint16_t	len;		// 0 => запис не вдався, пропускаємо
+	uint8_t		type;		// MESH_LOG_TYPE_LINE або MESH_LOG_TYPE_BIN
+	char		line[RING_LINE_MAX];
+} log_slot_t;
+
+static log_slot_t	s_ring[RING_SLOTS];
+static atomic_uint	s_ring_head;		// наступна позиція запису
+static atomic_uint	s_ring_tail;		// наступна позиція читання (пише тільки s_tx_task)
+
+static TaskHandle_t	s_tx_task = NULL;
+
+static mesh_log_stream_stats_t	s_stats;
+static portMUX_TYPE		s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define STAT_INC(field)	do {					\
+		portENTER_CRITICAL(&s_stats_lock);		\
+		s_stats.field++;				\
+		portEXIT_CRITICAL(&s_stats_lock);		\
+	} while (0)
+
+/*
+ * Обмеження швидкості: token bucket на ноду і окремо на кожен тег (ключ —
+ * вказівник на TAG, вони статичні). Токени — в тисячних частках строки.
+ * Що не влізло — не стрімиться (UART лишається), а s_tx_task раз на
+ * CONFIG_MESH_LOG_SUPPRESS_REPORT_MS шле підсумок "N lines suppressed".
+ */
+#define RL_TAGS		8
+#define RL_MILLI	1000
+
+typedef struct {
+	int64_t		tokens;
+	int64_t		last_us;	// 0 => бакет ще не використовувався (повний)
+} rl_bucket_t;
+
+typedef struct {
+	const char	*tag;
+	rl_bucket_t	b;
+	uint32_t	suppressed;	// з останнього підсумку
+} rl_tag_t;
+
+static rl_bucket_t	s_rl_node;
+static rl_tag_t		s_rl_tags[RL_TAGS];
+static uint32_t		s_rl_suppressed;	// з останнього підсумку
+static portMUX_TYPE	s_rl_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Дедуплікація однакових строк поспіль (тільки s_tx_task)
+static uint32_t		s_dup_key;
+static uint8_t		s_dup_type;
+static uint32_t		s_dup_repeats;
+
+static void ring_init(void)
 {
-	if (!out || out_sz == 0) return;
+	for (unsigned i = 0; i < RING_SLOTS; i++) {
+		atomic_init(&s_ring[i].seq, i);
+	}
+	atomic_init(&s_ring_head, 0);
+	atomic_init(&s_ring_tail, 0);
+}
 
-	time_t now = time(NULL);
-	if (now <= 0) {
-		snprintf(out, out_sz, "[no-time] ");
-		return;
+// NULL => кільце повне
+static log_slot_t *ring_reserve(void)
+{
+	unsigned pos = atomic_load_explicit(&s_ring_head, memory_order_relaxed);
+
+	for (;;) {
+		log_slot_t *slot = &s_ring[pos & RING_MASK];
+		unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		int diff = (int)(seq - pos);
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&s_ring_head, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed)) {
+				return slot;
+			}
+		} else if (diff < 0) {
+			return NULL;
+		} else {
+			pos = atomic_load_explicit(&s_ring_head, memory_order_relaxed);
+		}
 	}
+}
 
-	struct tm tm_now;
-	if (!localtime_r(&now, &tm_now)) {
-		snprintf(out, out_sz, "[no-time] ");
-		return;
+static void ring_commit(log_slot_t *slot)
+{
+	unsigned pos = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+// NULL => порожньо (або producer ще рендерить цей слот)
+static log_slot_t *ring_peek(void)
+{
+	unsigned tail = atomic_load_explicit(&s_ring_tail, memory_order_relaxed);
+	log_slot_t *slot = &s_ring[tail & RING_MASK];
+	unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+	return (seq == tail + 1) ? slot : NULL;
+}
+
+static void ring_release(log_slot_t *slot)
+{
+	unsigned tail = atomic_load_explicit(&s_ring_tail, memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, tail + RING_SLOTS, memory_order_release);
+	atomic_store_explicit(&s_ring_tail, tail + 1, memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Відправка                                                                 */
+/* -------------------------------------------------------------------------- */
+
+// Логи і NODEINFO — best-effort класи mesh_tx: чекають, поки в черзі вгору є місце
+static void send_to_root(mesh_tx_class_t cls, const void *buf, size_t len)
+{
+	mesh_addr_t dest;
+	memset(&dest, 0, sizeof(dest)); // root
+
+	// Логи з esp_mesh_send (якщо будуть) хук відкине: це s_tx_task
+	esp_err_t err = mesh_tx_send(cls, &dest, buf, len, 0);
+	if (err == ESP_OK) {
+		STAT_INC(sent_pkts);
+	} else {
+		STAT_INC(send_err);
+		mesh_tx_note_drop(cls);
 	}
+}
 
-	size_t n = strftime(out, out_sz, "[%Y-%m-%d %H:%M:%S] ", &tm_now);
-	if (n == 0) snprintf(out, out_sz, "[no-time] ");
+// node_id компактних лог-пакетів: виданий root'ом (mesh_hdr, унікальний у mesh),
+// а поки його нема (старий root, CONFIG_MESH_PROTO_V2 вимкнено) — молодші байти MAC.
+// Ці два простори можуть перетнутись; root приписує за адресою відправника.
+static uint16_t log_node_id(void)
+{
+	uint16_t id = mesh_hdr_node_id();
+	if (id != MESH_NODE_ID_NONE) return id;
+
+	uint8_t mac[6];
+	esp_wifi_get_mac(WIFI_IF_STA, mac);
+	return MESH_LOG_NODE_ID(mac);
 }
 
 static void send_nodeinfo_to_root(void)
@@ -63,135 +242,557 @@ static void send_nodeinfo_to_root(void)
 	mesh_nodeinfo_packet_t p;
 	memset(&p, 0, sizeof(p));
 
-	p.h.magic = MESH_PKT_MAGIC;
-	p.h.version = MESH_PKT_VERSION;
-	p.h.type = MESH_LOG_TYPE_NODEINFO;
-	p.h.counter = ++s_cnt;
-
-	esp_wifi_get_mac(WIFI_IF_STA, p.h.src_mac);
+	mesh_hdr_fill(&p.h, MESH_LOG_TYPE_NODEINFO, ++s_cnt);
 	strncpy(p.tag, s_tag, sizeof(p.tag) - 1);
+	p.node_id = log_node_id();
+	s_node_id = p.node_id;
 
-	mesh_data_t data;
-	memset(&data, 0, sizeof(data));
-	data.data = (uint8_t *)&p;
-	data.size = sizeof(p);
-	data.proto = MESH_PROTO_BIN;
-	data.tos = MESH_TOS_P2P;
-
-	mesh_addr_t dest;
-	memset(&dest, 0, sizeof(dest)); // root
+	send_to_root(MESH_TX_TELEMETRY, &p, sizeof(p));
+}
 
-	// НІЯКИХ ESP_LOG тут (щоб не рекурсія)
-	esp_mesh_send(&dest, &data, MESH_DATA_P2P, NULL, 0);
+static void compact_hdr_fill(mesh_log_compact_hdr_t *h, uint8_t type)
+{
+	// node_id змінився (видали / новий root): NODEINFO перед цим пакетом,
+	// щоб і розбір без адреси відправника (захоплення) знав новий id
+	if (log_node_id() != s_node_id) send_nodeinfo_to_root();
+
+	h->magic = MESH_PKT_MAGIC;
+	h->version = MESH_PKT_VERSION;
+	h->type = type | MESH_LOG_TYPE_F_COMPACT;
+	h->seq = (uint8_t)++s_cnt;
+	h->node_id = s_node_id;
 }
 
-static void send_logline_to_root(const char *line)
+static void send_logline_to_root(const char *line, size_t len)
 {
 	if (!line) return;
 
+	// line already includes time prefix (log_core)
+	if (s_compact) {
+		uint8_t buf[sizeof(mesh_log_line_c_packet_t) + RING_LINE_MAX];
+		mesh_log_line_c_packet_t *p = (mesh_log_line_c_packet_t *)buf;
+
+		if (len > RING_LINE_MAX) len = RING_LINE_MAX;
+		compact_hdr_fill(&p->h, MESH_LOG_TYPE_LINE);
+		memcpy(p->line, line, len);
+
+		send_to_root(MESH_TX_LOG, p, sizeof(*p) + len);
+		return;
+	}
+
 	mesh_log_line_packet_t p;
 	memset(&p, 0, sizeof(p));
 
-	p.h.magic = MESH_PKT_MAGIC;
-	p.h.version = MESH_PKT_VERSION;
-	p.h.type = MESH_LOG_TYPE_LINE;
-	p.h.counter = ++s_cnt;
-
-	esp_wifi_get_mac(WIFI_IF_STA, p.h.src_mac);
+	mesh_hdr_fill(&p.h, MESH_LOG_TYPE_LINE, ++s_cnt);
 	strncpy(p.tag, s_tag, sizeof(p.tag) - 1);
 
-	// line already includes time prefix we build here
-	strncpy(p.line, line, sizeof(p.line) - 1);
+	if (len > sizeof(p.line) - 1) len = sizeof(p.line) - 1;
+	memcpy(p.line, line, len);
 
-	mesh_data_t data;
-	memset(&data, 0, sizeof(data));
-	data.data = (uint8_t *)&p;
-	data.size = sizeof(p);
-	data.proto = MESH_PROTO_BIN;
-	data.tos = MESH_TOS_P2P;
+	// тільки використані байти (root доповнює '\0' сам)
+	send_to_root(MESH_TX_LOG, &p, offsetof(mesh_log_line_packet_t, line) + len);
+}
 
-	mesh_addr_t dest;
-	memset(&dest, 0, sizeof(dest)); // root
+/* -------------------------------------------------------------------------- */
+/*  Батч: багато строк в одному пакеті (тільки s_tx_task)                     */
+/* -------------------------------------------------------------------------- */
+/*
+ * s_batch_buf завжди починається з повного mesh_log_batch_packet_t; у
+ * компактному режимі при відправці короткий заголовок пишеться впритул перед
+ * data і пакет шлеться з нього.
+ */
+
+static void batch_reset(uint8_t type)
+{
+	mesh_log_batch_packet_t *p = (mesh_log_batch_packet_t *)s_batch_buf;
+	memset(p, 0, sizeof(*p));
 
-	esp_mesh_send(&dest, &data, MESH_DATA_P2P, NULL, 0);
+	mesh_hdr_fill(&p->h, type, 0);	// counter — при відправці
+	strncpy(p->tag, s_tag, sizeof(p->tag) - 1);
+
+	s_batch_len = sizeof(*p);
+}
+
+static bool batch_pending(void)
+{
+	return s_batch_len > 0 && ((mesh_log_batch_packet_t *)s_batch_buf)->count > 0;
+}
+
+static void batch_flush(void)
+{
+	if (!batch_pending()) return;
+
+	mesh_log_batch_packet_t *p = (mesh_log_batch_packet_t *)s_batch_buf;
+	uint8_t type = p->h.type;
+	uint8_t wire_type = type;
+
+#if CONFIG_MESH_LOG_LZ
+	// data стискаємо на місці; не вийшло коротше — шлемо як є
+	if (s_lz) {
+		size_t raw = s_batch_len - sizeof(*p);
+		size_t n = log_lz_compress(&s_lz_state, s_lz_buf, sizeof(s_lz_buf), p->data, raw);
+		if (n) {
+			memcpy(p->data, s_lz_buf, n);
+			s_batch_len = sizeof(*p) + n;
+			wire_type |= MESH_LOG_TYPE_F_LZ;
+
+			portENTER_CRITICAL(&s_stats_lock);
+			s_stats.lz_in += raw;
+			s_stats.lz_out += n;
+			portEXIT_CRITICAL(&s_stats_lock);
+		}
+	}
+#endif
+
+	if (s_compact) {
+		mesh_log_batch_c_packet_t *c = (mesh_log_batch_c_packet_t *)(p->data - sizeof(*c));
+		uint8_t count = p->count;
+
+		compact_hdr_fill(&c->h, wire_type);
+		c->count = count;
+		send_to_root(MESH_TX_LOG, c, s_batch_len - ((uint8_t *)c - s_batch_buf));
+	} else {
+		p->h.type = wire_type;
+		p->h.counter = ++s_cnt;
+		send_to_root(MESH_TX_LOG, s_batch_buf, s_batch_len);
+	}
+	batch_reset(type);
 }
 
-static int mesh_log_vprintf(const char *fmt, va_list ap)
+// type: MESH_LOG_TYPE_BATCH (текст) або MESH_LOG_TYPE_BIN; різні типи не змішуємо
+static void batch_add(uint8_t type, const char *line, size_t n)
 {
-	// 1) друк на UART через попередній sink
-	int ret = 0;
-	if (s_prev_vprintf) {
-		va_list ap_copy;
-		va_copy(ap_copy, ap);
-		ret = s_prev_vprintf(fmt, ap_copy);
-		va_end(ap_copy);
+	if (n > UINT8_MAX) n = UINT8_MAX;
+	if (n == 0) return;
+
+	mesh_log_batch_packet_t *p = (mesh_log_batch_packet_t *)s_batch_buf;
+	if (s_batch_len == 0) batch_reset(type);
+
+	if (p->h.type != type) {
+		batch_flush();
+		batch_reset(type);
+	}
+
+	if (s_batch_len + 1 + n > sizeof(s_batch_buf)) {
+		batch_flush();
+	}
+	// навіть у порожньому батчі строка не ширша за те, що лишилось після заголовка
+	if (s_batch_len + 1 + n > sizeof(s_batch_buf)) {
+		n = sizeof(s_batch_buf) - s_batch_len - 1;
+		STAT_INC(truncated);
 	}
 
-	// 2) якщо стрім вимкнений — все
-	if (!s_stream_enabled) return ret;
+	// перша строка в батчі => від неї рахуємо max delay
+	if (p->count == 0) s_batch_first = xTaskGetTickCount();
 
-	// 3) анти-рекурсія
-	if (s_in_hook) return ret;
-	s_in_hook = true;
+	s_batch_buf[s_batch_len++] = (uint8_t)n;
+	memcpy(&s_batch_buf[s_batch_len], line, n);
+	s_batch_len += n;
+	p->count++;
 
-	char tprefix[40];
-	build_time_prefix(tprefix, sizeof(tprefix));
+	if (p->count == UINT8_MAX) batch_flush();
+}
 
-	char stack_buf[LOG_STREAM_STACK_TMP];
-	size_t cap = sizeof(stack_buf);
+static uint32_t epoch_now(void)
+{
+	time_t now = time(NULL);
+	return ((int64_t)now >= 1577836800LL) ? (uint32_t)now : 0;	// 2020-01-01
+}
+
+// type: MESH_LOG_TYPE_LINE (текст) або MESH_LOG_TYPE_BIN
+static void tx_line(uint8_t type, const char *line, size_t len)
+{
+	if (type == MESH_LOG_TYPE_BIN) {
+		batch_add(MESH_LOG_TYPE_BIN, line, len);
+	} else if (s_batch_mode) {
+		batch_add(MESH_LOG_TYPE_BATCH, line, len);
+	} else {
+		if (batch_pending()) batch_flush();
+		send_logline_to_root(line, len);
+	}
+}
 
-	// prefix
-	size_t tlen = strnlen(tprefix, sizeof(tprefix));
-	size_t copy_t = (tlen < (cap - 1)) ? tlen : (cap - 1);
-	memcpy(stack_buf, tprefix, copy_t);
-	stack_buf[copy_t] = '\0';
+// Службова строка від самого стріму (підсумки) — у поточному форматі (текст/бінарний)
+static void tx_summary(const char *fmt, ...)
+{
+	char buf[RING_LINE_MAX];
+	size_t len;
+	uint8_t type;
+
+	va_list ap;
+	va_start(ap, fmt);
+	if (s_bin_mode) {
+		size_t cap = sizeof(buf) < UINT8_MAX ? sizeof(buf) : UINT8_MAX;
+		len = log_bin_encode((uint8_t *)buf, cap, epoch_now(), fmt, ap);
+		type = MESH_LOG_TYPE_BIN;
+	} else {
+		int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+		len = (n < 0) ? 0 : ((size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+		type = MESH_LOG_TYPE_LINE;
+	}
+	va_end(ap);
 
-	// message
-	va_list ap_copy2;
-	va_copy(ap_copy2, ap);
-	int w = vsnprintf(stack_buf + copy_t, cap - copy_t, fmt, ap_copy2);
-	va_end(ap_copy2);
+	if (len) tx_line(type, buf, len);
+}
 
-	if (w < 0) {
-		send_logline_to_root(stack_buf);
-		s_in_hook = false;
-		return ret;
+// FNV-1a
+static uint32_t hash_bytes(uint32_t h, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	for (size_t i = 0; i < len; i++) {
+		h = (h ^ p[i]) * 16777619u;
 	}
+	return h;
+}
+
+// Ключ строки без часу: текст — рівень + все після "I (123) [ts] ", бінарний — fmt_id + аргументи після timestamp
+static uint32_t line_key(uint8_t type, const char *line, size_t len)
+{
+	uint32_t h = 2166136261u;
 
-	if ((size_t)w < (cap - copy_t)) {
-		send_logline_to_root(stack_buf);
-		s_in_hook = false;
-		return ret;
+	if (type == MESH_LOG_TYPE_BIN) {
+		size_t off = log_bin_msg_offset((const uint8_t *)line, len);
+		if (!off) return hash_bytes(h, line, len);
+		h = hash_bytes(h, line, 4);
+		return hash_bytes(h, line + off, len - off);
 	}
 
-	// heap fallback (обрізаний)
-	size_t need = copy_t + (size_t)w + 1;
-	if (need > LOG_STREAM_HEAP_MAX) need = LOG_STREAM_HEAP_MAX;
+	const char *end = line + len;
+	const char *p = memchr(line, ')', len);
+	if (!p || p + 1 >= end || p[1] != ' ') return hash_bytes(h, line, len);
+	p += 2;
 
-	char *heap_buf = (char *)malloc(need);
-	if (!heap_buf) {
-		stack_buf[cap - 2] = '\n';
-		stack_buf[cap - 1] = '\0';
-		send_logline_to_root(stack_buf);
-		s_in_hook = false;
-		return ret;
+	if (p < end && *p == '[') {
+		const char *q = memchr(p, ']', (size_t)(end - p));
+		if (q && q + 1 < end && q[1] == ' ') p = q + 2;
 	}
 
-	memcpy(heap_buf, tprefix, copy_t);
-	heap_buf[copy_t] = '\0';
+	h = hash_bytes(h, line, 1);
+	return hash_bytes(h, p, (size_t)(end - p));
+}
+
+static void dedup_flush(void)
+{
+	if (s_dup_repeats == 0) return;
 
-	va_list ap_copy3;
-	va_copy(ap_copy3, ap);
-	vsnprintf(heap_buf + copy_t, need - copy_t, fmt, ap_copy3);
-	va_end(ap_copy3);
+	tx_summary(LOG_FORMAT(I, "last line repeated %" PRIu32 " times"),
+		esp_log_timestamp(), TAG, s_dup_repeats);
+	s_dup_repeats = 0;
+}
 
-	send_logline_to_root(heap_buf);
-	free(heap_buf);
+static void tx_line_dedup(uint8_t type, const char *line, size_t len)
+{
+#if CONFIG_MESH_LOG_DEDUP
+	uint32_t key = line_key(type, line, len);
+	if (key == s_dup_key && type == s_dup_type) {
+		s_dup_repeats++;
+		STAT_INC(deduped);
+		return;
+	}
 
-	s_in_hook = false;
-	return ret;
+	dedup_flush();
+	s_dup_key = key;
+	s_dup_type = type;
+#endif
+	tx_line(type, line, len);
 }
 
+static void rate_limit_report(void)
+{
+	uint32_t n = 0, top_n = 0;
+	const char *top = NULL;
+
+	portENTER_CRITICAL(&s_rl_lock);
+	n = s_rl_suppressed;
+	s_rl_suppressed = 0;
+	for (unsigned i = 0; i < RL_TAGS; i++) {
+		if (s_rl_tags[i].suppressed > top_n) {
+			top_n = s_rl_tags[i].suppressed;
+			top = s_rl_tags[i].tag;
+		}
+		s_rl_tags[i].suppressed = 0;
+	}
+	portEXIT_CRITICAL(&s_rl_lock);
+
+	if (n == 0) return;
+
+	dedup_flush();
+	tx_summary(LOG_FORMAT(W, "%" PRIu32 " lines suppressed by rate limit (top: %s x%" PRIu32 ")"),
+		esp_log_timestamp(), TAG, n, top ? top : "-", top_n);
+}
+
+static void mesh_log_tx_task(void *arg)
+{
+	(void)arg;
+
+	const TickType_t max_delay = pdMS_TO_TICKS(CONFIG_MESH_LOG_BATCH_MAX_DELAY_MS);
+	const TickType_t report_period = pdMS_TO_TICKS(CONFIG_MESH_LOG_SUPPRESS_REPORT_MS);
+	TickType_t last_report = xTaskGetTickCount();
+
+	while (true) {
+		TickType_t wait = portMAX_DELAY;
+		if (batch_pending()) {
+			TickType_t age = xTaskGetTickCount() - s_batch_first;
+			wait = (age >= max_delay) ? 0 : (max_delay - age);
+		}
+		if (s_stream_enabled && wait > report_period) {
+			wait = report_period;
+		}
+
+		ulTaskNotifyTake(pdTRUE, wait);
+
+		// root щойно ввімкнув компактні заголовки — спершу tag/node_id
+		if (s_nodeinfo_pending) {
+			s_nodeinfo_pending = false;
+			send_nodeinfo_to_root();
+		}
+
+		log_slot_t *slot;
+		while ((slot = ring_peek()) != NULL) {
+			if (!s_stream_enabled || slot->len == 0) {
+				// стрім вимкнули, поки строка чекала — викидаємо
+			} else {
+				tx_line_dedup(slot->type, slot->line, slot->len);
+			}
+			ring_release(slot);
+		}
+
+		if (s_stream_enabled && (xTaskGetTickCount() - last_report) >= report_period) {
+			last_report = xTaskGetTickCount();
+			dedup_flush();
+			rate_limit_report();
+		}
+
+		if (!s_stream_enabled || !(s_batch_mode || s_bin_mode)) {
+			// батч-режим вимкнули — накопичене ще шлемо; стрім вимкнули — рахуємо втрату
+			if (s_stream_enabled) {
+				batch_flush();
+			} else if (batch_pending()) {
+				portENTER_CRITICAL(&s_stats_lock);
+				s_stats.dropped += ((mesh_log_batch_packet_t *)s_batch_buf)->count;
+				portEXIT_CRITICAL(&s_stats_lock);
+			}
+			s_batch_len = 0;
+		} else if (batch_pending() && (xTaskGetTickCount() - s_batch_first) >= max_delay) {
+			batch_flush();
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Sink для log_core                                                         */
+/* -------------------------------------------------------------------------- */
+
+static esp_log_level_t level_from_char(char c)
+{
+	switch (c) {
+	case 'E': return ESP_LOG_ERROR;
+	case 'W': return ESP_LOG_WARN;
+	case 'I': return ESP_LOG_INFO;
+	case 'D': return ESP_LOG_DEBUG;
+	case 'V': return ESP_LOG_VERBOSE;
+	default:  return ESP_LOG_NONE;
+	}
+}
+
+// true => строку стрімимо. level == 0 / tag == NULL: це не рядок esp_log
+static bool filter_pass(char level, const char *tag)
+{
+	bool pass = true;
+
+	portENTER_CRITICAL(&s_filter_lock);
+	if (level && level_from_char(level) > s_filter.min_level) {
+		pass = false;
+	} else if (s_filter.tag_count) {
+		bool listed = false;
+		for (unsigned i = 0; tag && i < s_filter.tag_count; i++) {
+			if (strncmp(tag, s_filter.tags[i], sizeof(s_filter.tags[i])) == 0) {
+				listed = true;
+				break;
+			}
+		}
+		pass = (s_filter.tag_mode == MESH_LOG_TAGS_ALLOW) ? listed : !listed;
+	}
+	portEXIT_CRITICAL(&s_filter_lock);
+
+	if (!pass) STAT_INC(filtered);
+	return pass;
+}
+
+/*
+ * Застосувати фільтр з CTRL (v1 => без фільтра). ALLOW з детальнішим рівнем
+ * піднімає рівень esp_log для цих тегів (інакше строки навіть не дійдуть до
+ * хука); попередні рівні повертаються наступним CTRL.
+ */
+static void filter_apply(const mesh_log_ctrl_v2_packet_t *v2)
+{
+	log_filter_t f = { .min_level = ESP_LOG_VERBOSE };
+
+	if (v2) {
+		f.min_level = v2->min_level;
+		f.tag_mode = v2->tag_mode;
+		f.tag_count = v2->tag_count < MESH_LOG_CTRL_MAX_TAGS ? v2->tag_count : MESH_LOG_CTRL_MAX_TAGS;
+		for (unsigned i = 0; i < f.tag_count; i++) {
+			memcpy(f.tags[i], v2->tags[i], sizeof(f.tags[i]));
+			f.tags[i][sizeof(f.tags[i]) - 1] = '\0';
+		}
+	}
+
+	// esp_log_level_set не логує, але бере свій lock — поза нашою критичною секцією
+	for (unsigned i = 0; i < s_filter.tag_count; i++) {
+		if (s_filter.raised[i]) esp_log_level_set(s_filter.tags[i], s_filter.saved[i]);
+	}
+	if (f.tag_mode == MESH_LOG_TAGS_ALLOW) {
+		for (unsigned i = 0; i < f.tag_count; i++) {
+			f.saved[i] = esp_log_level_get(f.tags[i]);
+			if (f.min_level > f.saved[i]) {
+				esp_log_level_set(f.tags[i], (esp_log_level_t)f.min_level);
+				f.raised[i] = true;
+			}
+		}
+	}
+
+	portENTER_CRITICAL(&s_filter_lock);
+	s_filter = f;
+	portEXIT_CRITICAL(&s_filter_lock);
+}
+
+static void rl_refill(rl_bucket_t *b, int64_t now_us, uint32_t rate, uint32_t burst)
+{
+	int64_t cap = (int64_t)burst * RL_MILLI;
+
+	if (b->last_us == 0) {
+		b->tokens = cap;
+	} else {
+		// мкс * строк/с / 1000 = тисячні строки
+		b->tokens += (now_us - b->last_us) * (int64_t)rate / 1000;
+		if (b->tokens > cap) b->tokens = cap;
+	}
+	b->last_us = now_us;
+}
+
+// true => строку стрімимо
+static bool rate_limit_pass(const char *tag)
+{
+	int64_t now = esp_timer_get_time();
+	rl_tag_t *t = NULL;
+	bool pass;
+
+	portENTER_CRITICAL(&s_rl_lock);
+#if CONFIG_MESH_LOG_TAG_RATE_PER_SEC > 0
+	for (unsigned i = 0; tag && i < RL_TAGS; i++) {
+		if (s_rl_tags[i].tag == tag || !s_rl_tags[i].tag) {
+			t = &s_rl_tags[i];
+			t->tag = tag;
+			break;
+		}
+	}
+	// таблиця тегів повна => тільки бакет ноди
+#endif
+	rl_refill(&s_rl_node, now, CONFIG_MESH_LOG_RATE_LINES_PER_SEC, CONFIG_MESH_LOG_RATE_BURST);
+	if (t) rl_refill(&t->b, now, CONFIG_MESH_LOG_TAG_RATE_PER_SEC, 2 * CONFIG_MESH_LOG_TAG_RATE_PER_SEC);
+
+	// токени беремо тільки коли пускають обидва бакети — відкинута строка нічого не витрачає
+	bool tag_ok = !t || t->b.tokens >= RL_MILLI;
+	pass = tag_ok && s_rl_node.tokens >= RL_MILLI;
+	if (pass) {
+		s_rl_node.tokens -= RL_MILLI;
+		if (t) t->b.tokens -= RL_MILLI;
+	} else {
+		s_rl_suppressed++;
+		// тегу — тільки те, що зрізав його власний бакет
+		if (!tag_ok) t->suppressed++;
+	}
+	portEXIT_CRITICAL(&s_rl_lock);
+
+	if (!pass) STAT_INC(rate_limited);
+	return pass;
+}
+
+// NULL => стрім вимкнений, це sender-таска або кільце повне
+static log_slot_t *sink_slot_get(void)
+{
+	// 1) якщо стрім вимкнений — все
+	if (!s_stream_enabled || !s_tx_task) return NULL;
+
+	// 2) анти-рекурсія: власні логи sender-таски (з esp_mesh_send) не стрімимо
+	if (xTaskGetCurrentTaskHandle() == s_tx_task) return NULL;
+
+	log_slot_t *slot = ring_reserve();
+	if (!slot) {
+		STAT_INC(dropped);
+		mesh_tx_note_drop(MESH_TX_LOG);
+	}
+	return slot;
+}
+
+static void sink_slot_put(log_slot_t *slot)
+{
+	ring_commit(slot);
+	STAT_INC(captured);
+
+	unsigned depth = atomic_load_explicit(&s_ring_head, memory_order_relaxed) -
+			 atomic_load_explicit(&s_ring_tail, memory_order_relaxed);
+	portENTER_CRITICAL(&s_stats_lock);
+	if (depth > s_stats.ring_max) s_stats.ring_max = depth;
+	portEXIT_CRITICAL(&s_stats_lock);
+
+	xTaskNotifyGive(s_tx_task);
+}
+
+static void mesh_log_sink(void *ctx, const log_line_t *line)
+{
+	(void)ctx;
+
+	if (s_bin_mode || !s_stream_enabled) return;
+	if (!filter_pass(line->level, line->tag)) return;
+	if (!rate_limit_pass(line->tag)) return;
+
+	log_slot_t *slot = sink_slot_get();
+	if (!slot) return;
+
+	// строка вже відрендерена log_core (з часом) — тільки копія
+	size_t len = line->len;
+	if (len > sizeof(slot->line)) {
+		len = sizeof(slot->line);
+		slot->line[len - 1] = '\n';
+		memcpy(slot->line, line->text, len - 1);
+		STAT_INC(truncated);
+	} else {
+		memcpy(slot->line, line->text, len);
+	}
+	slot->len = (uint16_t)len;
+	slot->type = MESH_LOG_TYPE_LINE;
+
+	sink_slot_put(slot);
+}
+
+// Бінарний режим: без vsnprintf, тільки ID формату і сирі аргументи
+static void mesh_log_raw_sink(void *ctx, char level, const char *tag, const char *fmt, va_list ap)
+{
+	(void)ctx;
+
+	if (!s_bin_mode || !s_stream_enabled) return;
+	if (!filter_pass(level, tag)) return;
+	if (!rate_limit_pass(tag)) return;
+
+	log_slot_t *slot = sink_slot_get();
+	if (!slot) return;
+
+	size_t cap = sizeof(slot->line) < UINT8_MAX ? sizeof(slot->line) : UINT8_MAX;
+	size_t len = log_bin_encode((uint8_t *)slot->line, cap, epoch_now(), fmt, ap);
+	if (len == 0) STAT_INC(truncated);
+
+	slot->len = (uint16_t)len;
+	slot->type = MESH_LOG_TYPE_BIN;
+
+	sink_slot_put(slot);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Публічні функції                                                          */
+/* -------------------------------------------------------------------------- */
+
 void mesh_log_stream_init(const char *tag)
 {
 	if (s_inited) return;
@@ -202,8 +803,17 @@ void mesh_log_stream_init(const char *tag)
 		s_tag[sizeof(s_tag) - 1] = '\0';
 	}
 
-	s_prev_vprintf = (vprintf_like_t)esp_log_set_vprintf(&mesh_log_vprintf);
-	ESP_LOGI(TAG, "mesh log stream inited (waiting CTRL)");
+	ring_init();
+	if (xTaskCreate(mesh_log_tx_task, "mesh_log_tx", 4096, NULL, 3, &s_tx_task) != pdPASS) {
+		// без sender-таски стрім просто не працює, UART лишається
+		s_tx_task = NULL;
+	}
+
+	log_core_start();
+	log_core_add_sink(mesh_log_sink, NULL);
+	log_core_add_raw_sink(mesh_log_raw_sink, NULL);
+	ESP_LOGI(TAG, "mesh log stream inited (waiting CTRL), ring %d x %d bytes",
+		RING_SLOTS, RING_LINE_MAX);
 }
 
 void mesh_log_stream_on_mesh_connected(void)
@@ -227,8 +837,98 @@ esp_err_t mesh_log_stream_handle_rx(const void *pkt_buf, size_t pkt_len)
 		return ESP_ERR_INVALID_ARG;
 	}
 
+	const mesh_log_ctrl_v2_packet_t *v2 = NULL;
+	if ((p->flags & MESH_LOG_CTRL_F_FILTER) && pkt_len >= sizeof(mesh_log_ctrl_v2_packet_t)) {
+		v2 = (const mesh_log_ctrl_v2_packet_t *)pkt_buf;
+	}
+	filter_apply(v2);
+
+	s_batch_mode = (p->enable != 0) && (p->flags & MESH_LOG_CTRL_F_BATCH);
+	s_bin_mode = (p->enable != 0) && (p->flags & MESH_LOG_CTRL_F_BINARY);
 	s_stream_enabled = (p->enable != 0);
 
+#if CONFIG_MESH_LOG_LZ
+	s_lz = (p->enable != 0) && (p->flags & MESH_LOG_CTRL_F_LZ);
+#endif
+
+	bool compact = (p->enable != 0) && (p->flags & MESH_LOG_CTRL_F_COMPACT);
+	if (compact && !s_compact) s_nodeinfo_pending = true;
+	s_compact = compact;
+
+	// розбудити sender, щоб він скинув/відправив незавершений батч
+	if (s_tx_task) xTaskNotifyGive(s_tx_task);
+
 	// НЕ логуй тут — це приходить через vprintf і може бути рекурсія
 	return ESP_OK;
 }
+
+void mesh_log_stream_get_stats(mesh_log_stream_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_stats_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Root: node_id -> MAC з NODEINFO (колізії node_id компактних пакетів)      */
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+	bool		used;
+	uint16_t	node_id;
+	uint8_t		mac[6];
+} node_entry_t;
+
+static node_entry_t	s_nodes[CONFIG_MESH_ROUTE_TABLE_SIZE];
+static portMUX_TYPE	s_nodes_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t mesh_log_nodeinfo_rx(const uint8_t from_mac[6], const void *pkt_buf, size_t pkt_len)
+{
+	const mesh_nodeinfo_packet_t *p = (const mesh_nodeinfo_packet_t *)pkt_buf;
+
+	if (!pkt_buf || pkt_len < offsetof(mesh_nodeinfo_packet_t, node_id)) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+	if (p->h.type != MESH_LOG_TYPE_NODEINFO) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	// from від esp_mesh_recv — справжнє джерело; src_mac — лише якщо його нема
+	const uint8_t *mac = from_mac ? from_mac : p->h.src_mac;
+
+	// стара нода шле NODEINFO без node_id — тоді він з MAC
+	uint16_t id = pkt_len >= sizeof(*p) ? p->node_id : MESH_LOG_NODE_ID(mac);
+
+	bool collision = false;
+	portENTER_CRITICAL(&s_nodes_lock);
+	node_entry_t *e = NULL;
+	node_entry_t *free_e = NULL;
+	for (unsigned i = 0; i < CONFIG_MESH_ROUTE_TABLE_SIZE; i++) {
+		if (!s_nodes[i].used) {
+			if (!free_e) free_e = &s_nodes[i];
+			continue;
+		}
+		if (memcmp(s_nodes[i].mac, mac, 6) == 0) {
+			e = &s_nodes[i];
+		} else if (s_nodes[i].node_id == id) {
+			collision = true;
+		}
+	}
+	if (!e) e = free_e;
+	if (e) {
+		e->used = true;
+		e->node_id = id;
+		memcpy(e->mac, mac, 6);
+	}
+	portEXIT_CRITICAL(&s_nodes_lock);
+
+	if (collision) {
+		// без адреси відправника (захоплення, kpl_log_decode) ці ноди не розрізнити
+		STAT_INC(id_collisions);
+		ESP_LOGW(TAG, "node_id %04x collision: " MACSTR " (%.16s)", id, MAC2STR(mac), p->tag);
+	}
+
+	return e ? ESP_OK : ESP_ERR_NO_MEM;
+}
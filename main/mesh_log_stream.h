@@ -1,20 +1,46 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Викликати 1 раз на старті (після log_time_vprintf_start())
+typedef struct {
+	uint32_t	captured;	// строк покладено в кільце
+	uint32_t	dropped;	// кільце повне => строку викинуто (хук не чекає); недосланий батч при вимкненні стріму
+	uint32_t	truncated;	// строка довша за слот (або бінарний запис не вліз)
+	uint32_t	ring_max;	// максимальна заповненість кільця
+	uint32_t	sent_pkts;	// успішних esp_mesh_send
+	uint32_t	send_err;
+	uint32_t	filtered;	// відкинуто фільтром рівня/тегів (CTRL v2)
+	uint32_t	rate_limited;	// не влізло в token bucket ноди/тегу
+	uint32_t	deduped;	// однакові строки поспіль, згорнуті в "repeated N times"
+	uint32_t	lz_in;		// байт data батчів до стиснення (MESH_LOG_TYPE_F_LZ)
+	uint32_t	lz_out;		// ... після (нестисливі фрейми йдуть як є і сюди не входять)
+	uint32_t	id_collisions;	// root: NODEINFO з node_id, який уже має інша нода
+} mesh_log_stream_stats_t;
+
+// Викликати 1 раз на старті (після log_time_vprintf_start()), реєструє sink у log_core
 void mesh_log_stream_init(const char *tag);
 
 // Викликати коли нода реально підключилась до mesh (PARENT_CONNECTED)
 void mesh_log_stream_on_mesh_connected(void);
 
 // Викликати з mesh_rx_task() коли прийшов пакет типу MESH_LOG_TYPE_CTRL
+// (mesh_log_ctrl_packet_t або mesh_log_ctrl_v2_packet_t з MESH_LOG_CTRL_F_FILTER)
 esp_err_t mesh_log_stream_handle_rx(const void *pkt_buf, size_t pkt_len);
 
+void mesh_log_stream_get_stats(mesh_log_stream_stats_t *out);
+
+// Для root: node_id/MAC з MESH_LOG_TYPE_NODEINFO — рахує колізії node_id (id_collisions).
+// from_mac — адреса відправника з esp_mesh_recv (NULL — брати h.src_mac).
+// Лог-пакети (LINE/BATCH/BIN, компактні) root не розбирає: це робить host
+// (host_sim/log_decode.c) за адресою відправника або NODEINFO.
+esp_err_t mesh_log_nodeinfo_rx(const uint8_t from_mac[6], const void *pkt_buf, size_t pkt_len);
+
 #ifdef __cplusplus
 }
 #endif
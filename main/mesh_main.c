@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <inttypes.h>
@@ -12,6 +13,7 @@
 #include "esp_mesh.h"
 #include "esp_mesh_internal.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "legacy_proto.h"
@@ -19,15 +21,18 @@
 #include "legacy_root_sender.h"
 #include "powled_node.h"
 #include "log_time_vprintf.h"
+#include "log_ram_sink.h"
 #include "mesh_proto.h"
 #include "mesh_time_sync.h"
 #include "mesh_log_stream.h"
+#include "mesh_rx.h"
+#include "mesh_cmd.h"
+#include "mesh_hdr.h"
 
 /* -------------------------------------------------------------------------- */
 /*  Константи / глобальні змінні                                              */
 /* -------------------------------------------------------------------------- */
 
-#define RX_SIZE          (256)
 #define TX_INTERVAL_MS   (5000)
 
 static const char *MESH_TAG = "kPowerLed";
@@ -50,10 +55,13 @@ static esp_netif_t *netif_sta       = NULL;
  *  magic    - 0xA5 (для перевірки, що це "наш" пакет)
  *  version  - версія протоколу (1)
  *  type     - тип (1 = просто текстове "Hello N")
- *  reserved - вирівнювання, запас
+ *  max_version - найвища версія протоколу відправника (0 у старих нод)
  *  counter  - лічильник пакета від цієї ноди
  *  src_mac  - MAC відправника
  *  payload  - невеликий текст (рядок з '\0' в кінці)
+ *
+ * Між нодами з v2 на дроті замість цього заголовка компактний (mesh_proto.h,
+ * mesh_hdr.c); хендлери все одно бачать цей.
  */
 
 /* -------------------------------------------------------------------------- */
@@ -73,79 +81,150 @@ static esp_err_t mesh_comm_start(void);
 /*  RX task – слухаємо пакети від інших нод                                   */
 /* -------------------------------------------------------------------------- */
 
-static void mesh_rx_task(void *arg)
+static esp_err_t rx_handle_time(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
 {
-	uint8_t		rx_buf[256];
+	(void)from;
+	return mesh_time_sync_handle_rx(pkt_buf, pkt_len);
+}
 
-	mesh_data_t	data = {
-		.data	= rx_buf,
-		.size	= sizeof(rx_buf),
-	};
+static esp_err_t rx_handle_time_req(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	return mesh_time_sync_handle_req(from, pkt_buf, pkt_len);
+}
 
-	mesh_addr_t	from;
-	int		flag = 0;
-	esp_err_t	err;
+static esp_err_t rx_handle_log_ctrl(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	(void)from;
+	return mesh_log_stream_handle_rx(pkt_buf, pkt_len);
+}
 
-	while (is_running) {
-		data.size = sizeof(rx_buf);
+// root: node_id -> тег для компактних лог-пакетів
+static esp_err_t rx_handle_nodeinfo(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	return mesh_log_nodeinfo_rx(from ? from->addr : NULL, pkt_buf, pkt_len);
+}
 
-		err = esp_mesh_recv(&from, &data, portMAX_DELAY, &flag, NULL, 0);
-		if (err != ESP_OK) {
-			ESP_LOGE(MESH_TAG, "esp_mesh_recv failed: 0x%x (%s)", err, esp_err_to_name(err));
-			continue;
-		}
+static void handle_text(const mesh_addr_t *from, const uint8_t *src_mac, const char *payload)
+{
+	ESP_LOGI(MESH_TAG, "RX TEXT from " MACSTR " (src=" MACSTR "): \"%s\"",
+		MAC2STR(from->addr),
+		MAC2STR(src_mac),
+		payload
+	);
+
+	// <-- ОЦЕ МІСЦЕ: якщо в тебе не legacy_handle_text(), заміни на свій handler
+	legacy_handle_text(payload);
+}
 
-		if (data.size < sizeof(mesh_pkt_hdr_t)) {
-			ESP_LOGW(MESH_TAG, "RX too short: %d bytes", (int)data.size);
-			continue;
-		}
+static esp_err_t rx_handle_text(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	const mesh_packet_t *p = (const mesh_packet_t *)pkt_buf;
 
-		const mesh_pkt_hdr_t *h = (const mesh_pkt_hdr_t *)rx_buf;
+	// гарантуємо '\0'
+	char payload[sizeof(p->payload)];
+	memcpy(payload, p->payload, sizeof(payload));
+	payload[sizeof(payload) - 1] = '\0';
 
-		// не наш протокол? ігноруємо
-		if (h->magic != MESH_PKT_MAGIC || h->version != MESH_PKT_VERSION) {
-			ESP_LOGW(MESH_TAG, "RX unknown packet from " MACSTR " (%d bytes)", MAC2STR(from.addr), (int)data.size);
-			continue;
-		}
+	handle_text(from, p->src_mac, payload);
+	return ESP_OK;
+}
 
-		// диспетчер типів
-		if (h->type == MESH_TIME_SYNC_TYPE_TIME) {
-			mesh_time_sync_handle_rx(rx_buf, data.size);
-			continue;
-		}
+// Кожен текст з батча — як окремий TEXT
+static esp_err_t rx_handle_text_batch(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	const mesh_text_batch_packet_t *p   = (const mesh_text_batch_packet_t *)pkt_buf;
+	const uint8_t                  *d   = p->data;
+	const uint8_t                  *end = (const uint8_t *)pkt_buf + pkt_len;
 
-		if (h->type == MESH_LOG_TYPE_CTRL) {
-			mesh_log_stream_handle_rx(rx_buf, data.size);
-			continue;
+	for (uint8_t i = 0; i < p->count; i++) {
+		if (d >= end || d[0] > end - d - 1) {
+			return ESP_ERR_INVALID_SIZE;
 		}
 
-		if (h->type == MESH_PKT_TYPE_TEXT) {
-			if (data.size < sizeof(mesh_packet_t)) {
-				ESP_LOGW(MESH_TAG, "RX TEXT short: %d bytes", (int)data.size);
-				continue;
-			}
+		char   payload[sizeof(((mesh_packet_t *)0)->payload)];
+		size_t len = d[0] < sizeof(payload) ? d[0] : sizeof(payload) - 1;
+		memcpy(payload, d + 1, len);
+		payload[len] = '\0';
+
+		handle_text(from, p->h.src_mac, payload);
+		d += 1 + d[0];
+	}
+	return ESP_OK;
+}
 
-			const mesh_packet_t *p = (const mesh_packet_t *)rx_buf;
+static esp_err_t rx_handle_powled_at(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	(void)from;
+	(void)pkt_len;
+	const mesh_powled_at_packet_t *p = (const mesh_powled_at_packet_t *)pkt_buf;
 
-			// гарантуємо '\0'
-			char payload[sizeof(p->payload)];
-			memcpy(payload, p->payload, sizeof(payload));
-			payload[sizeof(payload) - 1] = '\0';
+	powled_node_cmd_at(UINT32_MAX, p->state ? UINT32_MAX : 0, 255, 0, p->at_us);
+	return ESP_OK;
+}
 
-			ESP_LOGI(MESH_TAG, "RX TEXT from " MACSTR " (src=" MACSTR "): \"%s\"",
-				MAC2STR(from.addr),
-				MAC2STR(p->src_mac),
-				payload
-			);
+static esp_err_t rx_handle_cmd(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	return mesh_cmd_handle_rx(from, pkt_buf, pkt_len);
+}
 
-			// <-- ОЦЕ МІСЦЕ: якщо в тебе не legacy_handle_text(), заміни на свій handler
-			legacy_handle_text(payload);
+static esp_err_t rx_handle_cmd_ack(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	return mesh_cmd_handle_ack(from, pkt_buf, pkt_len);
+}
+
+static void mesh_rx_register_handlers(void)
+{
+	mesh_rx_register(MESH_PKT_TYPE_TEXT,		sizeof(mesh_packet_t),		rx_handle_text);
+	mesh_rx_register(MESH_PKT_TYPE_TEXT_BATCH,	sizeof(mesh_text_batch_packet_t), rx_handle_text_batch);
+	mesh_rx_register(MESH_TIME_SYNC_TYPE_TIME,	sizeof(mesh_pkt_hdr_t),		rx_handle_time);
+	mesh_rx_register(MESH_TIME_SYNC_TYPE_REQ,	sizeof(mesh_time_req_packet_t),	rx_handle_time_req);
+	mesh_rx_register(MESH_TIME_SYNC_TYPE_RESP,	sizeof(mesh_time_resp_packet_t), rx_handle_time);
+	mesh_rx_register(MESH_PKT_TYPE_POWLED_AT,	sizeof(mesh_powled_at_packet_t), rx_handle_powled_at);
+	mesh_rx_register(MESH_PKT_TYPE_CMD,		sizeof(mesh_cmd_packet_t),	rx_handle_cmd);
+	mesh_rx_register(MESH_PKT_TYPE_CMD_ACK,		sizeof(mesh_cmd_ack_packet_t),	rx_handle_cmd_ack);
+	mesh_rx_register(MESH_LOG_TYPE_CTRL,		sizeof(mesh_log_ctrl_packet_t),	rx_handle_log_ctrl);
+	mesh_rx_register(MESH_LOG_TYPE_NODEINFO,	offsetof(mesh_nodeinfo_packet_t, node_id), rx_handle_nodeinfo);
+#if CONFIG_MESH_PROTO_V2
+	mesh_rx_register(MESH_PKT_TYPE_NODE_ID,		sizeof(mesh_node_id_packet_t),	mesh_hdr_handle_node_id);
+#endif
+}
+
+/*
+ * mesh_rx_task тільки приймає: пакет іде в буфер пулу і вказівником передається
+ * воркеру (mesh_rx.c), тож повільний хендлер (лог, settimeofday) не тримає
+ * esp_mesh_recv. Якщо пул вичерпано — приймаємо в scratch і викидаємо.
+ */
+static void mesh_rx_task(void *arg)
+{
+	static uint8_t	scratch[CONFIG_MESH_RX_BUF_SIZE];
+
+	mesh_data_t	data;
+	int		flag = 0;
+	esp_err_t	err;
+
+	while (is_running) {
+		mesh_rx_buf_t	*b = mesh_rx_buf_alloc();
+		mesh_addr_t	from;
+
+		data.data = b ? b->data : scratch;
+		data.size = b ? sizeof(b->data) : sizeof(scratch);
+
+		err = esp_mesh_recv(b ? &b->from : &from, &data, portMAX_DELAY, &flag, NULL, 0);
+		if (err != ESP_OK) {
+			ESP_LOGE(MESH_TAG, "esp_mesh_recv failed: 0x%x (%s)", err, esp_err_to_name(err));
+			mesh_rx_buf_free(b);
+			continue;
+		}
 
+		if (!b) {
+			mesh_rx_note_dropped();
 			continue;
 		}
 
-		ESP_LOGI(MESH_TAG, "RX type=%u from " MACSTR " (%d bytes)",
-			(unsigned)h->type, MAC2STR(from.addr), (int)data.size);
+		b->rx_us = esp_timer_get_time();
+		b->flag = flag;
+		b->len = data.size;
+		mesh_rx_submit(b);
 	}
 
 	vTaskDelete(NULL);
@@ -161,6 +240,9 @@ static esp_err_t mesh_comm_start(void)
 
 	if (!started) {
 		started = true;
+		mesh_rx_register_handlers();
+		// без пулу жоден пакет не дійде до хендлерів — краще перезавантажитись
+		ESP_ERROR_CHECK(mesh_rx_pool_start(5));
 		xTaskCreate(mesh_rx_task, "mesh_rx", 4096, NULL, 5, NULL);
         stack_monitor_start(3);
 		legacy_root_sender_start(5);
@@ -302,6 +384,8 @@ static void mesh_event_handler(void *arg,
 		ESP_LOGI(MESH_TAG,
 		         "<MESH_EVENT_ROOT_ADDRESS> root:" MACSTR,
 		         MAC2STR(ra->addr));
+		mesh_hdr_set_root(ra->addr);
+		mesh_cmd_root_changed();
 	}
 	break;
 
@@ -407,5 +491,6 @@ void app_main(void)
 			 
 	mesh_time_sync_init();
 	log_time_vprintf_start();
+	log_ram_sink_start();
 	mesh_log_stream_init(MESH_TAG);
 }
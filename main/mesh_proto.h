@@ -7,7 +7,10 @@ extern "C" {
 #endif
 
 #define MESH_PKT_MAGIC			0xA5
-#define MESH_PKT_VERSION		1
+#define MESH_PKT_VERSION		1	// mesh_pkt_hdr_t: так пакети бачать хендлери
+
+// Найвища версія, яку розуміє відправник: mesh_pkt_hdr_t.max_version (старі ноди — 0)
+#define MESH_PKT_VERSION_MAX		2
 
 // Уже було
 #define MESH_PKT_TYPE_TEXT		1
@@ -15,51 +18,267 @@ extern "C" {
 // Уже використовується твоїм mesh_time_sync.c
 #define MESH_TIME_SYNC_TYPE_TIME	2
 
+// NTP-подібний обмін (mesh_time_sync.c): нода -> root REQ, root -> нода RESP
+#define MESH_TIME_SYNC_TYPE_REQ		8
+#define MESH_TIME_SYNC_TYPE_RESP	9
+
+// Перемикання powled у заданий момент (root -> node), mesh_powled_at_packet_t
+#define MESH_PKT_TYPE_POWLED_AT		10
+
+// Бінарні команди (mesh_cmd.c): root -> node CMD, node -> root CMD_ACK
+#define MESH_PKT_TYPE_CMD		11
+#define MESH_PKT_TYPE_CMD_ACK		12
+
+// Кілька legacy-текстів в одному пакеті (legacy_root_sender, node -> root)
+#define MESH_PKT_TYPE_TEXT_BATCH	13
+
+// Короткий ID ноди для заголовка v2 (mesh_hdr.c): root -> node, mesh_node_id_packet_t
+#define MESH_PKT_TYPE_NODE_ID		14
+
 // Нове для веб-логів
 #define MESH_LOG_TYPE_LINE		3
 #define MESH_LOG_TYPE_NODEINFO		4
 #define MESH_LOG_TYPE_CTRL		5
+#define MESH_LOG_TYPE_BATCH		6
+#define MESH_LOG_TYPE_BIN		7
+
+// type | MESH_LOG_TYPE_F_COMPACT => короткий заголовок mesh_log_compact_hdr_t замість
+// mesh_pkt_hdr_t + tag (LINE, BATCH, BIN). Тег і MAC — з NODEINFO по node_id (або за
+// адресою відправника).
+#define MESH_LOG_TYPE_F_COMPACT		0x80
+
+// type | MESH_LOG_TYPE_F_LZ => data у BATCH/BIN стиснута log_lz (count — як і був)
+#define MESH_LOG_TYPE_F_LZ		0x40
+
+// Короткий ID ноди для компактних лог-пакетів, поки root не видав node_id
+// (MESH_PKT_TYPE_NODE_ID): молодші 2 байти MAC, можуть збігтися
+#define MESH_LOG_NODE_ID(mac)		((uint16_t)(((mac)[4] << 8) | (mac)[5]))
 
 typedef struct __attribute__((packed)) {
 	uint8_t		magic;
 	uint8_t		version;
 	uint8_t		type;
-	uint8_t		reserved;
+	uint8_t		max_version;		// MESH_PKT_VERSION_MAX відправника (був reserved, 0)
 	uint32_t	counter;
 	uint8_t		src_mac[6];
 } mesh_pkt_hdr_t;
 
+/*
+ * Заголовок v2 — замість mesh_pkt_hdr_t (14 байт) між нодами, які обидві
+ * його розуміють (mesh_hdr.c). Тіло пакета те саме, що після mesh_pkt_hdr_t:
+ *
+ *	1	MESH_PKT_V2_MARK | MESH_PKT_V2_F_*	(v1 має тут 0xA5 — старі ноди
+ *						 відкидають v2 як bad_magic)
+ *	1	type					як у v1
+ *	2	node_id відправника, LE			виданий root'ом; root — 0
+ *	1..2	seq, varint				молодші 14 біт counter
+ *	...	тіло
+ *	2	CRC-16, LE (esp_rom_crc16_le)		з MESH_PKT_V2_F_CRC, по всьому,
+ *						 що перед ним
+ *
+ * 5..6 байт на заголовок (7..8 з CRC) замість 14. mesh_rx розгортає v2 назад
+ * у mesh_pkt_hdr_t до хендлерів: src_mac — адреса з esp_mesh_recv (у esp-mesh
+ * це вихідний відправник), counter — seq.
+ */
+#define MESH_PKT_V2_MARK		0xB0
+#define MESH_PKT_V2_MARK_MASK		0xF0
+#define MESH_PKT_V2_F_CRC		0x01
+#define MESH_PKT_V2_SEQ_MASK		0x3FFF
+#define MESH_PKT_V2_HDR_MIN		5
+#define MESH_PKT_V2_HDR_MAX		6
+#define MESH_PKT_V2_CRC_LEN		2
+
+#define MESH_NODE_ID_ROOT		0
+#define MESH_NODE_ID_NONE		0xFFFF	// root ще не видав
+
 // Твій старий текстовий пакет (залишаємо)
 typedef struct __attribute__((packed)) {
 	uint8_t		magic;
 	uint8_t		version;
 	uint8_t		type;
-	uint8_t		reserved;
+	uint8_t		max_version;
 	uint32_t	counter;
 	uint8_t		src_mac[6];
 	char		payload[32];
 } mesh_packet_t;
 
+// MESH_TIME_SYNC_TYPE_TIME; розмір як у mesh_packet_t — старі ноди перевіряють sizeof
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint8_t		payload[32];		// mesh_time_sync.c: mesh_time_payload_t
+} mesh_time_packet_t;
+
+// Root видає ноді node_id у відповідь на v1-пакет з max_version >= 2; нода
+// відтоді шле root'у з заголовком v2
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint16_t	node_id;
+	uint8_t		version;		// якою root шле цій ноді (2)
+	uint8_t		rsv;
+} mesh_node_id_packet_t;
+
 // Анонс "яка це нода" => tag
 typedef struct __attribute__((packed)) {
 	mesh_pkt_hdr_t	h;
 	char		tag[16];		// MESH_TAG (обрізаємо якщо довше)
+	uint16_t	node_id;		// як у компактних пакетах; старий root сюди не дивиться
 } mesh_nodeinfo_packet_t;
 
-// Одна строка лога
+// Одна строка лога. Шлемо тільки використані байти line (без '\0');
+// root приймає і старий фіксований розмір (sizeof), і коротший.
 typedef struct __attribute__((packed)) {
 	mesh_pkt_hdr_t	h;
 	char		tag[16];		// MESH_TAG
 	char		line[192];		// сама строка (з '\n' або без — root нормалізує)
 } mesh_log_line_packet_t;
 
+// Компактний заголовок лог-пакетів (type з MESH_LOG_TYPE_F_COMPACT)
+typedef struct __attribute__((packed)) {
+	uint8_t		magic;
+	uint8_t		version;
+	uint8_t		type;
+	uint8_t		seq;			// лічильник пакетів mod 256
+	uint16_t	node_id;		// виданий root'ом, інакше MESH_LOG_NODE_ID
+} mesh_log_compact_hdr_t;
+
+// MESH_LOG_TYPE_LINE | F_COMPACT: строка до кінця пакета
+typedef struct __attribute__((packed)) {
+	mesh_log_compact_hdr_t	h;
+	char			line[];
+} mesh_log_line_c_packet_t;
+
+// MESH_LOG_TYPE_BATCH/BIN | F_COMPACT: data як у mesh_log_batch_packet_t
+typedef struct __attribute__((packed)) {
+	mesh_log_compact_hdr_t	h;
+	uint8_t			count;
+	uint8_t			data[];
+} mesh_log_batch_c_packet_t;
+
+// Час — epoch у мкс (gettimeofday). t1: нода відправила REQ, t2: root прийняв,
+// t3: root відправив RESP, t4: нода прийняла. offset = ((t2 - t1) + (t3 - t4)) / 2,
+// delay = (t4 - t1) - (t3 - t2).
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint32_t	seq;
+	int64_t		t1_us;
+	int32_t		last_offset_us;		// результат попередньої синхронізації (для статистики root)
+	uint32_t	last_delay_us;
+} mesh_time_req_packet_t;
+
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint32_t	seq;			// з REQ
+	int64_t		t1_us;			// з REQ
+	int64_t		t2_us;
+	int64_t		t3_us;
+} mesh_time_resp_packet_t;
+
+// at_us — epoch у мкс за синхронізованим годинником (mesh_time_sync). Root ставить
+// now + запас на доставку найдальшій ноді; всі ноди перемикаються в один момент.
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint8_t		state;			// 0/1, як powled0/powled1 (всі канали)
+	uint8_t		rsv[3];
+	int64_t		at_us;
+} mesh_powled_at_packet_t;
+
+// Команда на вихід ноди. Замість "powled0"/"powled1" у mesh_packet_t — 19 байт
+// (27 з at_us), без розбору строк.
+#define MESH_CMD_CH_POWLED		0
+
+#define MESH_CMD_F_ACK			0x01	// відповісти CMD_ACK відправнику
+#define MESH_CMD_F_AT			0x02	// далі int64 at_us (mesh_cmd_at_packet_t)
+#define MESH_CMD_F_MASK			0x04	// channel — маска каналів, level — маска увімкнених
+#define MESH_CMD_F_FADE			0x08	// далі uint16 fade_ms (після at_us, якщо є): перехід LEDC
+#define MESH_CMD_F_TRACE		0x10	// далі int64 t_root_us (останнім): ACK з mesh_cmd_ack_trace_packet_t
+
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint16_t	seq;
+	uint8_t		channel;		// MESH_CMD_CH_* (з MESH_CMD_F_MASK: біт n — канал n)
+	uint8_t		level;			// 0 — вимк., 1..255 — увімк./яскравість (з MESH_CMD_F_MASK: біт n — увімк.)
+	uint8_t		flags;			// MESH_CMD_F_*
+} mesh_cmd_packet_t;
+
+typedef struct __attribute__((packed)) {
+	mesh_cmd_packet_t c;
+	int64_t		at_us;			// як у mesh_powled_at_packet_t
+} mesh_cmd_at_packet_t;
+
+#define MESH_CMD_ST_OK			0	// виконано
+#define MESH_CMD_ST_SCHEDULED		1	// MESH_CMD_F_AT: заряджено на at_us
+#define MESH_CMD_ST_BAD_CHANNEL		2
+#define MESH_CMD_ST_BAD_LEN		3
+
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint16_t	seq;			// з CMD
+	uint8_t		channel;
+	uint8_t		status;			// MESH_CMD_ST_*
+	uint32_t	node_us;		// нода: від прийому (mesh_rx) до виконання
+} mesh_cmd_ack_packet_t;
+
+// ACK на CMD з MESH_CMD_F_TRACE: відрізки шляху команди від root'а до GPIO
+#define MESH_CMD_TRACE_NO_TIME		INT32_MIN	// net_us: годинник ноди не синхронізований
+
+typedef struct __attribute__((packed)) {
+	mesh_cmd_ack_packet_t a;
+	int32_t		net_us;			// прийом mesh_rx_task - t_root_us, за синхронізованим часом
+	uint32_t	queue_us;		// прийом mesh_rx_task -> виклик хендлера
+	uint32_t	apply_us;		// хендлер -> вихід записано
+	uint8_t		layer;			// esp_mesh_get_layer() ноди
+	uint8_t		rsv[3];
+} mesh_cmd_ack_trace_packet_t;
+
+// Кілька строк лога в одному пакеті (node -> root), до MTU
+// data: count x { uint8_t len; char line[len]; } — без '\0'
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	char		tag[16];		// MESH_TAG
+	uint8_t		count;
+	uint8_t		data[];
+} mesh_log_batch_packet_t;
+
+// MESH_PKT_TYPE_TEXT_BATCH: data — count x { uint8_t len; char text[len]; }, без '\0';
+// кожен текст root обробляє як payload окремого mesh_packet_t
+typedef struct __attribute__((packed)) {
+	mesh_pkt_hdr_t	h;
+	uint8_t		count;
+	uint8_t		data[];
+} mesh_text_batch_packet_t;
+
+// MESH_LOG_TYPE_BIN — той самий mesh_log_batch_packet_t, але data:
+// count x { uint8_t len; бінарний запис (log_binary.h) }
+
 // Керування стрімом лога (root -> node)
+#define MESH_LOG_CTRL_F_BATCH		0x01	// root розуміє MESH_LOG_TYPE_BATCH
+#define MESH_LOG_CTRL_F_BINARY		0x02	// root розуміє MESH_LOG_TYPE_BIN (є ELF для декодера)
+#define MESH_LOG_CTRL_F_FILTER		0x04	// пакет — mesh_log_ctrl_v2_packet_t
+#define MESH_LOG_CTRL_F_COMPACT		0x08	// root розуміє MESH_LOG_TYPE_F_COMPACT
+#define MESH_LOG_CTRL_F_LZ		0x10	// root розуміє MESH_LOG_TYPE_F_LZ
+
 typedef struct __attribute__((packed)) {
 	mesh_pkt_hdr_t	h;
 	uint8_t		enable;			// 0/1
-	uint8_t		rsv[3];
+	uint8_t		flags;			// MESH_LOG_CTRL_F_* (старий root шле 0)
+	uint8_t		rsv[2];
 } mesh_log_ctrl_packet_t;
 
+// v2: фільтр рівня/тегів, перевіряється на ноді до рендеру строки
+#define MESH_LOG_CTRL_MAX_TAGS		4
+
+#define MESH_LOG_TAGS_DENY		0	// теги зі списку не стрімимо
+#define MESH_LOG_TAGS_ALLOW		1	// стрімимо тільки теги зі списку (і піднімаємо їм рівень)
+
+typedef struct __attribute__((packed)) {
+	mesh_log_ctrl_packet_t	base;		// base.flags |= MESH_LOG_CTRL_F_FILTER
+	uint8_t		min_level;		// esp_log_level_t: 1=E .. 5=V; детальніші не стрімимо
+	uint8_t		tag_mode;		// MESH_LOG_TAGS_*
+	uint8_t		tag_count;		// 0 => без фільтра тегів
+	uint8_t		rsv;
+	char		tags[MESH_LOG_CTRL_MAX_TAGS][16];
+} mesh_log_ctrl_v2_packet_t;
+
 #ifdef __cplusplus
 }
 #endif
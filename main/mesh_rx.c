@@ -0,0 +1,302 @@
+#include "mesh_rx.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+
+#include "mesh_hdr.h"
+#include "mesh_proto.h"
+
+static const char *TAG = "mesh_rx";
+
+typedef struct {
+	mesh_rx_handler_t	handler;
+	uint16_t		min_len;
+	uint8_t			stats_slot;	// 0 => без власної статистики
+} mesh_rx_entry_t;
+
+// Таблиця на всі 256 типів: диспетчер — один індекс, без if-ланцюжка
+static mesh_rx_entry_t		s_table[256];
+
+// Слот 0 не використовується (означає "нема слота")
+static mesh_rx_type_stats_t	s_type_stats[MESH_RX_STATS_SLOTS + 1];
+static uint8_t			s_slot_type[MESH_RX_STATS_SLOTS + 1];
+static uint8_t			s_slots_used = 0;
+
+static mesh_rx_buf_t		s_pool[CONFIG_MESH_RX_POOL_SIZE];
+static QueueHandle_t		s_free_q = NULL;	// вільні буфери (вказівники)
+static QueueHandle_t		s_work_q = NULL;	// заповнені буфери для воркерів
+
+static mesh_rx_stats_t		s_stats = {
+	.pool_min_free	= CONFIG_MESH_RX_POOL_SIZE,
+};
+static const mesh_addr_t	s_no_addr;
+static portMUX_TYPE		s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static unsigned hist_bucket(uint32_t us)
+{
+	unsigned b = 0;
+	while (b < MESH_RX_HIST_BUCKETS - 1 && us >= (8u << b)) {
+		b++;
+	}
+	return b;
+}
+
+esp_err_t mesh_rx_register(uint8_t type, size_t min_len, mesh_rx_handler_t handler)
+{
+	if (!handler || min_len < sizeof(mesh_pkt_hdr_t) || min_len > UINT16_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	portENTER_CRITICAL(&s_lock);
+
+	mesh_rx_entry_t *e = &s_table[type];
+	if (e->stats_slot == 0 && s_slots_used < MESH_RX_STATS_SLOTS) {
+		e->stats_slot = ++s_slots_used;
+		s_slot_type[e->stats_slot] = type;
+	}
+	e->min_len = (uint16_t)min_len;
+	e->handler = handler;
+
+	portEXIT_CRITICAL(&s_lock);
+	return ESP_OK;
+}
+
+esp_err_t mesh_rx_dispatch(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	if (!pkt_buf) return ESP_ERR_INVALID_ARG;
+	if (!from) from = &s_no_addr;
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.rx_total++;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (pkt_len < sizeof(mesh_pkt_hdr_t)) {
+		portENTER_CRITICAL(&s_lock);
+		s_stats.too_short++;
+		portEXIT_CRITICAL(&s_lock);
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	const mesh_pkt_hdr_t *h = (const mesh_pkt_hdr_t *)pkt_buf;
+
+	// не наш протокол? ігноруємо
+	if (h->magic != MESH_PKT_MAGIC || h->version != MESH_PKT_VERSION) {
+		portENTER_CRITICAL(&s_lock);
+		s_stats.bad_magic++;
+		portEXIT_CRITICAL(&s_lock);
+		return ESP_ERR_INVALID_VERSION;
+	}
+
+	const mesh_rx_entry_t e = s_table[h->type];
+	mesh_rx_type_stats_t *st = e.stats_slot ? &s_type_stats[e.stats_slot] : NULL;
+
+	if (!e.handler) {
+		portENTER_CRITICAL(&s_lock);
+		s_stats.unhandled++;
+		portEXIT_CRITICAL(&s_lock);
+
+		// Не ESP_LOGI: на root сюди падає кожен стрімлений лог-рядок
+		ESP_LOGD(TAG, "RX type=%u from " MACSTR " (%d bytes), no handler",
+			(unsigned)h->type, MAC2STR(from->addr), (int)pkt_len);
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+
+	if (pkt_len < e.min_len) {
+		portENTER_CRITICAL(&s_lock);
+		if (st) st->short_pkts++;
+		portEXIT_CRITICAL(&s_lock);
+
+		ESP_LOGW(TAG, "RX type=%u short: %d < %u bytes",
+			(unsigned)h->type, (int)pkt_len, (unsigned)e.min_len);
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	int64_t t0 = esp_timer_get_time();
+	esp_err_t err = e.handler(from, pkt_buf, pkt_len);
+	uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+
+	if (st) {
+		portENTER_CRITICAL(&s_lock);
+		st->rx_pkts++;
+		st->rx_bytes += pkt_len;
+		if (err != ESP_OK) st->handler_err++;
+		st->handler_us_total += dt;
+		if (dt > st->handler_us_max) st->handler_us_max = dt;
+		st->hist[hist_bucket(dt)]++;
+		portEXIT_CRITICAL(&s_lock);
+	}
+
+	return err;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Пул буферів і воркери                                                     */
+/* -------------------------------------------------------------------------- */
+
+static void mesh_rx_worker_task(void *arg)
+{
+	(void)arg;
+
+	while (true) {
+		mesh_rx_buf_t *b = NULL;
+		if (xQueueReceive(s_work_q, &b, portMAX_DELAY) != pdTRUE || !b) {
+			continue;
+		}
+
+		// заголовок v2 => v1 на місці, хендлери бачать тільки v1
+		size_t len = mesh_hdr_rx(&b->from, b->data, b->len, sizeof(b->data));
+		if (len) mesh_rx_dispatch(&b->from, b->data, len);
+		mesh_rx_buf_free(b);
+	}
+}
+
+esp_err_t mesh_rx_pool_start(UBaseType_t worker_prio)
+{
+	if (s_free_q) return ESP_OK;
+
+	// Обидві черги на весь пул => xQueueSend в них ніколи не блокує
+	s_free_q = xQueueCreate(CONFIG_MESH_RX_POOL_SIZE, sizeof(mesh_rx_buf_t *));
+	s_work_q = xQueueCreate(CONFIG_MESH_RX_POOL_SIZE, sizeof(mesh_rx_buf_t *));
+	if (!s_free_q || !s_work_q) {
+		ESP_LOGE(TAG, "failed to create pool queues");
+		return ESP_ERR_NO_MEM;
+	}
+
+	for (int i = 0; i < CONFIG_MESH_RX_POOL_SIZE; i++) {
+		mesh_rx_buf_t *b = &s_pool[i];
+		xQueueSend(s_free_q, &b, 0);
+	}
+
+	for (int i = 0; i < CONFIG_MESH_RX_WORKERS; i++) {
+		if (xTaskCreate(mesh_rx_worker_task, "mesh_rx_wrk", 4096, NULL, worker_prio, NULL) != pdPASS) {
+			ESP_LOGE(TAG, "failed to create worker %d", i);
+			return ESP_ERR_NO_MEM;
+		}
+	}
+
+	ESP_LOGI(TAG, "RX pool: %d x %d bytes, %d worker(s)",
+		CONFIG_MESH_RX_POOL_SIZE, CONFIG_MESH_RX_BUF_SIZE, CONFIG_MESH_RX_WORKERS);
+	return ESP_OK;
+}
+
+mesh_rx_buf_t *mesh_rx_buf_alloc(void)
+{
+	mesh_rx_buf_t *b = NULL;
+	if (!s_free_q || xQueueReceive(s_free_q, &b, 0) != pdTRUE) {
+		return NULL;
+	}
+
+	uint32_t free_now = (uint32_t)uxQueueMessagesWaiting(s_free_q);
+
+	portENTER_CRITICAL(&s_lock);
+	if (free_now < s_stats.pool_min_free) s_stats.pool_min_free = free_now;
+	portEXIT_CRITICAL(&s_lock);
+
+	return b;
+}
+
+void mesh_rx_submit(mesh_rx_buf_t *buf)
+{
+	if (!buf) return;
+
+	xQueueSend(s_work_q, &buf, 0);
+
+	uint32_t depth = (uint32_t)uxQueueMessagesWaiting(s_work_q);
+
+	portENTER_CRITICAL(&s_lock);
+	if (depth > s_stats.work_q_max) s_stats.work_q_max = depth;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+void mesh_rx_buf_free(mesh_rx_buf_t *buf)
+{
+	if (!buf) return;
+	xQueueSend(s_free_q, &buf, 0);
+}
+
+void mesh_rx_note_dropped(void)
+{
+	portENTER_CRITICAL(&s_lock);
+	s_stats.pool_exhausted++;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+int64_t mesh_rx_pkt_time_us(const void *pkt_buf)
+{
+	const uint8_t *p = (const uint8_t *)pkt_buf;
+	const uint8_t *lo = (const uint8_t *)&s_pool[0];
+	const uint8_t *hi = (const uint8_t *)&s_pool[CONFIG_MESH_RX_POOL_SIZE];
+
+	if (p < lo || p >= hi) return esp_timer_get_time();
+
+	const mesh_rx_buf_t *b = &s_pool[(size_t)(p - lo) / sizeof(mesh_rx_buf_t)];
+	if (p != b->data) return esp_timer_get_time();
+	return b->rx_us;
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Статистика                                                                */
+/* -------------------------------------------------------------------------- */
+
+void mesh_rx_get_stats(mesh_rx_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t mesh_rx_get_type_stats(uint8_t type, mesh_rx_type_stats_t *out)
+{
+	if (!out) return ESP_ERR_INVALID_ARG;
+
+	uint8_t slot = s_table[type].stats_slot;
+	if (slot == 0) return ESP_ERR_NOT_FOUND;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_type_stats[slot];
+	portEXIT_CRITICAL(&s_lock);
+	return ESP_OK;
+}
+
+void mesh_rx_log_stats(void)
+{
+	mesh_rx_stats_t g;
+	mesh_rx_get_stats(&g);
+
+	ESP_LOGI(TAG, "RX total=%" PRIu32 " short=%" PRIu32 " bad_magic=%" PRIu32 " unhandled=%" PRIu32
+		" pool_exhausted=%" PRIu32 " pool_min_free=%" PRIu32 " work_q_max=%" PRIu32,
+		g.rx_total, g.too_short, g.bad_magic, g.unhandled,
+		g.pool_exhausted, g.pool_min_free, g.work_q_max);
+
+	for (uint8_t slot = 1; slot <= s_slots_used; slot++) {
+		mesh_rx_type_stats_t st;
+
+		portENTER_CRITICAL(&s_lock);
+		st = s_type_stats[slot];
+		portEXIT_CRITICAL(&s_lock);
+
+		if (st.rx_pkts == 0 && st.short_pkts == 0) continue;
+
+		// гістограма: <8 <16 <32 ... мкс
+		char hist[MESH_RX_HIST_BUCKETS * 11 + 1];
+		size_t off = 0;
+		for (unsigned b = 0; b < MESH_RX_HIST_BUCKETS && off < sizeof(hist); b++) {
+			off += snprintf(hist + off, sizeof(hist) - off, "%s%" PRIu32, b ? "/" : "", st.hist[b]);
+		}
+
+		ESP_LOGI(TAG, "  type=%u pkts=%" PRIu32 " bytes=%" PRIu64 " short=%" PRIu32 " err=%" PRIu32
+			" avg=%" PRIu32 "us max=%" PRIu32 "us hist=%s",
+			(unsigned)s_slot_type[slot], st.rx_pkts, st.rx_bytes, st.short_pkts, st.handler_err,
+			st.rx_pkts ? (uint32_t)(st.handler_us_total / st.rx_pkts) : 0,
+			st.handler_us_max, hist);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "esp_mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Скільки типів можуть мати власну статистику; решта обробляється без лічильників
+// за типом (rx_total у mesh_rx_stats_t їх усе одно рахує)
+#define MESH_RX_STATS_SLOTS		16
+
+// Гістограма часу хендлера: кошик i => < (8 << i) мкс, останній — все інше
+#define MESH_RX_HIST_BUCKETS		10
+
+// Буфер пулу: mesh_rx_task приймає в нього і передає воркеру вказівником (без копії)
+typedef struct {
+	mesh_addr_t	from;
+	int		flag;
+	uint16_t	len;
+	int64_t		rx_us;		// esp_timer_get_time() одразу після esp_mesh_recv
+	uint8_t		data[CONFIG_MESH_RX_BUF_SIZE];
+} mesh_rx_buf_t;
+
+// Хендлер пакета. pkt_buf вже пройшов перевірку magic/version і min_len.
+typedef esp_err_t (*mesh_rx_handler_t)(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len);
+
+typedef struct {
+	uint32_t	rx_pkts;
+	uint64_t	rx_bytes;
+	uint32_t	short_pkts;		// менші за min_len
+	uint32_t	handler_err;		// хендлер повернув != ESP_OK
+	uint64_t	handler_us_total;
+	uint32_t	handler_us_max;
+	uint32_t	hist[MESH_RX_HIST_BUCKETS];
+} mesh_rx_type_stats_t;
+
+typedef struct {
+	uint32_t	rx_total;
+	uint32_t	too_short;		// менше за заголовок
+	uint32_t	bad_magic;		// не наш протокол / інша версія
+	uint32_t	unhandled;		// тип без хендлера
+	uint32_t	pool_exhausted;		// пакет прийнято, але всі буфери зайняті => дроп
+	uint32_t	pool_min_free;		// мінімум вільних буферів за весь час
+	uint32_t	work_q_max;		// максимальна глибина черги до воркерів
+} mesh_rx_stats_t;
+
+// Реєстрація хендлера для type. Повторний виклик замінює хендлер.
+esp_err_t	mesh_rx_register(uint8_t type, size_t min_len, mesh_rx_handler_t handler);
+
+// Викликати з mesh_rx_task() для кожного прийнятого пакета (синхронно)
+esp_err_t	mesh_rx_dispatch(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len);
+
+// Пул буферів + CONFIG_MESH_RX_WORKERS воркер-тасок, які викликають mesh_rx_dispatch()
+esp_err_t	mesh_rx_pool_start(UBaseType_t worker_prio);
+
+// Вільний буфер або NULL (пул вичерпано). Сам не рахує: викинутий пакет caller
+// відмічає через mesh_rx_note_dropped() (pool_exhausted)
+mesh_rx_buf_t	*mesh_rx_buf_alloc(void);
+
+// Передати заповнений буфер воркерам. Буфер повертається в пул після хендлера.
+void		mesh_rx_submit(mesh_rx_buf_t *buf);
+
+// Повернути буфер у пул без обробки
+void		mesh_rx_buf_free(mesh_rx_buf_t *buf);
+
+// Пакет прийнято в scratch-буфер і викинуто (бо пул вичерпано)
+void		mesh_rx_note_dropped(void);
+
+// Час прийому пакета (esp_timer, мкс) для pkt_buf з пулу; інакше — "зараз".
+// Для хендлерів, яким важливий момент прийому, а не момент обробки (time sync).
+int64_t		mesh_rx_pkt_time_us(const void *pkt_buf);
+
+void		mesh_rx_get_stats(mesh_rx_stats_t *out);
+
+// ESP_ERR_NOT_FOUND якщо для type немає власного слота статистики
+esp_err_t	mesh_rx_get_type_stats(uint8_t type, mesh_rx_type_stats_t *out);
+
+// Друкує статистику всіх зареєстрованих типів через ESP_LOGI
+void		mesh_rx_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
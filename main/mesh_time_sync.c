@@ -8,33 +8,36 @@
 #include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_mesh.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-static const char *TAG = "mesh_time";
+#include "mesh_hdr.h"
+#include "mesh_proto.h"
+#include "mesh_rx.h"
+#include "mesh_tx.h"
 
-// Має співпасти з твоїм mesh_packet_t
-typedef struct __attribute__((packed)) {
-	uint8_t		magic;
-	uint8_t		version;
-	uint8_t		type;
-	uint8_t		reserved;
-	uint32_t	counter;
-	uint8_t		src_mac[6];
-	uint8_t		payload[32];
-} mesh_packet_wire_t;
+static const char *TAG = "mesh_time";
 
 typedef struct __attribute__((packed)) {
 	int64_t		epoch_sec;
 	uint32_t	seq;
+	uint32_t	period_ms;	// базовий період root'а (0 у старих root)
+	int64_t		epoch_us;	// час root'а на момент відправки (0 у старих root)
+	uint32_t	fwd_us;		// сумарна затримка в ретрансляторах
+	uint8_t		hops;		// скільки разів ретрансльовано
 } mesh_time_payload_t;
 
-#define OUR_MAGIC	0xA5
-#define OUR_VER		1
+_Static_assert(sizeof(mesh_time_payload_t) <= sizeof(((mesh_time_packet_t *)0)->payload), "TIME payload");
+
 #define TIME_VALID_EPOCH	1577836800LL	// 2020-01-01
 
+#define TIME_TICK_MS		250		// крок таски: holdover і розклад
+#define TIME_REQ_TIMEOUT_MS	2000
+#define TIME_DRIFT_MAX_PPB	500000		// кварц гірший за 500 ppm — це вже не дрейф
+
 static bool			s_inited = false;
 static bool			s_root_task_started = false;
 static uint32_t		s_period_ms = 60000;
@@ -43,6 +46,41 @@ static uint32_t		s_seq = 0;
 static uint32_t		s_last_rx_seq = 0;
 static bool			s_have_time = false;
 
+/*
+ * Точна синхронізація (нода): TIME від root запускає серію з
+ * CONFIG_MESH_TIME_SYNC_BURST обмінів REQ/RESP. З серії береться вибірка з
+ * найменшою затримкою (найменше черг по дорозі => найсиметричніший шлях), і
+ * годинник підводиться adjtime(); крок settimeofday() — тільки якщо зсув
+ * більший за CONFIG_MESH_TIME_SLEW_MAX_MS.
+ */
+static portMUX_TYPE		s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t			s_pkt_cnt = 0;		// h.counter для REQ/RESP
+static uint32_t			s_req_seq = 0;
+static bool			s_req_pending = false;
+static int64_t			s_req_sent_us = 0;
+static unsigned			s_burst_left = 0;
+static int64_t			s_best_offset_us = 0;
+static int64_t			s_best_delay_us = -1;
+static mesh_time_sync_stats_t	s_stats;
+
+/*
+ * Holdover (нода): між серіями годинник підкручується на оцінений дрейф
+ * (s_stats.drift_ppb), тож наступна серія міряє тільки похибку оцінки. Поки
+ * зсув у серії малий відносно CONFIG_MESH_TIME_MAX_ERR_US, інтервал
+ * подвоюється (до базового періоду * CONFIG_MESH_TIME_SYNC_MAX_X), коли великий —
+ * ділиться навпіл. Серії нода запускає сама; TIME від root — тільки перший раз.
+ */
+static uint32_t			s_base_ms = 60000;	// базовий період з TIME
+static uint32_t			s_interval_ms = 60000;
+static int64_t			s_next_sync_us = 0;	// esp_timer_get_time(), 0 => не заплановано
+static int64_t			s_last_sync_mono_us = 0;
+static int64_t			s_drift_weight_us = 0;	// на якому часі виміряна оцінка дрейфу
+static int64_t			s_hold_acc_ns = 0;
+
+// Root: що ноди повідомили про себе в REQ
+static mesh_time_node_stats_t	s_nodes[CONFIG_MESH_ROUTE_TABLE_SIZE];
+static size_t			s_nodes_n = 0;
+
 static void set_tz_pl(void)
 {
 	// Те саме правило, що ти вже юзаєш на node0
@@ -57,11 +95,27 @@ static bool is_time_valid_now(void)
 	return ((int64_t)now > TIME_VALID_EPOCH);
 }
 
-void mesh_time_sync_init(void)
+static int64_t now_us(void)
 {
-	if (s_inited) return;
-	s_inited = true;
-	set_tz_pl();
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Епоха (мкс) на момент прийому пакета, а не на момент роботи хендлера
+static int64_t rx_epoch_us(const void *pkt_buf)
+{
+	return now_us() - (esp_timer_get_time() - mesh_rx_pkt_time_us(pkt_buf));
+}
+
+static void hdr_fill(mesh_pkt_hdr_t *h, uint8_t type)
+{
+	mesh_hdr_fill(h, type, ++s_pkt_cnt);
+}
+
+static esp_err_t send_to(const mesh_addr_t *to, const void *buf, size_t len)
+{
+	return mesh_tx_send(MESH_TX_TIME, to, buf, len, 0);
 }
 
 static void mesh_time_sync_root_set_period_ms(uint32_t period_ms)
@@ -70,29 +124,58 @@ static void mesh_time_sync_root_set_period_ms(uint32_t period_ms)
 	s_period_ms = period_ms;
 }
 
-static esp_err_t root_send_time_to_all(int64_t epoch_sec, uint32_t seq)
+/*
+ * CONFIG_MESH_TIME_RELAY: root шле TIME тільки своїм дітям (станціям на своєму
+ * softAP), кожна нода пересилає своїм — root робить O(дітей) відправок, а не
+ * O(нод). Синхронізований ретранслятор ставить свій штамп (restamp), тож
+ * отримувачу лишається невідомою тільки затримка останнього лінка;
+ * несинхронізований — додає до fwd_us час від прийому до відправки.
+ */
+static esp_err_t send_time_to_children(mesh_time_packet_t *pkt, mesh_time_payload_t *tp,
+				       bool restamp, int64_t rx_mono_us, int *sent)
 {
-	mesh_packet_wire_t pkt;
-	memset(&pkt, 0, sizeof(pkt));
+	wifi_sta_list_t sta;
+	esp_err_t err = esp_wifi_ap_get_sta_list(&sta);
+	if (err != ESP_OK) return err;
+
+	uint32_t fwd_us = tp->fwd_us;
+	esp_err_t last_err = ESP_OK;
+
+	for (int i = 0; i < sta.num; i++) {
+		mesh_addr_t to;
+		memcpy(to.addr, sta.sta[i].mac, 6);
 
-	pkt.magic = OUR_MAGIC;
-	pkt.version = OUR_VER;
-	pkt.type = MESH_TIME_SYNC_TYPE_TIME;
-	pkt.counter = seq;
-	esp_wifi_get_mac(WIFI_IF_STA, pkt.src_mac);
+		// свіжий штамп на кожну дитину, або скільки пакет пролежав тут
+		if (restamp) tp->epoch_us = now_us();
+		else tp->fwd_us = fwd_us + (uint32_t)(esp_timer_get_time() - rx_mono_us);
+		memcpy(pkt->payload, tp, sizeof(*tp));
+
+		esp_err_t e = send_to(&to, pkt, sizeof(*pkt));
+		if (e != ESP_OK) last_err = e;
+		else (*sent)++;
+	}
+	return last_err;
+}
+
+static esp_err_t root_send_time_to_all(int64_t epoch_sec, uint32_t seq, int *sent)
+{
+	mesh_time_packet_t pkt;
+	memset(&pkt, 0, sizeof(pkt));
+	mesh_hdr_fill(&pkt.h, MESH_TIME_SYNC_TYPE_TIME, seq);
 
 	mesh_time_payload_t tp;
 	memset(&tp, 0, sizeof(tp));
 	tp.epoch_sec = epoch_sec;
 	tp.seq = seq;
-	memcpy(pkt.payload, &tp, sizeof(tp));
+	tp.period_ms = s_period_ms;
 
-	mesh_data_t data;
-	memset(&data, 0, sizeof(data));
-	data.data = (uint8_t *)&pkt;
-	data.size = sizeof(pkt);
-	data.proto = MESH_PROTO_BIN;
-	data.tos = MESH_TOS_P2P;
+	*sent = 0;
+
+#if CONFIG_MESH_TIME_RELAY
+	return send_time_to_children(&pkt, &tp, true, 0, sent);
+#else
+	tp.epoch_us = now_us();
+	memcpy(pkt.payload, &tp, sizeof(tp));
 
 	mesh_addr_t route_table[CONFIG_MESH_ROUTE_TABLE_SIZE];
 	int route_table_size = 0;
@@ -110,39 +193,55 @@ static esp_err_t root_send_time_to_all(int64_t epoch_sec, uint32_t seq)
 
 	esp_err_t last_err = ESP_OK;
 	for (int i = 0; i < route_table_size; i++) {
-		esp_err_t e = esp_mesh_send(&route_table[i], &data, MESH_DATA_P2P, NULL, 0);
+		esp_err_t e = send_to(&route_table[i], &pkt, sizeof(pkt));
 		if (e != ESP_OK) last_err = e;
+		else (*sent)++;
 	}
 	return last_err;
+#endif
 }
 
 static void mesh_time_root_task(void *arg)
 {
 	// Перший "тик" робимо швидко, щоб після появи часу ноди не чекали 60с
-	TickType_t last = xTaskGetTickCount();
-	bool first_sent = false;
+	uint32_t interval_ms = s_period_ms;
+	int64_t next_us = 0;
+	int last_nodes = -1;
 
 	while (true) {
 
-		vTaskDelayUntil(&last, pdMS_TO_TICKS(s_period_ms));
+		vTaskDelay(pdMS_TO_TICKS(TIME_TICK_MS));
 
 		if (!esp_mesh_is_root()) continue;
 		if (!is_time_valid_now()) continue;
 
+		// Синхронізовані ноди далі тримають час самі; TIME потрібен новим —
+		// тому при зміні таблиці маршрутів знову базовий період, інакше він росте
+		int nodes = esp_mesh_get_routing_table_size();
+		if (nodes != last_nodes) {
+			last_nodes = nodes;
+			interval_ms = s_period_ms;
+			next_us = 0;
+		}
+		if (esp_timer_get_time() < next_us) continue;
+
 		time_t now = 0;
 		time(&now);
 
 		s_seq++;
 
-		esp_err_t err = root_send_time_to_all((int64_t)now, s_seq);
+		int sent = 0;
+		esp_err_t err = root_send_time_to_all((int64_t)now, s_seq, &sent);
 		if (err == ESP_OK) {
-			ESP_LOGI(TAG, "TIME TX seq=%" PRIu32 " epoch=%" PRId64, s_seq, (int64_t)now);
+			ESP_LOGI(TAG, "TIME TX seq=%" PRIu32 " epoch=%" PRId64 " sent=%d next=%" PRIu32 " ms",
+				s_seq, (int64_t)now, sent, interval_ms);
 		} else {
 			ESP_LOGW(TAG, "TIME TX err=%s seq=%" PRIu32, esp_err_to_name(err), s_seq);
 		}
 
-		first_sent = true;
-		last = xTaskGetTickCount();
+		next_us = esp_timer_get_time() + (int64_t)interval_ms * 1000;
+		interval_ms *= 2;
+		if (interval_ms > s_period_ms * CONFIG_MESH_TIME_SYNC_MAX_X) interval_ms = s_period_ms * CONFIG_MESH_TIME_SYNC_MAX_X;
 	}
 }
 
@@ -150,6 +249,8 @@ esp_err_t mesh_time_sync_root_start(uint32_t period_ms)
 {
 	//mesh_time_sync_init();
 
+	mesh_time_sync_root_set_period_ms(period_ms);
+
 	if (xTaskCreate(mesh_time_root_task, "mesh_time_tx", 4096, NULL, 4, NULL) != pdPASS) {
 		return ESP_ERR_NO_MEM;
 	}
@@ -159,45 +260,410 @@ esp_err_t mesh_time_sync_root_start(uint32_t period_ms)
 }
 
 
-esp_err_t mesh_time_sync_handle_rx(const void *pkt_buf, size_t pkt_len)
+/* -------------------------------------------------------------------------- */
+/*  Нода: REQ/RESP                                                            */
+/* -------------------------------------------------------------------------- */
+
+static esp_err_t send_req(void)
 {
-	//mesh_time_sync_init();
+	mesh_time_req_packet_t p;
+	memset(&p, 0, sizeof(p));
+	hdr_fill(&p.h, MESH_TIME_SYNC_TYPE_REQ);
+
+	portENTER_CRITICAL(&s_lock);
+	p.seq = ++s_req_seq;
+	s_req_pending = true;
+	s_req_sent_us = esp_timer_get_time();
+	p.last_offset_us = (int32_t)s_stats.last_offset_us;
+	p.last_delay_us = s_stats.last_delay_us;
+	portEXIT_CRITICAL(&s_lock);
+
+	mesh_addr_t root;
+	memset(&root, 0, sizeof(root));
+
+	p.t1_us = now_us();
+	return send_to(&root, &p, sizeof(p));
+}
+
+static esp_err_t start_burst(void)
+{
+	portENTER_CRITICAL(&s_lock);
+	s_burst_left = CONFIG_MESH_TIME_SYNC_BURST;
+	s_best_delay_us = -1;
+	portEXIT_CRITICAL(&s_lock);
+
+	return send_req();
+}
+
+// Під s_lock: дрейф і наступний інтервал за зсувом, виміряним після holdover.
+// pending_us — ще не відпрацьований adjtime: це вже врахована корекція, не дрейф
+static void schedule_next(int64_t offset_us, int64_t pending_us, bool step, int64_t mono_us)
+{
+	uint32_t max_ms = s_base_ms * CONFIG_MESH_TIME_SYNC_MAX_X;
+	int64_t mag = offset_us < 0 ? -offset_us : offset_us;
+
+	if (s_stats.syncs == 0) {
+		// перший крок лише ставить точку відліку: дрейф між грубим і точним часом не виміряти
+		s_interval_ms = s_base_ms;
+	} else if (step) {
+		// великий зсув — старій оцінці дрейфу (і довгому інтервалу) вже не віримо
+		s_stats.drift_ppb = 0;
+		s_drift_weight_us = 0;
+		s_interval_ms = s_base_ms;
+	} else {
+		int64_t dt = mono_us - s_last_sync_mono_us;
+		if (dt > 0) {
+			// Вага нового виміру пропорційна інтервалу: короткі ранні інтервали
+			// (зсув там майже весь — шум) не перебивають довгі
+			int64_t resid_ppb = (offset_us - pending_us) * 1000000000LL / dt;
+			int64_t ppb = s_stats.drift_ppb + resid_ppb * dt / (dt + s_drift_weight_us);
+			if (ppb > TIME_DRIFT_MAX_PPB) ppb = TIME_DRIFT_MAX_PPB;
+			if (ppb < -TIME_DRIFT_MAX_PPB) ppb = -TIME_DRIFT_MAX_PPB;
+			s_stats.drift_ppb = (int32_t)ppb;
+
+			s_drift_weight_us += dt;
+			if (s_drift_weight_us > (int64_t)max_ms * 1000) s_drift_weight_us = (int64_t)max_ms * 1000;
+		}
+
+		if (mag <= CONFIG_MESH_TIME_MAX_ERR_US / 4) s_interval_ms *= 2;
+		else if (mag > CONFIG_MESH_TIME_MAX_ERR_US / 2) s_interval_ms /= 2;
+	}
+
+	if (s_interval_ms > max_ms) s_interval_ms = max_ms;
+	if (s_interval_ms < s_base_ms) s_interval_ms = s_base_ms;
+
+	s_last_sync_mono_us = mono_us;
+	s_next_sync_us = mono_us + (int64_t)s_interval_ms * 1000;
+	s_stats.interval_ms = s_interval_ms;
+}
+
+static void apply_offset(int64_t offset_us, int64_t delay_us)
+{
+	int64_t mag = offset_us < 0 ? -offset_us : offset_us;
+	// перша точна синхронізація після грубої (до секунди) — завжди крок
+	bool step = s_stats.syncs == 0 || mag > (int64_t)CONFIG_MESH_TIME_SLEW_MAX_MS * 1000;
+
+	struct timeval left = { 0 };
+	adjtime(NULL, &left);
+	int64_t pending_us = (int64_t)left.tv_sec * 1000000 + left.tv_usec;
+
+	if (step) {
+		int64_t t = now_us() + offset_us;
+		struct timeval tv = {
+			.tv_sec = (time_t)(t / 1000000),
+			.tv_usec = (suseconds_t)(t % 1000000),
+		};
+		settimeofday(&tv, NULL);
+	} else {
+		// нова корекція замінює незавершену попередню (offset уже з її урахуванням)
+		struct timeval delta = {
+			.tv_sec = (time_t)(offset_us / 1000000),
+			.tv_usec = (suseconds_t)(offset_us % 1000000),
+		};
+		adjtime(&delta, NULL);
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	schedule_next(offset_us, pending_us, step, esp_timer_get_time());
+	s_stats.syncs++;
+	if (step) s_stats.steps++;
+	else s_stats.slews++;
+	s_stats.last_offset_us = offset_us;
+	s_stats.last_delay_us = (uint32_t)delay_us;
+	if (mag > s_stats.max_abs_offset_us) s_stats.max_abs_offset_us = mag;
+	if (delay_us > s_stats.max_delay_us) s_stats.max_delay_us = (uint32_t)delay_us;
+	s_stats.last_sync_us = esp_timer_get_time();
+	uint32_t next_ms = s_interval_ms;
+	int32_t drift_ppb = s_stats.drift_ppb;
+	portEXIT_CRITICAL(&s_lock);
+
+	ESP_LOGI(TAG, "TIME sync offset=%" PRId64 " us delay=%" PRId64 " us (%s) drift=%" PRId32 " ppb next=%" PRIu32 " ms",
+		offset_us, delay_us, step ? "step" : "slew", drift_ppb, next_ms);
+}
+
+// Серія закінчилась (усі RESP або таймаути): найкраща вибірка або повтор за базовий період
+static void burst_done(void)
+{
+	portENTER_CRITICAL(&s_lock);
+	int64_t best_offset = s_best_offset_us, best_delay = s_best_delay_us;
+	if (best_delay < 0) {
+		s_next_sync_us = esp_timer_get_time() + (int64_t)s_base_ms * 1000;
+	}
+	portEXIT_CRITICAL(&s_lock);
+
+	if (best_delay >= 0) apply_offset(best_offset, best_delay);
+}
+
+static esp_err_t handle_resp(const void *pkt_buf, size_t pkt_len)
+{
+	if (pkt_len < sizeof(mesh_time_resp_packet_t)) return ESP_ERR_INVALID_SIZE;
+
+	const mesh_time_resp_packet_t *p = (const mesh_time_resp_packet_t *)pkt_buf;
+	int64_t t4 = rx_epoch_us(pkt_buf);
+
+	int64_t offset = ((p->t2_us - p->t1_us) + (p->t3_us - t4)) / 2;
+	int64_t delay = (t4 - p->t1_us) - (p->t3_us - p->t2_us);
+
+	bool more;
+
+	portENTER_CRITICAL(&s_lock);
+	if (!s_req_pending || p->seq != s_req_seq || delay < 0) {
+		portEXIT_CRITICAL(&s_lock);
+		return ESP_ERR_INVALID_STATE;		// запізніла/чужа відповідь
+	}
+	s_req_pending = false;
+	s_stats.samples++;
+	if (s_best_delay_us < 0 || delay < s_best_delay_us) {
+		s_best_delay_us = delay;
+		s_best_offset_us = offset;
+	}
+	if (s_burst_left > 0) s_burst_left--;
+	more = s_burst_left > 0;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (more) return send_req();
+	burst_done();
+	return ESP_OK;
+}
 
-	if (!pkt_buf || pkt_len < sizeof(mesh_packet_wire_t)) {
+// Холдовер: підкрутити годинник на оцінений дрейф за dt_us
+static void holdover(int64_t dt_us)
+{
+	portENTER_CRITICAL(&s_lock);
+	s_hold_acc_ns += (int64_t)s_stats.drift_ppb * dt_us / 1000000;
+	int64_t corr_us = s_hold_acc_ns / 1000;
+	s_hold_acc_ns -= corr_us * 1000;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (corr_us == 0) return;
+
+	// adjtime() замінює незавершену корекцію — додаємо до залишку, а не поверх
+	struct timeval left = { 0 };
+	adjtime(NULL, &left);
+	int64_t d = (int64_t)left.tv_sec * 1000000 + left.tv_usec + corr_us;
+	struct timeval delta = {
+		.tv_sec = (time_t)(d / 1000000),
+		.tv_usec = (suseconds_t)(d % 1000000),
+	};
+	adjtime(&delta, NULL);
+}
+
+static void mesh_time_node_task(void *arg)
+{
+	int64_t last_us = esp_timer_get_time();
+
+	while (true) {
+
+		vTaskDelay(pdMS_TO_TICKS(TIME_TICK_MS));
+
+		int64_t mono = esp_timer_get_time();
+		int64_t dt = mono - last_us;
+		last_us = mono;
+
+		if (esp_mesh_is_root()) continue;
+
+		holdover(dt);
+
+		bool start = false, retry = false, done = false;
+
+		portENTER_CRITICAL(&s_lock);
+		if (s_req_pending) {
+			if (mono - s_req_sent_us > (int64_t)TIME_REQ_TIMEOUT_MS * 1000) {
+				s_req_pending = false;
+				s_stats.req_timeouts++;
+				if (s_burst_left > 0) s_burst_left--;
+				retry = s_burst_left > 0;
+				done = !retry;
+			}
+		} else if (s_burst_left == 0 && s_next_sync_us != 0 && mono >= s_next_sync_us) {
+			start = true;
+		}
+		portEXIT_CRITICAL(&s_lock);
+
+		if (start) start_burst();
+		else if (retry) send_req();
+		else if (done) burst_done();
+	}
+}
+
+void mesh_time_sync_init(void)
+{
+	if (s_inited) return;
+	s_inited = true;
+	set_tz_pl();
+
+	if (xTaskCreate(mesh_time_node_task, "mesh_time", 3072, NULL, 4, NULL) != pdPASS) {
+		ESP_LOGE(TAG, "time task create failed");
+	}
+}
+
+static esp_err_t handle_time(const void *pkt_buf, size_t pkt_len)
+{
+	if (!pkt_buf || pkt_len < sizeof(mesh_time_packet_t)) {
 		return ESP_ERR_INVALID_SIZE;
 	}
 
-	const mesh_packet_wire_t *pkt = (const mesh_packet_wire_t *)pkt_buf;
+	mesh_time_packet_t pkt;
+	memcpy(&pkt, pkt_buf, sizeof(pkt));
 
 	// фільтр “це точно наш пакет”
-	if (pkt->magic != OUR_MAGIC || pkt->version != OUR_VER) {
+	if (pkt.h.magic != MESH_PKT_MAGIC || pkt.h.version != MESH_PKT_VERSION) {
 		return ESP_ERR_INVALID_ARG;
 	}
-	if (pkt->type != MESH_TIME_SYNC_TYPE_TIME) {
+	if (pkt.h.type != MESH_TIME_SYNC_TYPE_TIME) {
 		return ESP_ERR_INVALID_ARG;
 	}
 
 	mesh_time_payload_t tp;
 	memset(&tp, 0, sizeof(tp));
-	memcpy(&tp, pkt->payload, sizeof(tp));
+	memcpy(&tp, pkt.payload, sizeof(tp));
+	int64_t rx_mono = mesh_rx_pkt_time_us(pkt_buf);
 
 	if (tp.epoch_sec <= TIME_VALID_EPOCH) {
 		return ESP_ERR_INVALID_RESPONSE;
 	}
 
+	// root — джерело часу; свій же TIME (він є в таблиці маршрутів) не чіпає годинник
+	if (esp_mesh_is_root()) {
+		return ESP_OK;
+	}
+
 	// простий анти-rollback / анти-дублікат
 	if (s_have_time && tp.seq != 0 && tp.seq <= s_last_rx_seq) {
 		return ESP_OK;
 	}
 
-	struct timeval tv;
-	tv.tv_sec = (time_t)tp.epoch_sec;
-	tv.tv_usec = 0;
-	settimeofday(&tv, NULL);
+#if CONFIG_MESH_TIME_RELAY
+	{
+		mesh_time_payload_t fwd = tp;
+		int sent = 0;
+		bool restamp;
+
+		portENTER_CRITICAL(&s_lock);
+		restamp = s_stats.syncs > 0;
+		portEXIT_CRITICAL(&s_lock);
+
+		fwd.hops++;
+		if (restamp) fwd.fwd_us = 0;
+		send_time_to_children(&pkt, &fwd, restamp, rx_mono, &sent);
+	}
+#endif
+
+	// Тільки поки часу ще нема; далі точність дає REQ/RESP. Від нового root —
+	// з точністю до затримки лінків від останнього штампа, від старого — до секунди
+	if (!s_have_time) {
+		int64_t t = tp.epoch_sec * 1000000;
+		if (tp.epoch_us > 0) {
+			t = tp.epoch_us + tp.fwd_us + (esp_timer_get_time() - rx_mono);
+		}
+
+		struct timeval tv;
+		tv.tv_sec = (time_t)(t / 1000000);
+		tv.tv_usec = (suseconds_t)(t % 1000000);
+		settimeofday(&tv, NULL);
+
+		portENTER_CRITICAL(&s_lock);
+		s_stats.steps++;
+		portEXIT_CRITICAL(&s_lock);
+		ESP_LOGI(TAG, "TIME RX seq=%" PRIu32 " set epoch=%" PRId64 " hops=%u fwd=%" PRIu32 " us",
+			tp.seq, tp.epoch_sec, (unsigned)tp.hops, tp.fwd_us);
+	}
 
 	s_have_time = true;
 	s_last_rx_seq = tp.seq;
 
-	ESP_LOGI(TAG, "TIME RX seq=%" PRIu32 " set epoch=%" PRId64, tp.seq, tp.epoch_sec);
-	return ESP_OK;
+	// Уже синхронізована нода йде за своїм розкладом; TIME запускає лише першу серію
+	bool start;
+
+	portENTER_CRITICAL(&s_lock);
+	if (tp.period_ms >= 1000) s_base_ms = tp.period_ms;
+	start = s_stats.syncs == 0 && s_burst_left == 0;
+	portEXIT_CRITICAL(&s_lock);
+
+	return start ? start_burst() : ESP_OK;
+}
+esp_err_t mesh_time_sync_handle_rx(const void *pkt_buf, size_t pkt_len)
+{
+	if (!pkt_buf || pkt_len < sizeof(mesh_pkt_hdr_t)) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	switch (((const mesh_pkt_hdr_t *)pkt_buf)->type) {
+	case MESH_TIME_SYNC_TYPE_TIME:	return handle_time(pkt_buf, pkt_len);
+	case MESH_TIME_SYNC_TYPE_RESP:	return handle_resp(pkt_buf, pkt_len);
+	default:			return ESP_ERR_INVALID_ARG;
+	}
+}
+
+void mesh_time_sync_get_stats(mesh_time_sync_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Root: відповідь на REQ                                                    */
+/* -------------------------------------------------------------------------- */
+
+static void root_note_node(const uint8_t mac[6], const mesh_time_req_packet_t *req)
+{
+	portENTER_CRITICAL(&s_lock);
+	mesh_time_node_stats_t *e = NULL;
+	for (size_t i = 0; i < s_nodes_n; i++) {
+		if (memcmp(s_nodes[i].mac, mac, 6) == 0) {
+			e = &s_nodes[i];
+			break;
+		}
+	}
+	if (!e && s_nodes_n < CONFIG_MESH_ROUTE_TABLE_SIZE) {
+		e = &s_nodes[s_nodes_n++];
+		memset(e, 0, sizeof(*e));
+		memcpy(e->mac, mac, 6);
+	}
+	if (e) {
+		e->reqs++;
+		e->offset_us = req->last_offset_us;
+		e->delay_us = req->last_delay_us;
+		e->last_req_us = esp_timer_get_time();
+	}
+	portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t mesh_time_sync_handle_req(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len)
+{
+	if (!from || !pkt_buf || pkt_len < sizeof(mesh_time_req_packet_t)) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+	if (!esp_mesh_is_root() || !is_time_valid_now()) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	const mesh_time_req_packet_t *req = (const mesh_time_req_packet_t *)pkt_buf;
+	int64_t t2 = rx_epoch_us(pkt_buf);
+
+	root_note_node(from->addr, req);
+
+	mesh_time_resp_packet_t p;
+	memset(&p, 0, sizeof(p));
+	hdr_fill(&p.h, MESH_TIME_SYNC_TYPE_RESP);
+	p.seq = req->seq;
+	p.t1_us = req->t1_us;
+	p.t2_us = t2;
+
+	p.t3_us = now_us();
+	return send_to(from, &p, sizeof(p));
+}
+
+size_t mesh_time_sync_root_get_nodes(mesh_time_node_stats_t *out, size_t max)
+{
+	if (!out) return 0;
+
+	portENTER_CRITICAL(&s_lock);
+	size_t n = s_nodes_n < max ? s_nodes_n : max;
+	memcpy(out, s_nodes, n * sizeof(*out));
+	portEXIT_CRITICAL(&s_lock);
+	return n;
 }
@@ -3,22 +3,56 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "esp_mesh.h"
+#include "mesh_proto.h"		// MESH_TIME_SYNC_TYPE_TIME/REQ/RESP
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Ми займаємо type=2 під TIME
-#define MESH_TIME_SYNC_TYPE_TIME	2
+// Нода: результати обміну REQ/RESP з root
+typedef struct {
+	uint32_t	samples;		// RESP прийнято
+	uint32_t	syncs;			// серій застосовано
+	uint32_t	steps;			// settimeofday (перший раз і великі зсуви)
+	uint32_t	slews;			// adjtime
+	int64_t		last_offset_us;		// root - нода, до корекції
+	uint32_t	last_delay_us;		// round trip без часу на root
+	int64_t		max_abs_offset_us;
+	uint32_t	max_delay_us;
+	int64_t		last_sync_us;		// esp_timer_get_time()
+	uint32_t	req_timeouts;		// REQ без RESP
+	int32_t		drift_ppb;		// оцінка: корекція ходу годинника в holdover
+	uint32_t	interval_ms;		// поточний інтервал між серіями
+} mesh_time_sync_stats_t;
 
+// Root: що повідомила нода (результат її попередньої синхронізації)
+typedef struct {
+	uint8_t		mac[6];
+	uint32_t	reqs;
+	int32_t		offset_us;
+	uint32_t	delay_us;
+	int64_t		last_req_us;		// esp_timer_get_time() root'а
+} mesh_time_node_stats_t;
+
+// Нода: стартує таску holdover/синхронізації за власним розкладом
 void		mesh_time_sync_init(void);
 
-// Root: стартує таску, яка розсилає час всім нодам раз в period_ms
+// Root: стартує таску, яка розсилає час всім нодам; period_ms — базовий період,
+// між розсилками він росте до period_ms * CONFIG_MESH_TIME_SYNC_MAX_X
 esp_err_t	mesh_time_sync_root_start(uint32_t period_ms);
 
-// RX: викликаєш у mesh_rx_task, коли pkt.type == 2
+// RX: викликаєш у mesh_rx_task, коли pkt.type == 2 (TIME) або 9 (RESP)
 esp_err_t	mesh_time_sync_handle_rx(const void *pkt_buf, size_t pkt_len);
 
+// Root RX: type == 8 (REQ), відповідь іде на from
+esp_err_t	mesh_time_sync_handle_req(const mesh_addr_t *from, const void *pkt_buf, size_t pkt_len);
+
+void		mesh_time_sync_get_stats(mesh_time_sync_stats_t *out);
+
+// Root: копіює до max записів, повертає кількість
+size_t		mesh_time_sync_root_get_nodes(mesh_time_node_stats_t *out, size_t max);
+
 #ifdef __cplusplus
 }
 #endif
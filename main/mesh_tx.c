@@ -0,0 +1,308 @@
+#include "mesh_tx.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "lat_hist.h"
+#include "mesh_hdr.h"
+
+static const char *TAG = "mesh_tx";
+
+/*
+ * У esp-mesh одна FIFO-черга вгору на всіх: CMD_ACK або TIME REQ за пачкою
+ * логів чекає, поки вони пройдуть лінк, а REQ ще й повертається з асиметричною
+ * затримкою. Тому best-effort класи ставлять пакет, тільки поки в черзі
+ * драйвера менше за їхній ліміт (у логів менший, ніж у телеметрії), — решта
+ * чекає у відправника, і CTRL/TIME опиняються щонайбільше за кількома.
+ * Строгий пріоритет: поки вищий клас чекає (або щойно отримав відмову з
+ * NONBLOCK), нижчий не ставиться навіть при вільному ліміті.
+ *
+ * CONFIG_MESH_TX_PACE: best-effort клас ще й іде не швидше за свій темп
+ * (пакетів/с), який підбирається AIMD по вікнах: якщо у вікні черга вгору
+ * була на ліміті класу, драйвер казав QUEUE_FULL або батько майже закрив
+ * прийом (esp_mesh_available_txupQ_num) — темп навпіл, інакше, якщо темпу
+ * не вистачало, — плюс крок. Так нода не тримає чергу на ліміті весь час і
+ * не додає повторів у вже забитий лінк; відправники з батчами (legacy,
+ * логи в батч-режимі) при меншому темпі просто шлють більші пакети.
+ */
+
+#define WANT_US		2000	// відмова з NONBLOCK "тримає місце" класу стільки
+
+// Довші пакети йдуть з v1: копія на стеку відправника, а 8 байт там уже нічого не важать
+#define TX_V2_MAX	256
+#define TICK_US		(portTICK_PERIOD_MS * 1000)
+
+#if CONFIG_MESH_TX_PACE
+#define PACE_WINDOW_US	((int64_t)CONFIG_MESH_TX_PACE_WINDOW_MS * 1000)
+#define PACE_AI_PPS	((CONFIG_MESH_TX_PACE_MAX_PPS + 31) / 32)
+#define PACE_BURST	2	// пакетів без паузи після простою
+#endif
+
+static const uint8_t s_tos[MESH_TX_CLASSES] = {
+	[MESH_TX_CTRL]		= MESH_TOS_P2P,
+	[MESH_TX_TIME]		= MESH_TOS_P2P,
+	// без ретрансмітів на кожному хопі: дешевше для лінка, втрата не критична
+	[MESH_TX_TELEMETRY]	= MESH_TOS_DEF,
+	[MESH_TX_LOG]		= MESH_TOS_DEF,
+};
+
+// довжина черги драйвера вгору, з якої клас уже чекає; 0 — не чекає
+static const int s_limit[MESH_TX_CLASSES] = {
+	[MESH_TX_TELEMETRY]	= CONFIG_MESH_TX_TELEMETRY_INFLIGHT,
+	[MESH_TX_LOG]		= CONFIG_MESH_TX_LOG_INFLIGHT,
+};
+
+typedef struct {
+	uint32_t	pps;		// 0 — ще не ініціалізовано
+	uint32_t	pps_min;
+	uint32_t	decreases;
+	int64_t		next_us;	// раніше — не ставимо
+	int64_t		win_us;		// початок вікна
+	bool		congested;	// у вікні: черга на ліміті / QUEUE_FULL / батько закривається
+	bool		limited;	// у вікні чекали на темп
+} tx_pace_t;
+
+typedef struct {
+	uint32_t	sent;
+	uint64_t	bytes;
+	uint32_t	err;
+	uint32_t	held;
+	uint32_t	refused;
+	uint32_t	dropped;
+	lat_hist_t	q_lat;
+	tx_pace_t	pace;
+} tx_class_t;
+
+static portMUX_TYPE	s_lock = portMUX_INITIALIZER_UNLOCKED;
+static tx_class_t	s_cls[MESH_TX_CLASSES];
+static int		s_waiting[MESH_TX_CLASSES];
+static int64_t		s_want_us[MESH_TX_CLASSES];
+
+#if CONFIG_MESH_TX_PACE
+// під s_lock
+static void pace_window(tx_pace_t *p, int64_t now)
+{
+	if (!p->pps) {
+		p->pps = p->pps_min = CONFIG_MESH_TX_PACE_MAX_PPS;
+		p->win_us = now;
+	}
+	if (now - p->win_us < PACE_WINDOW_US) return;
+
+	if (p->congested) {
+		p->pps /= 2;
+		if (p->pps < CONFIG_MESH_TX_PACE_MIN_PPS) p->pps = CONFIG_MESH_TX_PACE_MIN_PPS;
+		if (p->pps < p->pps_min) p->pps_min = p->pps;
+		p->decreases++;
+	} else if (p->limited) {
+		p->pps += PACE_AI_PPS;
+		if (p->pps > CONFIG_MESH_TX_PACE_MAX_PPS) p->pps = CONFIG_MESH_TX_PACE_MAX_PPS;
+	}
+	p->congested = false;
+	p->limited = false;
+	p->win_us = now;
+}
+
+// батько закриває прийом (XON): вільних місць вгору не більше за ліміт класу
+static bool uplink_closing(int limit)
+{
+	static mesh_addr_t self;
+	static bool have_self = false;
+	uint32_t xseqno;
+
+	if (!have_self) have_self = esp_wifi_get_mac(WIFI_IF_STA, self.addr) == ESP_OK;
+	return esp_mesh_available_txupQ_num(&self, &xseqno) <= limit;
+}
+#endif
+
+// 0 — можна ставити, інакше скільки чекати, мкс
+static int64_t tx_wait_us(mesh_tx_class_t cls, int64_t now)
+{
+	if (!s_limit[cls]) return 0;
+
+	tx_class_t *c = &s_cls[cls];
+
+	portENTER_CRITICAL(&s_lock);
+	for (int h = 0; h < cls; h++) {
+		if (s_waiting[h] || s_want_us[h] > now) {
+			portEXIT_CRITICAL(&s_lock);
+			return TICK_US;
+		}
+	}
+#if CONFIG_MESH_TX_PACE
+	pace_window(&c->pace, now);
+	if (now < c->pace.next_us) {
+		c->pace.limited = true;
+		int64_t w = c->pace.next_us - now;
+		portEXIT_CRITICAL(&s_lock);
+		return w;
+	}
+#endif
+	portEXIT_CRITICAL(&s_lock);
+
+	mesh_tx_pending_t p;
+	if (esp_mesh_get_tx_pending(&p) != ESP_OK) return 0;
+	bool full = p.to_parent + p.to_parent_p2p >= s_limit[cls];
+#if CONFIG_MESH_TX_PACE
+	if (full || uplink_closing(s_limit[cls])) {
+		portENTER_CRITICAL(&s_lock);
+		c->pace.congested = true;
+		portEXIT_CRITICAL(&s_lock);
+	}
+#endif
+	return full ? TICK_US : 0;
+}
+
+esp_err_t mesh_tx_send(mesh_tx_class_t cls, const mesh_addr_t *to, const void *buf, size_t len, int flag)
+{
+	if ((unsigned)cls >= MESH_TX_CLASSES) return ESP_ERR_INVALID_ARG;
+	return mesh_tx_send_tos(cls, (mesh_tos_t)s_tos[cls], to, buf, len, flag);
+}
+
+esp_err_t mesh_tx_send_tos(mesh_tx_class_t cls, mesh_tos_t tos, const mesh_addr_t *to,
+			   const void *buf, size_t len, int flag)
+{
+	if ((unsigned)cls >= MESH_TX_CLASSES || !buf) return ESP_ERR_INVALID_ARG;
+
+	tx_class_t *c = &s_cls[cls];
+	int64_t t0 = esp_timer_get_time();
+	int64_t now = t0;
+	bool held = false;
+	int64_t wait;
+
+	while ((wait = tx_wait_us(cls, now)) != 0) {
+		if (flag & MESH_DATA_NONBLOCK) {
+			portENTER_CRITICAL(&s_lock);
+			c->refused++;
+			s_want_us[cls] = now + WANT_US;
+			portEXIT_CRITICAL(&s_lock);
+			return ESP_ERR_MESH_QUEUE_FULL;
+		}
+		portENTER_CRITICAL(&s_lock);
+		if (!held) {
+			c->held++;
+			s_waiting[cls]++;
+			held = true;
+		}
+		portEXIT_CRITICAL(&s_lock);
+		TickType_t ticks = pdMS_TO_TICKS((wait + 999) / 1000);
+		if (ticks < 1) ticks = 1;
+		vTaskDelay(ticks);
+		now = esp_timer_get_time();
+	}
+
+	uint8_t v2[TX_V2_MAX];
+	size_t v2_len = mesh_hdr_encode(to, buf, len, v2, sizeof(v2));
+	if (v2_len) {
+		buf = v2;
+		len = v2_len;
+	}
+
+	mesh_data_t data;
+	memset(&data, 0, sizeof(data));
+	data.data = (uint8_t *)buf;
+	data.size = (uint16_t)len;
+	data.proto = MESH_PROTO_BIN;
+	data.tos = tos;
+
+	esp_err_t err = esp_mesh_send(to, &data, MESH_DATA_P2P | flag, NULL, 0);
+	now = esp_timer_get_time();
+
+	portENTER_CRITICAL(&s_lock);
+	if (held) s_waiting[cls]--;
+	if (err == ESP_OK) {
+		c->sent++;
+		c->bytes += len;
+		lat_hist_add(&c->q_lat, (uint32_t)(now - t0));
+	} else {
+		c->err++;
+	}
+#if CONFIG_MESH_TX_PACE
+	if (s_limit[cls]) {
+		if (err == ESP_ERR_MESH_QUEUE_FULL) c->pace.congested = true;
+		if (err == ESP_OK) {
+			int64_t gap = 1000000 / c->pace.pps;
+			if (c->pace.next_us < now - PACE_BURST * gap) c->pace.next_us = now - PACE_BURST * gap;
+			c->pace.next_us += gap;
+		}
+	}
+#endif
+	portEXIT_CRITICAL(&s_lock);
+	return err;
+}
+
+int64_t mesh_tx_pace_next_us(mesh_tx_class_t cls)
+{
+	if ((unsigned)cls >= MESH_TX_CLASSES) return 0;
+
+	portENTER_CRITICAL(&s_lock);
+	int64_t t = s_cls[cls].pace.next_us;
+	portEXIT_CRITICAL(&s_lock);
+	return t;
+}
+
+void mesh_tx_note_drop(mesh_tx_class_t cls)
+{
+	if ((unsigned)cls >= MESH_TX_CLASSES) return;
+
+	portENTER_CRITICAL(&s_lock);
+	s_cls[cls].dropped++;
+	portEXIT_CRITICAL(&s_lock);
+}
+
+void mesh_tx_get_stats(mesh_tx_class_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	for (int i = 0; i < MESH_TX_CLASSES; i++) {
+		tx_class_t *c = &s_cls[i];
+		out[i].sent = c->sent;
+		out[i].bytes = c->bytes;
+		out[i].err = c->err;
+		out[i].held = c->held;
+		out[i].refused = c->refused;
+		out[i].dropped = c->dropped;
+		out[i].pps = c->pace.pps;
+		out[i].pps_min = c->pace.pps_min;
+		out[i].decreases = c->pace.decreases;
+		out[i].q_p50_us = lat_hist_pct(&c->q_lat, 50);
+		out[i].q_p99_us = lat_hist_pct(&c->q_lat, 99);
+		out[i].q_max_us = c->q_lat.max_us;
+	}
+	portEXIT_CRITICAL(&s_lock);
+}
+
+void mesh_tx_log_stats(void)
+{
+	static const char *name[MESH_TX_CLASSES] = { "ctrl", "time", "telemetry", "log" };
+	static mesh_tx_class_stats_t prev[MESH_TX_CLASSES];
+	static int64_t prev_us = 0;
+
+	mesh_tx_class_stats_t st[MESH_TX_CLASSES];
+	mesh_tx_get_stats(st);
+	int64_t now = esp_timer_get_time();
+	int64_t dt = prev_us ? now - prev_us : now;
+	if (dt <= 0) dt = 1;
+
+	// з минулого виклику: пакетів/с, байт/с, частка викинутих відправниками
+	for (int i = 0; i < MESH_TX_CLASSES; i++) {
+		uint32_t sent = st[i].sent - prev[i].sent;
+		uint32_t lost = st[i].dropped - prev[i].dropped;
+		ESP_LOGI(TAG, "%-9s %" PRIu32 " pkt/s %" PRIu32 " B/s drop=%.1f%% pace=%" PRIu32 "/s (min %" PRIu32
+			", %" PRIu32 " cuts) q_p99=%" PRIu32 "us",
+			name[i], (uint32_t)((int64_t)sent * 1000000 / dt),
+			(uint32_t)((int64_t)(st[i].bytes - prev[i].bytes) * 1000000 / dt),
+			sent + lost ? 100.0 * lost / (sent + lost) : 0.0,
+			st[i].pps, st[i].pps_min, st[i].decreases, st[i].q_p99_us);
+	}
+	memcpy(prev, st, sizeof(prev));
+	prev_us = now;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Класи трафіку в порядку пріоритету. CTRL і TIME ставляться в драйвер
+ * одразу; best-effort (TELEMETRY, LOG) — тільки поки черга драйвера вгору
+ * коротша за ліміт класу і жоден вищий клас не чекає, з дешевшим TOS і
+ * (CONFIG_MESH_TX_PACE) не швидше за темп, що підлаштовується під чергу.
+ */
+typedef enum {
+	MESH_TX_CTRL = 0,	// CMD / CMD_ACK
+	MESH_TX_TIME,		// mesh_time_sync
+	MESH_TX_TELEMETRY,	// legacy_root_sender, NODEINFO
+	MESH_TX_LOG,		// mesh_log_stream
+	MESH_TX_CLASSES,
+} mesh_tx_class_t;
+
+typedef struct {
+	uint32_t	sent;
+	uint64_t	bytes;
+	uint32_t	err;		// esp_mesh_send != ESP_OK
+	uint32_t	held;		// пакет чекав на ліміт класу, темп або вищий клас
+	uint32_t	refused;	// ... з MESH_DATA_NONBLOCK: ESP_ERR_MESH_QUEUE_FULL
+	uint32_t	dropped;	// mesh_tx_note_drop: відправник викинув (err з повтором — ні)
+	uint32_t	q_p50_us;	// від виклику до прийняття драйвером
+	uint32_t	q_p99_us;
+	uint32_t	q_max_us;
+
+	// CONFIG_MESH_TX_PACE, best-effort класи
+	uint32_t	pps;		// темп зараз, пакетів/с
+	uint32_t	pps_min;
+	uint32_t	decreases;	// скільки разів темп зменшувався вдвічі
+} mesh_tx_class_stats_t;
+
+// esp_mesh_send(to, ..., MESH_DATA_P2P | flag) з TOS класу. MESH_DATA_NONBLOCK:
+// best-effort клас не чекає ліміту, а одразу ESP_ERR_MESH_QUEUE_FULL.
+esp_err_t	mesh_tx_send(mesh_tx_class_t cls, const mesh_addr_t *to, const void *buf, size_t len, int flag);
+
+// Те саме з явним TOS замість TOS класу: MESH_TOS_P2P — ретрансміти на кожному
+// хопі для пакета best-effort класу, який не можна загубити (злите сховище)
+esp_err_t	mesh_tx_send_tos(mesh_tx_class_t cls, mesh_tos_t tos, const mesh_addr_t *to,
+				 const void *buf, size_t len, int flag);
+
+// Раніше за цей час (esp_timer, мкс) темп класу пакет не пропустить; 0 — без темпу
+int64_t		mesh_tx_pace_next_us(mesh_tx_class_t cls);
+
+// Відправник викинув пакет класу (переповнення, дедлайн) — для частки втрат
+void		mesh_tx_note_drop(mesh_tx_class_t cls);
+
+// out[MESH_TX_CLASSES]
+void		mesh_tx_get_stats(mesh_tx_class_stats_t *out);
+
+// Пропускна здатність і втрати по класах з минулого виклику — в лог
+void		mesh_tx_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+#include "powled_fade.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "powled_hal.h"
+#include "powled_node.h"
+
+static portMUX_TYPE		s_lock = portMUX_INITIALIZER_UNLOCKED;
+static powled_fade_stats_t	s_stats;
+
+#if CONFIG_POWLED_DIM
+
+static const char *TAG = "powled_fade";
+
+/*
+ * LEDC на ESP32 не вміє зупинити fade: новий запуск на каналі чекає в драйвері
+ * на кінець попереднього. Тому хендлер команди лише записує ціль каналу, а ця
+ * задача запускає її, коли канал вільний (за нашим часом кінця fade). Проміжні
+ * цілі, що прийшли за цей час, не виконуються — лишається остання.
+ */
+
+#define FADE_SLACK_US	2000	// кінець fade рахує LEDC, не esp_timer
+
+typedef struct {
+	bool		pending;
+	uint8_t		level;
+	uint32_t	fade_ms;
+	int64_t		busy_until_us;	// кінець запущеного fade
+} fade_ch_t;
+
+static TaskHandle_t	s_task = NULL;
+static uint8_t		s_count = 0;
+static fade_ch_t	s_ch[POWLED_NODE_MAX_CHANNELS];
+
+static uint32_t level_to_duty(uint8_t level)
+{
+	return ((uint32_t)level * POWLED_HAL_DUTY_MAX + 127) / 255;
+}
+
+static void powled_fade_task(void *arg)
+{
+	(void)arg;
+	TickType_t wait = portMAX_DELAY;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, wait);
+
+		int64_t now = esp_timer_get_time();
+		int64_t next = INT64_MAX;
+
+		for (uint8_t ch = 0; ch < s_count; ch++) {
+			fade_ch_t *c = &s_ch[ch];
+
+			portENTER_CRITICAL(&s_lock);
+			bool go = c->pending && now >= c->busy_until_us;
+			uint8_t level = c->level;
+			uint32_t ms = c->fade_ms;
+			if (go) {
+				c->pending = false;
+				c->busy_until_us = now + (int64_t)ms * 1000 + (ms ? FADE_SLACK_US : 0);
+				s_stats.fades++;
+			} else if (c->pending && c->busy_until_us < next) {
+				next = c->busy_until_us;
+			}
+			portEXIT_CRITICAL(&s_lock);
+
+			if (go) powled_hal_dim(ch, level_to_duty(level), ms);
+		}
+
+		wait = next == INT64_MAX ? portMAX_DELAY : pdMS_TO_TICKS((next - now + 999) / 1000) + 1;
+	}
+}
+
+void powled_fade_init(const uint8_t *gpio, uint8_t count)
+{
+	if (count > POWLED_NODE_MAX_CHANNELS) count = POWLED_NODE_MAX_CHANNELS;
+
+	powled_hal_dim_init(gpio, count);
+	s_count = count;
+	memset(s_ch, 0, sizeof(s_ch));
+
+	if (xTaskCreate(powled_fade_task, "powled_fade", 2048, NULL, 5, &s_task) != pdPASS) {
+		ESP_LOGE(TAG, "xTaskCreate failed");
+		s_task = NULL;
+	}
+}
+
+void powled_fade_set(uint8_t ch, uint8_t level, uint32_t fade_ms)
+{
+	if (ch >= s_count || !s_task) return;
+
+	int64_t now = esp_timer_get_time();
+	fade_ch_t *c = &s_ch[ch];
+
+	portENTER_CRITICAL(&s_lock);
+	if (fade_ms > CONFIG_POWLED_FADE_MAX_MS) {
+		fade_ms = CONFIG_POWLED_FADE_MAX_MS;
+		s_stats.clamped++;
+	}
+	if (c->pending) s_stats.coalesced++;
+	if (now < c->busy_until_us) s_stats.deferred++;
+	c->pending = true;
+	c->level = level;
+	c->fade_ms = fade_ms;
+	portEXIT_CRITICAL(&s_lock);
+
+	xTaskNotifyGive(s_task);
+}
+
+#endif	// CONFIG_POWLED_DIM
+
+void powled_fade_get_stats(powled_fade_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Плавні переходи каналів powled (CONFIG_POWLED_DIM) на апаратному fade LEDC.
+ * Ціль каналу — остання команда; запускає її окрема задача, коли попередній
+ * fade каналу скінчився, тож RX-воркер ніколи не чекає на драйвер LEDC.
+ */
+
+typedef struct {
+	uint32_t	fades;			// запущено на HAL
+	uint32_t	coalesced;		// ціль замінена до запуску (остання перемагає)
+	uint32_t	deferred;		// прийшла, поки йшов попередній fade каналу
+	uint32_t	clamped;		// fade_ms обрізано до CONFIG_POWLED_FADE_MAX_MS
+} powled_fade_stats_t;
+
+void powled_fade_init(const uint8_t *gpio, uint8_t count);
+
+// level 0..255 (0 — вимк.), fade_ms 0 — одразу
+void powled_fade_set(uint8_t ch, uint8_t level, uint32_t fade_ms);
+
+void powled_fade_get_stats(powled_fade_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
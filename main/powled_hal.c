@@ -0,0 +1,88 @@
+#include "powled_hal.h"
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_log.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+#include "soc/gpio_reg.h"
+
+static const char *TAG = "powled_hal";
+
+#define DIM_MODE	LEDC_LOW_SPEED_MODE	// є на всіх чипах
+
+void powled_hal_init(uint64_t pins)
+{
+	gpio_config_t io = {
+		.pin_bit_mask = pins,
+		.mode = GPIO_MODE_OUTPUT,
+		.pull_up_en = GPIO_PULLUP_DISABLE,
+		.pull_down_en = GPIO_PULLDOWN_DISABLE,
+		.intr_type = GPIO_INTR_DISABLE,
+	};
+	gpio_config(&io);
+
+	powled_hal_write(0, pins);
+}
+
+void powled_hal_write(uint64_t set, uint64_t clr)
+{
+	if ((uint32_t)set) REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)set);
+	if ((uint32_t)clr) REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)clr);
+#if SOC_GPIO_PIN_COUNT > 32
+	if (set >> 32) REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(set >> 32));
+	if (clr >> 32) REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(clr >> 32));
+#endif
+}
+
+void powled_hal_dim_init(const uint8_t *gpio, uint8_t count)
+{
+#if CONFIG_POWLED_DIM
+	const ledc_timer_config_t t = {
+		.speed_mode = DIM_MODE,
+		.duty_resolution = LEDC_TIMER_10_BIT,
+		.timer_num = LEDC_TIMER_0,
+		.freq_hz = CONFIG_POWLED_DIM_FREQ_HZ,
+		.clk_cfg = LEDC_AUTO_CLK,
+	};
+	esp_err_t err = ledc_timer_config(&t);
+	if (err != ESP_OK) ESP_LOGE(TAG, "ledc_timer_config: %s", esp_err_to_name(err));
+
+	for (uint8_t ch = 0; ch < count; ch++) {
+		const ledc_channel_config_t c = {
+			.gpio_num = gpio[ch],
+			.speed_mode = DIM_MODE,
+			.channel = (ledc_channel_t)ch,
+			.intr_type = LEDC_INTR_DISABLE,
+			.timer_sel = LEDC_TIMER_0,
+			.duty = 0,
+			.hpoint = 0,
+		};
+		err = ledc_channel_config(&c);
+		if (err != ESP_OK) ESP_LOGE(TAG, "ledc_channel_config ch%u: %s", (unsigned)ch, esp_err_to_name(err));
+	}
+
+	err = ledc_fade_func_install(0);
+	if (err != ESP_OK) ESP_LOGE(TAG, "ledc_fade_func_install: %s", esp_err_to_name(err));
+#else
+	(void)gpio;
+	(void)count;
+#endif
+}
+
+void powled_hal_dim(uint8_t ch, uint32_t duty, uint32_t fade_ms)
+{
+#if CONFIG_POWLED_DIM
+	if (fade_ms) {
+		ledc_set_fade_time_and_start(DIM_MODE, (ledc_channel_t)ch, duty, fade_ms, LEDC_FADE_NO_WAIT);
+	} else {
+		ledc_set_duty(DIM_MODE, (ledc_channel_t)ch, duty);
+		ledc_update_duty(DIM_MODE, (ledc_channel_t)ch);
+	}
+#else
+	(void)ch;
+	(void)duty;
+	(void)fade_ms;
+#endif
+}
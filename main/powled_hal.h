@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Виходи powled напряму через регістри set/clear (W1TS/W1TC): біт n маски = GPIOn.
+ * Пишуться тільки одиниці, тож без read-modify-write і без блокування; всі піни
+ * одного банку (0..31 або 32..39) з однаковим рівнем міняються одним записом.
+ * У host-симуляторі реалізація своя (host_sim/sim_esp.c).
+ */
+
+// Налаштувати піни виходами і скинути в 0
+void powled_hal_init(uint64_t pins);
+
+// set і clr не повинні перетинатися
+void powled_hal_write(uint64_t set, uint64_t clr);
+
+/*
+ * Димування (CONFIG_POWLED_DIM): канал ch — LEDC-канал ch на gpio[ch], 10 біт.
+ * Fade рахує апаратний движок LEDC, CPU лише запускає його. Поки попередній
+ * fade каналу не скінчився, драйвер чекає на нього — планує powled_fade.c.
+ */
+#define POWLED_HAL_DUTY_MAX	1023
+
+void powled_hal_dim_init(const uint8_t *gpio, uint8_t count);
+
+// fade_ms == 0 — одразу
+void powled_hal_dim(uint8_t ch, uint32_t duty, uint32_t fade_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,51 +1,258 @@
 #include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/time.h>
 #include "powled_node.h"
 
+#include "sdkconfig.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "mesh_time_sync.h"
+#include "powled_fade.h"
+#include "powled_hal.h"
 
 static const char *TAG = "powled";
 
-#define POWLED_GPIO	GPIO_NUM_33
+/*
+ * Канали — піни з CONFIG_POWLED_GPIOS ("33,25,26"), стан усіх — бітова маска.
+ * Команда на кілька каналів складає маски set/clear і пише їх у регістри одним
+ * powled_hal_write(), тож канали перемикаються разом, без gpio_set_level на пін.
+ * З CONFIG_POWLED_DIM канали — LEDC, яскравість і fade веде powled_fade.c.
+ */
+static uint8_t		s_ch_count = 0;
+static uint8_t		s_ch_gpio[POWLED_NODE_MAX_CHANNELS];
+
+// біт n: 0 -> LOW, 1 -> HIGH (як у твоєму Arduino-коді)
+static uint32_t		s_state = 0;
+
+/*
+ * Перемикання за часом: команда несе момент at_us за синхронізованим годинником,
+ * нода заряджає esp_timer на (at_us - зараз) і пише GPIO в колбеку — тож група
+ * ламп перемикається разом, а не з розкидом у затримку mesh до кожної.
+ */
+static portMUX_TYPE		s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t	s_at_timer = NULL;
+static uint32_t			s_at_mask = 0;
+static uint32_t			s_at_on = 0;
+static uint8_t			s_at_level = 0;
+static uint32_t			s_at_fade_ms = 0;
+static int64_t			s_at_us = 0;
+static powled_node_stats_t	s_stats;
+
+static int64_t now_us(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Канали mask: з on — увімк. (з CONFIG_POWLED_DIM — до level за fade_ms), решта — вимк.
+static void apply(uint32_t mask, uint32_t on, uint8_t level, uint32_t fade_ms)
+{
+#if CONFIG_POWLED_DIM
+	portENTER_CRITICAL(&s_lock);
+	s_state = (s_state & ~mask) | (on & mask);
+	portEXIT_CRITICAL(&s_lock);
+
+	for (uint8_t ch = 0; ch < s_ch_count; ch++) {
+		if (mask & (1u << ch)) powled_fade_set(ch, (on & (1u << ch)) ? level : 0, fade_ms);
+	}
+#else
+	(void)level;
+	(void)fade_ms;
+	uint64_t set = 0, clr = 0;
+
+	for (uint8_t ch = 0; ch < s_ch_count; ch++) {
+		if (!(mask & (1u << ch))) continue;
+		if (on & (1u << ch)) set |= 1ULL << s_ch_gpio[ch];
+		else clr |= 1ULL << s_ch_gpio[ch];
+	}
+
+	portENTER_CRITICAL(&s_lock);
+	s_state = (s_state & ~mask) | (on & mask);
+	powled_hal_write(set, clr);
+	portEXIT_CRITICAL(&s_lock);
+#endif
+}
+
+static void at_timer_cb(void *arg)
+{
+	(void)arg;
+
+	portENTER_CRITICAL(&s_lock);
+	uint32_t mask = s_at_mask, on = s_at_on, fade_ms = s_at_fade_ms;
+	uint8_t level = s_at_level;
+	int64_t at = s_at_us;
+	portEXIT_CRITICAL(&s_lock);
+
+	apply(mask, on, level, fade_ms);
+	uint32_t state = s_state;
+
+	int32_t err = (int32_t)(now_us() - at);
 
-// 0 -> LOW, 1 -> HIGH (як у твоєму Arduino-коді)
-static uint8_t s_state = 0;
+	portENTER_CRITICAL(&s_lock);
+	s_stats.last_err_us = err;
+	int32_t mag = err < 0 ? -err : err;
+	if (mag > s_stats.max_abs_err_us) s_stats.max_abs_err_us = mag;
+	portEXIT_CRITICAL(&s_lock);
 
-static void apply_state(void)
+	ESP_LOGI(TAG, "state=0x%02" PRIx32 " at, err=%" PRId32 " us", state, err);
+}
+
+// "33,25,26" -> s_ch_gpio[]; чужі, повторні та input-only піни пропускаємо
+static void parse_gpios(void)
 {
-	gpio_set_level(POWLED_GPIO, s_state ? 1 : 0);
-	ESP_LOGI(TAG, "GPIO%d=%d (state=%u)", (int)POWLED_GPIO, s_state ? 1 : 0, (unsigned)s_state);
+	const char *s = CONFIG_POWLED_GPIOS;
+	uint64_t used = 0;
+
+	while (*s && s_ch_count < POWLED_NODE_MAX_CHANNELS) {
+		char *end;
+		long g = strtol(s, &end, 10);
+		if (end == s) {
+			s++;	// роздільник
+			continue;
+		}
+		s = end;
+
+		// спершу діапазон: GPIO_IS_VALID_OUTPUT_GPIO і used зсувають 1ULL << g
+		// (GPIO_NUM_MAX == SOC_GPIO_PIN_COUNT)
+		if (g < 0 || g >= GPIO_NUM_MAX || !GPIO_IS_VALID_OUTPUT_GPIO(g) || (used & (1ULL << g))) {
+			ESP_LOGE(TAG, "CONFIG_POWLED_GPIOS: GPIO%ld skipped", g);
+			continue;
+		}
+		used |= 1ULL << g;
+		s_ch_gpio[s_ch_count++] = (uint8_t)g;
+	}
 }
 
 void powled_node_init(void)
 {
-	gpio_config_t io = {
-		.pin_bit_mask = 1ULL << POWLED_GPIO,
-		.mode = GPIO_MODE_OUTPUT,
-		.pull_up_en = GPIO_PULLUP_DISABLE,
-		.pull_down_en = GPIO_PULLDOWN_DISABLE,
-		.intr_type = GPIO_INTR_DISABLE,
+	parse_gpios();
+
+	uint64_t pins = 0;
+	for (uint8_t ch = 0; ch < s_ch_count; ch++) pins |= 1ULL << s_ch_gpio[ch];
+	if (!pins) {
+		ESP_LOGE(TAG, "no output channels in CONFIG_POWLED_GPIOS");
+	} else {
+		// дефолт як у тебе: powled0
+#if CONFIG_POWLED_DIM
+		powled_fade_init(s_ch_gpio, s_ch_count);
+#else
+		powled_hal_init(pins);
+#endif
+	}
+	s_state = 0;
+
+	const esp_timer_create_args_t targs = {
+		.callback = at_timer_cb,
+		.dispatch_method = ESP_TIMER_TASK,
+		.name = "powled_at",
 	};
-	gpio_config(&io);
+	if (esp_timer_create(&targs, &s_at_timer) != ESP_OK) {
+		ESP_LOGE(TAG, "esp_timer_create failed");
+	}
 
-	s_state = 0;	// дефолт як у тебе: powled0
-	apply_state();
+	ESP_LOGI(TAG, "%u channel(s), pins 0x%010" PRIx64, (unsigned)s_ch_count, pins);
 }
 
+// Відкладена POWLED_AT більше не актуальна: новіша команда вже задала стан
+static void at_cancel(void)
+{
+	if (s_at_timer && esp_timer_stop(s_at_timer) == ESP_OK) {
+		portENTER_CRITICAL(&s_lock);
+		s_stats.replaced++;
+		portEXIT_CRITICAL(&s_lock);
+	}
+}
+
+uint32_t powled_node_ch_mask(void)
+{
+	return s_ch_count ? (1u << s_ch_count) - 1 : 0;
+}
+
+esp_err_t powled_node_fade(uint32_t mask, uint32_t on, uint8_t level, uint32_t fade_ms)
+{
+	if (!mask || (mask & ~powled_node_ch_mask())) return ESP_ERR_NOT_FOUND;
+
+	at_cancel();
+	apply(mask, on, level, fade_ms);
+	return ESP_OK;
+}
+
+esp_err_t powled_node_set_mask(uint32_t mask, uint32_t on)
+{
+	return powled_node_fade(mask, on, 255, 0);
+}
+
+esp_err_t powled_node_set(uint8_t channel, uint8_t level)
+{
+	if (channel >= s_ch_count) return ESP_ERR_NOT_FOUND;
+
+	uint32_t bit = 1u << channel;
+	return powled_node_fade(bit, level ? bit : 0, level, 0);
+}
+
+// Старі текстові команди — обгортка над powled_node_set_mask()
 void powled_node_legacy_cmd(const char *txt)
 {
 	if (!txt) return;
 
-	if (strcmp(txt, "powled0") == 0) {
-		s_state = 0;
-		apply_state();
-		return;
-	}
-	if (strcmp(txt, "powled1") == 0) {
-		s_state = 1;
-		apply_state();
+	uint8_t level;
+	if (strcmp(txt, "powled0") == 0) level = 0;
+	else if (strcmp(txt, "powled1") == 0) level = 1;
+	else return;	// інші команди ігноруємо (або логай, якщо хочеш)
+
+	uint32_t all = powled_node_ch_mask();
+	powled_node_set_mask(all, level ? all : 0);
+	ESP_LOGI(TAG, "state=0x%02" PRIx32, s_state);
+}
+
+void powled_node_cmd_at(uint32_t mask, uint32_t on, uint8_t level, uint32_t fade_ms, int64_t at_us)
+{
+	mask &= powled_node_ch_mask();
+	if (!mask) return;
+
+	mesh_time_sync_stats_t ts;
+	mesh_time_sync_get_stats(&ts);
+
+	int64_t delay = at_us - now_us();
+
+	// Без точного часу (або з ним щось не так) момент нічого не означає
+	bool unsynced = ts.syncs == 0 || delay > (int64_t)CONFIG_POWLED_AT_MAX_LEAD_MS * 1000;
+	bool now = unsynced || delay <= 0 || !s_at_timer;
+
+	at_cancel();
+
+	portENTER_CRITICAL(&s_lock);
+	s_stats.scheduled++;
+	if (unsynced) s_stats.unsynced++;
+	else if (delay <= 0) s_stats.late++;
+	s_at_mask = mask;
+	s_at_on = on;
+	s_at_level = level;
+	s_at_fade_ms = fade_ms;
+	s_at_us = at_us;
+	portEXIT_CRITICAL(&s_lock);
+
+	if (now) {
+		if (!unsynced) ESP_LOGW(TAG, "powled at: late by %" PRId64 " us", -delay);
+		apply(mask, on, level, fade_ms);
+		ESP_LOGI(TAG, "state=0x%02" PRIx32, s_state);
 		return;
 	}
 
-	// інші команди ігноруємо (або логай, якщо хочеш)
+	esp_timer_start_once(s_at_timer, (uint64_t)delay);
+}
+
+void powled_node_get_stats(powled_node_stats_t *out)
+{
+	if (!out) return;
+
+	portENTER_CRITICAL(&s_lock);
+	*out = s_stats;
+	portEXIT_CRITICAL(&s_lock);
 }
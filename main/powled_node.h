@@ -1,12 +1,47 @@
 #pragma once
 
+#include <stdint.h>
+#include "esp_err.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct {
+	uint32_t	scheduled;		// команд з часом виконання (MESH_PKT_TYPE_POWLED_AT)
+	uint32_t	late;			// момент уже минув — виконано одразу
+	uint32_t	unsynced;		// годинник не синхронізований — виконано одразу
+	uint32_t	replaced;		// нова команда (і негайна) прийшла до виконання попередньої
+	int32_t		last_err_us;		// фактичний - заданий момент, за своїм годинником
+	int32_t		max_abs_err_us;
+} powled_node_stats_t;
+
+#define POWLED_NODE_MAX_CHANNELS	8	// маска каналів у MESH_CMD_F_MASK — один байт
+
 void powled_node_init(void);
+
+// Старі текстові powled0/powled1 — на всі канали
 void powled_node_legacy_cmd(const char *txt);
 
+// Канали з CONFIG_POWLED_GPIOS: біт n = канал n
+uint32_t powled_node_ch_mask(void);
+
+// Бінарна команда (mesh_cmd.c): level 0 — вимк., інакше увімк. (з CONFIG_POWLED_DIM — яскравість)
+// ESP_ERR_NOT_FOUND — нема такого каналу
+esp_err_t powled_node_set(uint8_t channel, uint8_t level);
+
+// Канали з mask одним записом у регістри: біт у on — увімк., інакше вимк.
+esp_err_t powled_node_set_mask(uint32_t mask, uint32_t on);
+
+// З CONFIG_POWLED_DIM: канали mask з бітом у on — до level, решта — до 0, за fade_ms.
+// Без димування — як powled_node_set_mask()
+esp_err_t powled_node_fade(uint32_t mask, uint32_t on, uint8_t level, uint32_t fade_ms);
+
+// powled_node_fade() в момент at_us (epoch, мкс); якщо він минув або часу нема — одразу
+void powled_node_cmd_at(uint32_t mask, uint32_t on, uint8_t level, uint32_t fade_ms, int64_t at_us);
+
+void powled_node_get_stats(powled_node_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,10 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 
+#include "mesh_hdr.h"
+#include "mesh_rx.h"
+#include "mesh_tx.h"
+
 #define STACK_MONITOR_MAX_TASKS	25
 #define STACK_MONITOR_PERIOD_MS	60000	// раз на 60 секунд
 
@@ -125,6 +129,11 @@ static void stack_monitor_task(void *arg)
 					cpu_load, dt_total, dt_idle);
 		}
 
+		// заодно — хто скільки їсть у mesh_rx_task і що йде вгору
+		mesh_rx_log_stats();
+		mesh_tx_log_stats();
+		mesh_hdr_log_stats();
+
 		ESP_LOGI(TAG, "===== END STACK MONITOR =====");
 
 		vTaskDelay(pdMS_TO_TICKS(STACK_MONITOR_PERIOD_MS));